@@ -3,8 +3,45 @@
 #include "value.h"
 #include "op_codes.h"
 #include "meow_object.h"
+#include "large_object_space.h"
 #include "pch.h"
 
+// Phần tử của mảng; mảng lớn được cấp phát trong large-object space.
+using ValueArray = std::vector<Value, LargeObjectAllocator<Value>>;
+
+// Ước lượng bộ nhớ heap mà giá trị/container chiếm, dùng cho việc kích hoạt GC.
+inline size_t stringHeapBytes(const Str& s) {
+    static const size_t inlineCapacity = Str().capacity();
+    return s.capacity() > inlineCapacity ? s.capacity() + 1 : 0;
+}
+
+inline size_t valueHeapBytes(const Value& value) {
+    const Str* s = value.get_if<Str>();
+    return s ? stringHeapBytes(*s) : 0;
+}
+
+inline size_t fieldNodeBytes(const Str& key, const Value& value) {
+    // node của unordered_map: con trỏ next + hash cache + cặp key/value
+    return 2 * sizeof(void*) + sizeof(std::pair<const Str, Value>) + stringHeapBytes(key) + valueHeapBytes(value);
+}
+
+inline size_t fieldMapBytes(const std::unordered_map<Str, Value>& fields) {
+    size_t bytes = fields.bucket_count() * sizeof(void*);
+    for (const auto& [key, value] : fields) {
+        bytes += fieldNodeBytes(key, value);
+    }
+    return bytes;
+}
+
+template<typename Allocator>
+inline size_t valueVectorBytes(const std::vector<Value, Allocator>& values) {
+    size_t bytes = values.capacity() * sizeof(Value);
+    for (const auto& value : values) {
+        bytes += valueHeapBytes(value);
+    }
+    return bytes;
+}
+
 struct Instruction {
     OpCode op;
     std::vector<Int> args;
@@ -27,6 +64,35 @@ struct ExceptionHandler {
         : catchIp(c), frameDepth(f), stackDepth(s), errorRegister(eReg) {}
 };
 
+// Thân hàm (hằng số, upvalue, code) chưa được giải mã của một proto nạp lười.
+class LazyProtoBody {
+public:
+    virtual ~LazyProtoBody() = default;
+    virtual void load(ObjFunctionProto& proto) = 0;
+    // Object mà thân chưa giải mã còn giữ (ví dụ bảng proto của file).
+    virtual void trace([[maybe_unused]] GCVisitor& visitor) {}
+};
+
+// Thanh ghi còn sống tại từng lệnh của proto, để GC xoá thanh ghi chết thay
+// vì giữ object trong đó tới khi hàm trả về. Entry của lệnh i gồm thanh ghi
+// sống trước và sau lệnh i cùng mọi thanh ghi lệnh i đọc/ghi, nên dùng được cho
+// cả frame sắp chạy lệnh i lẫn frame đang dừng giữa lệnh i để gọi hàm khác.
+// Rỗng nghĩa là không có bản đồ (proto có try, bytecode cũ...) và mọi thanh
+// ghi đều được coi là sống.
+struct StackMap {
+    size_t wordsPerEntry = 0;
+    std::vector<Uint64> bits;
+
+    bool empty() const noexcept { return wordsPerEntry == 0; }
+
+    size_t entries() const noexcept { return empty() ? 0 : bits.size() / wordsPerEntry; }
+
+    bool isLive(size_t ip, Int reg) const noexcept {
+        size_t word = ip * wordsPerEntry + static_cast<size_t>(reg) / 64;
+        return (bits[word] >> (static_cast<size_t>(reg) % 64)) & 1;
+    }
+};
+
 struct ObjFunctionProto : public MeowObject {
     Int numRegisters = 0;
     Int numUpvalues = 0;
@@ -36,14 +102,40 @@ struct ObjFunctionProto : public MeowObject {
     std::vector<UpvalueDesc> upvalueDescs;
     std::unordered_map<Str, Int> labels;
     std::vector<std::tuple<Int, Int, Str>> pendingJumps;
+    StackMap stackMap;
+
+    // Khác null khi thân hàm vẫn nằm trong file .meowb; được giải mã khi tạo
+    // closure đầu tiên cho proto này.
+    std::unique_ptr<LazyProtoBody> lazyBody;
 
     ObjFunctionProto(Int regs = 0, Int ups = 0, Str name = "<anon>")
         : numRegisters(regs), numUpvalues(ups), sourceName(std::move(name)) {}
 
+    void materialize() {
+        if (!lazyBody) return;
+        lazyBody->load(*this);
+        lazyBody.reset();
+    }
+
     void trace(GCVisitor& visitor) override {
         for (auto& constant : constantPool) {
             visitor.visitValue(constant);
         }
+        if (lazyBody) lazyBody->trace(visitor);
+    }
+
+    ObjectType objectType() const override { return ObjectType::Proto; }
+
+    MeowObject* relocateTo(void* cell) override { return new (cell) ObjFunctionProto(std::move(*this)); }
+
+    size_t byteSize() const override {
+        size_t bytes = sizeof(*this) + stringHeapBytes(sourceName) + valueVectorBytes(constantPool);
+        bytes += code.capacity() * sizeof(Instruction) + upvalueDescs.capacity() * sizeof(UpvalueDesc);
+        bytes += stackMap.bits.capacity() * sizeof(Uint64);
+        for (const auto& inst : code) {
+            bytes += inst.args.capacity() * sizeof(Int);
+        }
+        return bytes;
     }
 };
 
@@ -55,7 +147,7 @@ struct ObjModule : public MeowObject {
     Bool isExecuted = false;
     Bool isBinary = false;
 
-    Proto mainProto;
+    HeapRef<ObjFunctionProto> mainProto;
     Bool hasMain = false;
 
     Bool isExecuting = false;
@@ -64,9 +156,23 @@ struct ObjModule : public MeowObject {
         : name(std::move(n)), path(std::move(p)), isBinary(b) {}
 
     void trace(GCVisitor& visitor) override {
+        traceMutable(visitor);
+        visitor.visitSlot(mainProto);
+    }
+
+    void traceMutable(GCVisitor& visitor) override {
         for (auto& kv : globals) visitor.visitValue(kv.second);
         for (auto& kv : exports) visitor.visitValue(kv.second);
-        visitor.visitObject(mainProto);
+    }
+
+    bool hasMutableReferences() const override { return true; }
+
+    ObjectType objectType() const override { return ObjectType::Module; }
+
+    MeowObject* relocateTo(void* cell) override { return new (cell) ObjModule(std::move(*this)); }
+
+    size_t byteSize() const override {
+        return sizeof(*this) + stringHeapBytes(name) + stringHeapBytes(path) + fieldMapBytes(globals) + fieldMapBytes(exports);
     }
 };
 
@@ -84,19 +190,37 @@ struct ObjUpvalue : public MeowObject {
     void trace(GCVisitor& visitor) override {
         visitor.visitValue(closed);
     }
+
+    ObjectType objectType() const override { return ObjectType::Upvalue; }
+
+    MeowObject* relocateTo(void* cell) override { return new (cell) ObjUpvalue(std::move(*this)); }
+
+    size_t byteSize() const override {
+        return sizeof(*this) + valueHeapBytes(closed);
+    }
 };
 
 struct ObjClosure : public MeowObject {
-    Proto proto;
-    std::vector<Upvalue> upvalues;
-    ObjClosure(Proto p = nullptr) : proto(p), upvalues(p ? p->numUpvalues : 0) {}
+    HeapRef<ObjFunctionProto> proto;
+    std::vector<HeapRef<ObjUpvalue>> upvalues;
+    ObjClosure(Proto p = nullptr) : proto(p), upvalues(p ? p->numUpvalues : 0) {
+        if (p) p->materialize();
+    }
 
     void trace(GCVisitor& visitor) override {
-        visitor.visitObject(proto);
+        visitor.visitSlot(proto);
         for (auto& uv : upvalues) {
-            visitor.visitObject(uv);
+            visitor.visitSlot(uv);
         }
     }
+
+    ObjectType objectType() const override { return ObjectType::Closure; }
+
+    MeowObject* relocateTo(void* cell) override { return new (cell) ObjClosure(std::move(*this)); }
+
+    size_t byteSize() const override {
+        return sizeof(*this) + upvalues.capacity() * sizeof(HeapRef<ObjUpvalue>);
+    }
 };
 
 struct CallFrame {
@@ -111,54 +235,154 @@ struct CallFrame {
 
 struct ObjClass : public MeowObject {
     Str name;
-    std::optional<Class> superclass;
+    std::optional<HeapRef<ObjClass>> superclass;
     std::unordered_map<Str, Value> methods;
     ObjClass(Str n = "") : name(std::move(n)) {}
 
     void trace(GCVisitor& visitor) override {
         if (superclass) {
-            visitor.visitObject(*superclass);
+            visitor.visitSlot(*superclass);
         }
         for (auto& method : methods) {
             visitor.visitValue(method.second);
         }
     }
+
+    ObjectType objectType() const override { return ObjectType::Class; }
+
+    MeowObject* relocateTo(void* cell) override { return new (cell) ObjClass(std::move(*this)); }
+
+    size_t byteSize() const override {
+        return sizeof(*this) + stringHeapBytes(name) + fieldMapBytes(methods);
+    }
 };
 
 struct ObjInstance : public MeowObject {
-    Class klass;
+    HeapRef<ObjClass> klass;
     std::unordered_map<Str, Value> fields;
     ObjInstance(Class k = nullptr) : klass(k) {}
 
     void trace(GCVisitor& visitor) override {
-        visitor.visitObject(klass);
+        visitor.visitSlot(klass);
         for (auto& field : fields) {
             visitor.visitValue(field.second);
         }
     }
+
+    ObjectType objectType() const override { return ObjectType::Instance; }
+
+    MeowObject* relocateTo(void* cell) override { return new (cell) ObjInstance(std::move(*this)); }
+
+    size_t byteSize() const override {
+        return sizeof(*this) + fieldMapBytes(fields);
+    }
+};
+
+// Tham chiếu yếu tới một object: không giữ object sống, GC đặt target về Null
+// khi object đó chết. Là instance của class WeakRef do module weak tạo ra.
+struct ObjWeakRef : public ObjInstance {
+    Value target;
+    ObjWeakRef(Class k, Value t) : ObjInstance(k), target(std::move(t)) {}
+
+    void traceWeak(GCVisitor& visitor) override {
+        visitor.visitValue(target);
+    }
+
+    ObjectType objectType() const override { return ObjectType::WeakRef; }
+
+    MeowObject* relocateTo(void* cell) override { return new (cell) ObjWeakRef(std::move(*this)); }
+};
+
+// Map khoá yếu theo identity của object, ngữ nghĩa ephemeron: value của một
+// entry chỉ được giữ sống khi key còn sống nhờ đường khác, và entry bị xoá khi
+// key chết.
+struct ObjWeakMap : public ObjInstance {
+    struct Entry {
+        MeowObject* keyObject;
+        Value key;
+        Value value;
+    };
+    std::unordered_map<const MeowObject*, Entry> entries;
+    ObjWeakMap(Class k = nullptr) : ObjInstance(k) {}
+
+    void traceWeak(GCVisitor& visitor) override {
+        for (auto& [_, entry] : entries) {
+            visitor.visitObjectSlot(entry.keyObject);
+            visitor.visitValue(entry.key);
+            visitor.visitValue(entry.value);
+        }
+    }
+
+    // Dựng lại bảng băm sau khi key bị di chuyển (compact).
+    void rekey() {
+        std::unordered_map<const MeowObject*, Entry> moved;
+        moved.reserve(entries.size());
+        for (auto& [_, entry] : entries) {
+            moved.emplace(entry.keyObject, std::move(entry));
+        }
+        entries.swap(moved);
+    }
+
+    static size_t entryBytes(const Entry& entry) {
+        return 2 * sizeof(void*) + sizeof(std::pair<const MeowObject* const, Entry>) +
+               valueHeapBytes(entry.key) + valueHeapBytes(entry.value);
+    }
+
+    ObjectType objectType() const override { return ObjectType::WeakMap; }
+
+    MeowObject* relocateTo(void* cell) override { return new (cell) ObjWeakMap(std::move(*this)); }
+
+    size_t byteSize() const override {
+        size_t bytes = ObjInstance::byteSize() + entries.bucket_count() * sizeof(void*);
+        for (const auto& [_, entry] : entries) {
+            bytes += entryBytes(entry);
+        }
+        return bytes;
+    }
 };
 
 struct ObjBoundMethod : public MeowObject {
-    Instance receiver;
-    Function callable;
+    HeapRef<ObjInstance> receiver;
+    HeapRef<ObjClosure> callable;
     ObjBoundMethod(Instance r = nullptr, Function c = nullptr) : receiver(r), callable(c) {}
 
     void trace(GCVisitor& visitor) override {
-        visitor.visitObject(receiver);
-        visitor.visitObject(callable);
+        visitor.visitSlot(receiver);
+        visitor.visitSlot(callable);
+    }
+
+    ObjectType objectType() const override { return ObjectType::BoundMethod; }
+
+    MeowObject* relocateTo(void* cell) override { return new (cell) ObjBoundMethod(std::move(*this)); }
+
+    size_t byteSize() const override {
+        return sizeof(*this);
     }
 };
 
 struct ObjArray : public MeowObject {
-    std::vector<Value> elements;
+    ValueArray elements;
     ObjArray() = default;
-    ObjArray(std::vector<Value> v) : elements(std::move(v)) {}
+    ObjArray(ValueArray v) : elements(std::move(v)) {}
 
     void trace(GCVisitor& visitor) override {
         for (auto& element : elements) {
             visitor.visitValue(element);
         }
     }
+
+    ObjectType objectType() const override { return ObjectType::Array; }
+
+    MeowObject* relocateTo(void* cell) override { return new (cell) ObjArray(std::move(*this)); }
+
+    size_t byteSize() const override {
+        return sizeof(*this) + valueVectorBytes(elements);
+    }
+
+    size_t largeBytes() const noexcept {
+        size_t bytes = elements.capacity() * sizeof(Value);
+        return large_object_space::isLarge(bytes) ? bytes : 0;
+    }
 };
 
 struct ObjObject : public MeowObject {
@@ -171,4 +395,40 @@ struct ObjObject : public MeowObject {
             visitor.visitValue(field.second);
         }
     }
-};
\ No newline at end of file
+
+    ObjectType objectType() const override { return ObjectType::Object; }
+
+    MeowObject* relocateTo(void* cell) override { return new (cell) ObjObject(std::move(*this)); }
+
+    size_t byteSize() const override {
+        return sizeof(*this) + fieldMapBytes(fields);
+    }
+};
+
+// Bảng tra theo tag của variant: alternative nào là con trỏ tới MeowObject
+// thì trả về con trỏ đó, còn lại (số, chuỗi, native...) trả về nullptr. Pha
+// mark gọi cho mọi value nên tra bảng thay vì std::visit.
+using ObjectExtractor = MeowObject* (*)(const Value&) noexcept;
+
+template<size_t I>
+MeowObject* extractObject(const Value& value) noexcept {
+    using Alternative = std::variant_alternative_t<I, BaseValue>;
+    if constexpr (std::is_pointer_v<Alternative> &&
+                  std::is_base_of_v<MeowObject, std::remove_pointer_t<Alternative>>) {
+        return *std::get_if<I>(static_cast<const BaseValue*>(&value));
+    } else {
+        return nullptr;
+    }
+}
+
+template<size_t... Is>
+constexpr std::array<ObjectExtractor, sizeof...(Is)> makeObjectExtractors(std::index_sequence<Is...>) {
+    return { &extractObject<Is>... };
+}
+
+inline constexpr auto objectExtractors = makeObjectExtractors(std::make_index_sequence<std::variant_size_v<BaseValue>>{});
+
+// Object GC mà value trỏ tới, hoặc nullptr nếu value không phải object.
+inline MeowObject* valueObject(const Value& value) noexcept {
+    return objectExtractors[value.index()](value);
+}
@@ -12,5 +12,8 @@ enum class OpCode {
     BIT_AND, BIT_OR, BIT_XOR, BIT_NOT, LSHIFT, RSHIFT,
     THROW, SETUP_TRY, POP_TRY,
     IMPORT_MODULE, EXPORT, GET_EXPORT, GET_MODULE_EXPORT, IMPORT_ALL,
+    // siêu lệnh do bộ tối ưu gộp từ hai lệnh liền nhau (xem bytecode_optimizer.h)
+    JUMP_IF_LT, JUMP_IF_LE, JUMP_IF_EQ, JUMP_IF_NOT_LT, JUMP_IF_NOT_LE, JUMP_IF_NOT_EQ,
+    ADD_INT_IMM, GET_PROP_CALL, LOAD_CONST_RETURN,
     TOTAL_OPCODES
 };
\ No newline at end of file
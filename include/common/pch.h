@@ -18,6 +18,15 @@
 #include <cctype>
 #include <limits>
 #include <cmath>
+#include <bit>
+#include <chrono>
+
+// Concurrency
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
 
 // IO & Filesystem
 #include <iostream>
@@ -0,0 +1,52 @@
+#pragma once
+#include "definitions.h"
+#include "pch.h"
+
+// Định dạng .meowb.
+//
+// v1 (cũ, không có header): Int số proto, rồi từng proto với mọi số, opcode,
+// số đối số và đối số đều là Int 64 bit.
+//
+// v2:
+//   "MEOW" | u8 version | 3 byte dự trữ
+//   varint độ dài | bảng chuỗi: varint số chuỗi, mỗi chuỗi varint độ dài + byte
+//   varint độ dài | bảng proto: varint số proto, mỗi proto gồm
+//       varint tên (chỉ số chuỗi), varint numRegisters, varint numUpvalues,
+//       varint số hằng, mỗi hằng u8 tag + dữ liệu,
+//       varint số upvalue, mỗi upvalue u8 isLocal + varint index,
+//       varint độ dài | code: varint số lệnh, mỗi lệnh u8 opcode, u8 số đối số,
+//                              đối số dạng zigzag varint
+//
+// v3: như v2, nhưng bảng proto chỉ là mục lục để proto được nạp lười:
+//   varint độ dài | mục lục: varint số proto, mỗi proto gồm varint tên,
+//       varint numRegisters, varint numUpvalues, varint offset và varint độ
+//       dài thân hàm trong section thân
+//   varint độ dài | section thân: các thân hàm nối nhau, mỗi thân gồm phần
+//       hằng số, upvalue và code như v2
+//
+// v4: như v3, mỗi thân hàm thêm sau code:
+//   varint độ dài | stack map: varint số word mỗi lệnh (0 = không có bản đồ),
+//       rồi số word x số lệnh word dạng varint (xem StackMap)
+//
+// Số nguyên không âm là varint LEB128; số có dấu dùng zigzag. Mỗi section có
+// độ dài đi trước nên bộ đọc có thể kiểm tra hoặc bỏ qua cả khối.
+namespace meowb {
+
+inline constexpr char magic[4] = { 'M', 'E', 'O', 'W' };
+inline constexpr Uint8 version = 4;
+inline constexpr Uint8 minVersion = 2;
+inline constexpr size_t headerSize = sizeof(magic) + 4;
+
+enum class ConstantTag : Uint8 {
+    Null, Int, Real, Bool, String, Proto
+};
+
+inline Uint64 zigzagEncode(Int value) noexcept {
+    return (static_cast<Uint64>(value) << 1) ^ static_cast<Uint64>(value >> 63);
+}
+
+inline Int zigzagDecode(Uint64 value) noexcept {
+    return static_cast<Int>((value >> 1) ^ (~(value & 1) + 1));
+}
+
+}
@@ -3,20 +3,49 @@
 #include "pch.h"
 
 class MemoryManager;
+class ByteImage;
 
 class BinaryParser {
 public:
     std::unordered_map<Str, Proto> protos;
     BinaryParser() = default;
     Bool parseFile(const Str& filepath, MemoryManager& mm);
+    // Giải mã nội dung .meowb đã nằm sẵn trong bộ nhớ (ví dụ từ bytecode cache),
+    // bắt đầu từ offset. Với file v3 buffer được giữ lại làm nguồn cho các thân
+    // hàm chưa nạp.
+    Bool parseBuffer(std::string bytes, size_t offset, MemoryManager& mm);
 private:
+    friend class LazyBinaryBody;
+
     MemoryManager* memoryManager;
-    std::ifstream fileStream;
+    // phiên bản file đang đọc (0 với v1)
+    Uint8 formatVersion = 0;
+
+    // File được map (hoặc đọc) vào bộ nhớ một lần, rồi giải mã qua con trỏ đọc.
+    const char* cursor = nullptr;
+    const char* end = nullptr;
+
+    void require(size_t bytes) const;
+    Int readCount(size_t elementBytes);
+    Uint64 readVarint();
+    size_t readVarintCount(size_t elementBytes);
+    const char* enterSection();
+    void leaveSection(const char* sectionEnd);
 
     template<typename T>
     T read();
     Str readString();
 
+    void parseVersion1();
     void parseProto(const Str& sourceName);
     void linkProtos();
+
+    Bool parseImage(std::shared_ptr<const ByteImage> image, size_t offset, MemoryManager& mm);
+
+    void parseVersioned(const std::shared_ptr<const ByteImage>& image);
+    std::vector<Str> parseStringTable();
+    void parseProtoTableV2(const std::vector<Str>& strings);
+    void parseProtoIndexV3(const std::shared_ptr<const ByteImage>& image, std::vector<Str> strings);
+    void decodeBody(Proto proto, const std::vector<Str>& strings, std::vector<std::tuple<Proto, size_t, size_t>>& protoRefs);
+    void decodeStackMap(Proto proto);
 };
\ No newline at end of file
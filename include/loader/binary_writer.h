@@ -0,0 +1,10 @@
+#pragma once
+#include "definitions.h"
+#include "pch.h"
+
+// Ghi các proto đã parse (và link) ra định dạng .meowb v2, xem binary_format.h.
+class BinaryWriter {
+public:
+    static std::string encode(const std::unordered_map<Str, Proto>& protos);
+    static Bool writeFile(const Str& filepath, const std::unordered_map<Str, Proto>& protos);
+};
@@ -0,0 +1,49 @@
+#pragma once
+#include "definitions.h"
+#include "binary_parser.h"
+#include "pch.h"
+
+class MemoryManager;
+
+// Cache bytecode trên đĩa cho module text: lần parse đầu tiên ghi dạng nhị phân
+// (.meowb) của module vào thư mục cache, các lần chạy sau nạp thẳng từ đó
+// nếu file nguồn không đổi. Bản cache khớp khi cùng đường dẫn, kích thước,
+// mtime, hash nội dung và mức tối ưu. File được ghi ra file tạm rồi rename, nên nhiều
+// tiến trình VM có thể dùng chung một thư mục cache.
+class BytecodeCache {
+public:
+    // Thông tin nhận dạng một phiên bản của file nguồn.
+    struct SourceStamp {
+        Str path;
+        Uint64 size = 0;
+        Int64 mtime = 0;
+        Uint64 contentHash = 0;
+        // code được cache là code đã qua BytecodeOptimizer ở mức này
+        Int optimizationLevel = 0;
+    };
+
+    Bool enabled = true;
+    Str directory;
+
+    // MEOW_BYTECODE_CACHE=on|off, MEOW_BYTECODE_CACHE_DIR=thư mục.
+    static BytecodeCache fromEnvironment();
+
+    // Nhận --no-bytecode-cache và --bytecode-cache-dir=DIR; trả về false nếu
+    // không phải cờ của cache.
+    bool parseFlag(const Str& arg);
+
+    // nullopt khi cache tắt hoặc không đọc được file nguồn.
+    std::optional<SourceStamp> stamp(const Str& sourcePath, Int optimizationLevel) const;
+
+    // Có bản cache còn khớp với source hay không (không giải mã, gọi được từ luồng khác).
+    Bool contains(const SourceStamp& source) const;
+    Bool load(const SourceStamp& source, MemoryManager& mm, std::unordered_map<Str, Proto>& protos);
+    void store(const SourceStamp& source, const std::unordered_map<Str, Proto>& protos) const;
+
+private:
+    BinaryParser parser;
+
+    static Str defaultDirectory();
+    Bool readEntry(const SourceStamp& source, std::string& entry, size_t& offset) const;
+    std::filesystem::path entryPath(const Str& sourcePath) const;
+};
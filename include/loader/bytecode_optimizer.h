@@ -0,0 +1,68 @@
+#pragma once
+#include "bytecode_parser.h"
+#include "pch.h"
+
+// Mức tối ưu bytecode văn bản:
+//   0  giữ nguyên code như trong file;
+//   1  nối các lệnh nhảy (jump threading), bỏ lệnh nhảy thừa và khối không tới được,
+//      đánh số lại thanh ghi theo khoảng sống để thu nhỏ frame, rồi gộp các cặp
+//      lệnh hay gặp thành siêu lệnh;
+//   2  thêm lan truyền/gấp hằng, lan truyền bản sao và bỏ lệnh ghi chết (chỉ
+//      khi thanh ghi bị ghi đè đang giữ hằng, để không giữ object sống lâu hơn).
+struct OptimizerConfig {
+    static constexpr Int defaultLevel = 1;
+    static constexpr Int maxLevel = 2;
+
+    Int level = defaultLevel;
+
+    // MEOW_OPT_LEVEL=N
+    static OptimizerConfig fromEnvironment();
+
+    // Nhận -O0, -O1, -O2 (và -O cho mức cao nhất); trả về false nếu không phải
+    // cờ tối ưu.
+    bool parseFlag(const Str& arg);
+};
+
+// Một cặp lệnh liền nhau đã được gộp thành siêu lệnh:
+//   LT/LE/EQ r a b; JUMP_IF_FALSE/TRUE r L  ->  JUMP_IF_[NOT_]LT/LE/EQ r a b L
+//   LOAD_INT k v; ADD d a k                 ->  ADD_INT_IMM d a v k
+//   GET_PROP f o name; CALL d f s n         ->  GET_PROP_CALL d f o name s n
+//   LOAD_CONST r c; RETURN r                ->  LOAD_CONST_RETURN r c
+// Siêu lệnh vẫn ghi r/k/f như cặp gốc (thanh ghi là root của GC, bỏ một lệnh
+// ghi có thể giữ object sống lâu hơn), cái lợi là bớt một lần dispatch và đi
+// thẳng khi toán hạng là Int. Lệnh thứ hai của cặp không được là đích nhảy.
+struct FusedPair {
+    Str proto;
+    // vị trí siêu lệnh trong code đã tối ưu
+    Int index = 0;
+    OpCode first = OpCode::HALT;
+    OpCode second = OpCode::HALT;
+    OpCode fused = OpCode::HALT;
+};
+
+// Tối ưu các proto vừa parse, sau khi nhãn đã được giải. Chạy trên ParsedModule
+// nên không đụng tới heap GC và gọi được từ luồng đọc trước module.
+//
+// Mỗi proto được dựng thành đồ thị khối cơ bản (CFG). Gấp hằng dùng đúng ngữ
+// nghĩa toán tử của OperatorDispatcher, nên kết quả giống hệt khi VM tự tính.
+// Thanh ghi bị closure con bắt làm upvalue có thể đổi qua upvalue bất cứ lúc
+// nào, nên không được phân tích. Proto có đích nhảy hoặc toán hạng không hợp lệ
+// được giữ nguyên để VM báo lỗi như cũ.
+class BytecodeOptimizer {
+public:
+    // Các cặp được gộp được ghi thêm vào `fusions` nếu khác null.
+    explicit BytecodeOptimizer(Int level, std::vector<FusedPair>* fusions = nullptr) : level(level), fusions(fusions) {}
+
+    void optimize(ParsedModule& module) const;
+    void optimize(ParsedProto& proto, const ParsedModule& module) const;
+
+private:
+    Int level;
+    std::vector<FusedPair>* fusions;
+};
+
+// Điền ParsedProto::stackMap cho mọi proto của module (ở mọi mức tối ưu, sau
+// optimize vì bản đồ gắn với vị trí lệnh). Thanh ghi bị closure con bắt luôn
+// được coi là sống; proto có try, có lệnh không phân tích được hoặc quá lớn
+// thì không có bản đồ.
+void buildStackMaps(ParsedModule& module);
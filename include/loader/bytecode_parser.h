@@ -2,20 +2,60 @@
 #include "definitions.h"
 
 class MemoryManager;
+struct FusedPair;
+
+// Proto đọc từ file văn bản nhưng chưa nằm trong heap GC. Dựng được trên bất kỳ
+// luồng nào; BytecodeParser::instantiate chuyển chúng thành ObjFunctionProto.
+struct ParsedProto {
+    Str name;
+    Int numRegisters = 0;
+    Int numUpvalues = 0;
+    std::vector<Value> constantPool;
+    std::vector<UpvalueDesc> upvalueDescs;
+    std::vector<Instruction> code;
+    std::unordered_map<Str, Int> labels;
+    std::vector<std::tuple<Int, Int, Str>> pendingJumps;
+    StackMap stackMap;
+};
+
+using ParsedModule = std::unordered_map<Str, ParsedProto>;
+
+// Tên gợi nhớ của opcode như trong file văn bản.
+std::string_view opCodeName(OpCode op);
 
 class BytecodeParser {
 public:
     std::unordered_map<Str, Proto> protos;
     BytecodeParser() = default;
+    // Lỗi cú pháp được ghi ra `diagnostics` thay vì std::cerr.
+    explicit BytecodeParser(std::ostream& diagnostics) : diagnostics(&diagnostics) {}
+
     Bool parseFile(const Str& filepath, MemoryManager& mm);
+    // Chỉ đọc và kiểm tra file, không cấp phát trên heap GC; kết quả lấy bằng
+    // takeParsed(). Gọi được từ luồng khác luồng thông dịch.
+    Bool parseFile(const Str& filepath);
     Bool parseSource(const Str& source, const Str& sourceName = "<string>");
+    ParsedModule takeParsed() { return std::move(parsed); }
+
+    // Mức tối ưu chạy trên code sau khi giải nhãn (xem BytecodeOptimizer); mặc định 0.
+    void setOptimizationLevel(Int level) { optimizationLevel = level; }
+    // Ghi lại các cặp lệnh được gộp thành siêu lệnh; null để tắt.
+    void setFusionLog(std::vector<FusedPair>* log) { fusionLog = log; }
+
+    // Tạo proto trên heap GC từ kết quả parse và nối các hằng proto.
+    static std::unordered_map<Str, Proto> instantiate(ParsedModule module, MemoryManager& mm);
 private:
-    MemoryManager* memoryManager = nullptr;
-    Proto currentProto = nullptr;
-    Bool parseLine(const Str& line, const Str& sourceName, Int lineNumber);
-    Bool parseDirective(const std::vector<Str>& parts, const Str& sourceName, Int lineNumber);
-    Value parseConstValue(const Str& token);
-    std::vector<Str> split(const Str& s);
+    std::ostream* diagnostics = &std::cerr;
+    Int optimizationLevel = 0;
+    std::vector<FusedPair>* fusionLog = nullptr;
+    ParsedModule parsed;
+    ParsedProto* currentProto = nullptr;
+    // Token của dòng đang đọc, trỏ vào chuỗi nguồn.
+    std::vector<std::string_view> tokens;
+    Bool parseLine(std::string_view line, const Str& sourceName, Int lineNumber);
+    Bool parseDirective(std::string_view line, const Str& sourceName, Int lineNumber);
+    Value parseConstValue(std::string_view token);
+    void split(std::string_view s);
     void resolveAllLabels();
-    void linkProtos();
+    static void linkProtos(std::unordered_map<Str, Proto>& protos);
 };
\ No newline at end of file
@@ -0,0 +1,73 @@
+#pragma once
+#include "bytecode_parser.h"
+#include "bytecode_cache.h"
+#include "pch.h"
+
+// Số luồng đọc trước module; 0 là tắt.
+struct ModulePrefetchConfig {
+    size_t threads = defaultThreads();
+
+    // MEOW_MODULE_PREFETCH_THREADS=N
+    static ModulePrefetchConfig fromEnvironment();
+
+    // Nhận --module-prefetch-threads=N và --no-module-prefetch; trả về false nếu
+    // không phải cờ đọc trước.
+    bool parseFlag(const Str& arg);
+
+    static size_t defaultThreads();
+};
+
+// Đọc trước các module văn bản được import, trên một pool luồng nền. Khi một
+// module được parse xong, các đường dẫn IMPORT_MODULE trong bảng hằng của nó
+// được lên lịch tiếp, nên cả cây phụ thuộc được parse song song trong lúc luồng
+// thông dịch còn chạy code phía trước.
+//
+// Luồng nền chỉ tạo ParsedModule, không đụng tới heap GC. Proto được tạo trên
+// luồng thông dịch khi lệnh IMPORT_MODULE thật sự chạy tới module đó, nên thứ
+// tự nạp và thực thi module không đổi. Module parse lỗi được bỏ qua ở đây và
+// parse lại trên luồng thông dịch để báo lỗi như cũ.
+class ModulePrefetcher {
+public:
+    // Đường dẫn tuyệt đối của module văn bản mà modulePath (import từ
+    // importerPath) trỏ tới, hoặc chuỗi rỗng nếu không cần đọc trước (thư viện
+    // native). Được gọi từ nhiều luồng.
+    using Resolver = std::function<Str(const Str& modulePath, const Str& importerPath)>;
+
+    // Module được parse và tối ưu ở `optimizationLevel`, giống luồng thông dịch.
+    ModulePrefetcher(size_t threadCount, Resolver resolver, BytecodeCache cache, Int optimizationLevel);
+    ~ModulePrefetcher();
+
+    ModulePrefetcher(const ModulePrefetcher&) = delete;
+    ModulePrefetcher& operator=(const ModulePrefetcher&) = delete;
+
+    // Lên lịch đọc trước các module mà `module` import.
+    void scheduleImports(const ParsedModule& module, const Str& importerPath);
+
+    // Kết quả đọc trước của module, chờ nếu luồng nền đang parse dở. nullopt
+    // nếu module chưa được lên lịch, chưa có luồng nào nhận, đã có bản trong
+    // bytecode cache, hoặc parse lỗi; khi đó người gọi tự parse.
+    std::optional<ParsedModule> take(const Str& absolutePath);
+
+private:
+    enum class State { Queued, Parsing, Done, Taken };
+
+    struct Entry {
+        State state = State::Queued;
+        std::optional<ParsedModule> result;
+    };
+
+    Resolver resolver;
+    BytecodeCache cache;
+    Int optimizationLevel;
+
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable wakeUp;
+    std::condition_variable finished;
+    std::unordered_map<Str, Entry> entries;
+    std::deque<Str> queue;
+    bool stopping = false;
+
+    void workerLoop();
+    std::optional<ParsedModule> parse(const Str& absolutePath);
+};
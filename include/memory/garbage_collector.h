@@ -1,4 +1,5 @@
 #pragma once
+#include "gc_stats.h"
 #include "meow_object.h"
 
 class MeowVM;
@@ -6,8 +7,56 @@ class MeowVM;
 class GarbageCollector {
 public:
     virtual ~GarbageCollector() = default;
+
+    // Cấp một cell đủ chỗ cho object `size` byte; object được dựng tại chỗ
+    // rồi mới registerObject. Nếu constructor ném lỗi thì trả cell bằng releaseCell.
+    virtual void* allocate(size_t size) = 0;
+
+    virtual void releaseCell(void* cell) noexcept = 0;
     
     virtual void registerObject(MeowObject* obj) = 0;
     
-    virtual void collect(MeowVM& vm) = 0;
-};
\ No newline at end of file
+    // atSafepoint = true khi được gọi giữa hai lệnh của vòng lặp chính: mọi con
+    // trỏ tới object đều nằm trong root, nên GC được phép di chuyển object.
+    virtual void collect(MeowVM& vm, bool atSafepoint) = 0;
+
+    // Ghim object: nó được coi là root và không bị compact di chuyển chừng nào
+    // còn giữ shared_ptr trả về. Dùng khi native code giữ con trỏ thô. Object
+    // ghim nằm trong region vẫn được chuyển ra khi đóng region; khi đó GC ghi
+    // địa chỉ mới vào shared_ptr.
+    virtual std::shared_ptr<MeowObject*> pin(MeowObject* obj) = 0;
+
+    // Region: mọi object cấp phát giữa beginRegion và endRegion nằm trên trang
+    // riêng. endRegion chuyển object còn được tham chiếu từ ngoài (hoặc từ
+    // result) sang heap thường, huỷ phần còn lại và trả về số byte đã huỷ.
+    // Không hỗ trợ lồng nhau.
+    virtual void beginRegion() = 0;
+    virtual size_t endRegion(MeowVM& vm, Value& result) = 0;
+
+    // Write barrier khi region đang mở: `value` vừa được ghi vào object `owner`
+    // có sẵn. Tham chiếu từ object ngoài region vào region chỉ có thể sinh ra
+    // qua đây, nên endRegion chỉ cần duyệt root và các owner được ghi nhớ.
+    virtual void rememberStore(MeowObject* owner, const Value& value) = 0;
+
+    // Đưa object vào vùng vĩnh viễn. Mọi object nó trỏ tới qua trace() mà
+    // không nằm trong traceMutable() cũng phải vĩnh viễn.
+    virtual void makePermanent(MeowObject* obj) = 0;
+
+    // Object vĩnh viễn lớn thêm sau khi đã vào vùng vĩnh viễn (thân proto nạp
+    // lười vừa được giải mã).
+    virtual void growPermanent(size_t bytes) = 0;
+
+    // Trả mọi object vĩnh viễn về heap thường; lần mark kế tiếp quyết định
+    // object nào còn sống. Gọi khi VM bỏ môi trường cũ để chạy chương trình mới.
+    virtual void releasePermanent() = 0;
+
+    // Số byte còn sống sau lần collect gần nhất.
+    virtual size_t liveBytes() const = 0;
+
+    // Bộ nhớ heap nhìn từ hệ điều hành: chunk đang giữ, RSS, huge page.
+    virtual HeapMemoryUsage memoryUsage() const = 0;
+
+    // Thời gian mark/sweep, số object trước/sau và số object sống theo loại
+    // của lần collect gần nhất. Lý do và số byte do MemoryManager điền.
+    virtual const GCCycleStats& lastCycle() const = 0;
+};
@@ -0,0 +1,52 @@
+#pragma once
+#include "pch.h"
+
+struct GCConfig {
+    // Số luồng dùng cho pha mark/sweep. 1 = chạy tuần tự, 0 = theo số lõi CPU.
+    size_t markThreads = 1;
+    static constexpr size_t maxMarkThreads = 256;
+
+    // Heap được thu gom khi vượt quá max(minHeapBytes, live * growthFactor),
+    // không bao giờ vượt maxHeapBytes (0 = không giới hạn).
+    // Trong callback mà native gọi lại script, thu gom chỉ chạy khi native mở
+    // GCCallbackScope (map, filter, reduce, ...); với callback khác (comparator
+    // của sort, magic method, khởi tạo module) nó đợi tới khi native trả về.
+    size_t minHeapBytes = 1 << 20;
+    size_t maxHeapBytes = 0;
+    double growthFactor = 2.0;
+
+    // Lazy sweep: trang chỉ được sweep khi bộ cấp phát cần cell mới.
+    // Background sweep: trang không còn object sống được huỷ trên một luồng riêng.
+    bool lazySweep = true;
+    bool backgroundSweep = false;
+
+    // Compact: khi tỉ lệ cell trống trong các trang vượt compactThreshold,
+    // object sống được dồn về các trang đầy hơn và trang rỗng được trả lại.
+    bool compaction = false;
+    double compactThreshold = 0.5;
+
+    // Xoá thanh ghi chết theo stack map của proto trước khi quét stack, để
+    // object mà hàm không còn đọc tới không bị giữ tới khi hàm trả về.
+    bool stackMaps = true;
+
+    // Heap xin bộ nhớ theo chunk 2 MiB: xin transparent huge page cho chunk,
+    // và ưu tiên cấp chunk trên NUMA node của luồng đang chạy.
+    bool hugePages = true;
+    bool numaLocal = false;
+
+    // In thống kê GC ra stderr khi chương trình kết thúc.
+    bool printStats = false;
+
+    // Bật profiler cấp phát từ đầu và in tổng kết khi kết thúc.
+    bool allocationProfile = false;
+
+    // Nếu khác rỗng, ghi heap snapshot ra file này khi chương trình kết thúc.
+    std::string heapSnapshotPath;
+
+    static GCConfig fromEnvironment();
+
+    // Nhận các cờ dạng --gc-*; trả về false nếu không phải cờ của GC.
+    bool parseFlag(const std::string& arg);
+
+    size_t resolvedMarkThreads() const;
+};
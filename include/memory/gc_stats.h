@@ -0,0 +1,85 @@
+#pragma once
+#include "meow_object.h"
+#include "pch.h"
+
+enum class GCReason : unsigned char {
+    Allocation,  // newObject vượt ngưỡng heap
+    Growth,      // container lớn lên (trackGrowth), thu gom ở safepoint
+    Explicit,    // gọi trực tiếp, ví dụ gc.collect()
+    Region       // đóng region cấp phát
+};
+
+inline const char* gcReasonName(GCReason reason) noexcept {
+    switch (reason) {
+        case GCReason::Allocation: return "allocation";
+        case GCReason::Growth: return "growth";
+        case GCReason::Explicit: return "explicit";
+        case GCReason::Region: return "region";
+        default: return "unknown";
+    }
+}
+
+struct GCCycleStats {
+    GCReason reason = GCReason::Explicit;
+    double markMillis = 0.0;
+    double sweepMillis = 0.0;
+    double compactMillis = 0.0;
+    double pauseMillis = 0.0;
+    size_t objectsBefore = 0;
+    size_t objectsAfter = 0;
+    size_t bytesBefore = 0;
+    size_t bytesAfter = 0;
+    size_t movedObjects = 0;
+    size_t rememberedObjects = 0;  // region: owner ngoài region được write barrier ghi nhớ
+    size_t largeObjects = 0;  // object sống có dữ liệu trong large-object space
+    size_t largeBytes = 0;
+    std::array<size_t, static_cast<size_t>(ObjectType::Count)> liveObjects{};
+};
+
+// Bộ nhớ heap nhìn từ phía hệ điều hành, đọc lại mỗi lần lấy thống kê.
+struct HeapMemoryUsage {
+    size_t chunks = 0;                // số chunk 2 MiB đang giữ
+    size_t reservedBytes = 0;
+    size_t residentBytes = 0;         // phần RSS nằm trong các chunk heap
+    size_t hugePageBytes = 0;         // phần trong đó được phủ bằng transparent huge page
+    size_t processResidentBytes = 0;  // RSS của cả tiến trình
+
+    double hugePageCoverage() const noexcept {
+        return residentBytes == 0 ? 0.0 : static_cast<double>(hugePageBytes) / static_cast<double>(residentBytes);
+    }
+};
+
+struct GCStats {
+    static constexpr size_t historySize = 64;
+
+    // Cận trên (ms) của từng ô histogram; ô cuối cùng chứa các lần dừng lâu hơn.
+    static constexpr std::array<double, 8> pauseBucketLimits = { 0.1, 0.5, 1.0, 2.0, 5.0, 10.0, 50.0, 100.0 };
+
+    size_t cycles = 0;
+    double totalPauseMillis = 0.0;
+    double maxPauseMillis = 0.0;
+    size_t bytesReclaimed = 0;
+    size_t objectsReclaimed = 0;
+    size_t compactions = 0;
+    std::array<size_t, pauseBucketLimits.size() + 1> pauseHistogram{};
+    std::deque<GCCycleStats> history;
+    HeapMemoryUsage memory;
+
+    inline void record(const GCCycleStats& cycle) {
+        ++cycles;
+        totalPauseMillis += cycle.pauseMillis;
+        maxPauseMillis = std::max(maxPauseMillis, cycle.pauseMillis);
+        if (cycle.bytesBefore > cycle.bytesAfter) bytesReclaimed += cycle.bytesBefore - cycle.bytesAfter;
+        if (cycle.objectsBefore > cycle.objectsAfter) objectsReclaimed += cycle.objectsBefore - cycle.objectsAfter;
+        if (cycle.movedObjects > 0 && cycle.reason != GCReason::Region) ++compactions;
+
+        size_t bucket = 0;
+        while (bucket < pauseBucketLimits.size() && cycle.pauseMillis > pauseBucketLimits[bucket]) ++bucket;
+        ++pauseHistogram[bucket];
+
+        history.push_back(cycle);
+        if (history.size() > historySize) history.pop_front();
+    }
+
+    void printSummary(std::ostream& os) const;
+};
@@ -0,0 +1,32 @@
+#pragma once
+#include "pch.h"
+
+// Pool luồng cố định cho GC: các luồng ngủ giữa các chu kỳ thu gom để
+// không phải tạo lại thread mỗi lần collect.
+class GCWorkerPool {
+public:
+    using Task = std::function<void(size_t workerId)>;
+
+    explicit GCWorkerPool(size_t threadCount);
+    ~GCWorkerPool();
+
+    GCWorkerPool(const GCWorkerPool&) = delete;
+    GCWorkerPool& operator=(const GCWorkerPool&) = delete;
+
+    size_t size() const noexcept { return threads.size() + 1; }
+
+    // Chạy task trên mọi worker (luồng gọi là worker 0) và chờ tất cả xong.
+    void run(const Task& task);
+
+private:
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable wakeUp;
+    std::condition_variable finished;
+    const Task* currentTask = nullptr;
+    size_t generation = 0;
+    size_t pending = 0;
+    bool stopping = false;
+
+    void workerLoop(size_t workerId);
+};
@@ -0,0 +1,77 @@
+#pragma once
+#include "meow_object.h"
+#include "pch.h"
+
+// Một trang heap cỡ cố định, căn lề theo chính kích thước của nó, chia thành
+// các cell cùng cỡ. Header nằm ở đầu trang nên từ địa chỉ object có thể suy
+// ra trang chứa nó chỉ bằng một phép AND.
+class HeapPage {
+public:
+    static constexpr size_t pageSize = 64 * 1024;
+    static constexpr size_t cellAlignment = 16;
+    static constexpr size_t maxCells = pageSize / cellAlignment;
+
+    // Dựng trang trên vùng nhớ pageSize byte căn lề pageSize (do PageAllocator cấp).
+    static HeapPage* create(void* memory, size_t cellSize) noexcept;
+
+    static HeapPage* pageOf(const void* ptr) noexcept {
+        return reinterpret_cast<HeapPage*>(reinterpret_cast<uintptr_t>(ptr) & ~(uintptr_t(pageSize) - 1));
+    }
+
+    // Đặt lại trang (đã rỗng) cho một cỡ cell mới.
+    void reset(size_t newCellSize) noexcept;
+
+    size_t cellSize() const noexcept { return cellBytes; }
+    size_t cellCount() const noexcept { return cells; }
+    size_t allocatedCount() const noexcept { return allocated; }
+    bool isEmpty() const noexcept { return allocated == 0; }
+    bool hasFreeCell() const noexcept { return freeList != nullptr || bumpIndex < cells; }
+
+    void* allocateCell() noexcept;
+    void releaseCell(void* cell) noexcept;
+    void markAllocated(MeowObject* obj) noexcept;
+
+    // Bỏ object (đã được huỷ hoặc chuyển đi nơi khác) khỏi trang và trả cell về free list.
+    void forgetObject(MeowObject* obj) noexcept;
+
+    // Huỷ các object không được mark và đưa cell về free list.
+    // Trả về số object đã giải phóng.
+    size_t sweep();
+
+    // Huỷ mọi object còn trong trang, bất kể mark.
+    void destroyAll();
+
+    template<typename Fn>
+    void forEachObject(Fn&& fn) {
+        for (size_t word = 0; word < bitmapWords; ++word) {
+            uint64_t bits = allocatedBits[word];
+            while (bits != 0) {
+                size_t bit = static_cast<size_t>(std::countr_zero(bits));
+                bits &= bits - 1;
+                fn(objectAt(word * 64 + bit));
+            }
+        }
+    }
+
+    std::atomic<size_t> markedCells{0};
+    size_t permanentCells = 0;
+    bool needsSweep = false;
+    // Trang chỉ chứa object cấp phát trong region đang mở.
+    bool inRegion = false;
+
+private:
+    static constexpr size_t bitmapWords = maxCells / 64;
+
+    size_t cellBytes = 0;
+    size_t cells = 0;
+    size_t allocated = 0;
+    size_t bumpIndex = 0;
+    void* freeList = nullptr;
+    uint64_t allocatedBits[bitmapWords] = {};
+
+    explicit HeapPage(size_t cellSize) noexcept;
+
+    std::byte* firstCell() noexcept;
+    size_t indexOf(const void* cell) noexcept;
+    MeowObject* objectAt(size_t index) noexcept;
+};
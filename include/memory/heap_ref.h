@@ -0,0 +1,65 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Tham chiếu tới object nằm trong heap GC, dùng cho các field con trỏ bên trong
+// object (proto của closure, upvalue, klass, superclass, ...).
+//
+// Mặc định HeapRef<T> chỉ là T*. Khi build với MEOW_COMPRESSED_REFS, mọi trang
+// heap được cắt ra từ một vùng địa chỉ dự trữ duy nhất bắt đầu ở `base`, và
+// HeapRef chỉ lưu offset 32 bit (đơn vị 16 byte = cellAlignment) tính từ đó:
+// đủ cho 64 GiB heap, mỗi field tiết kiệm 4 byte. Base là hằng số lúc biên
+// dịch nên giải nén không cần trạng thái chung, stdlib (.so) cũng dùng được.
+#if defined(MEOW_COMPRESSED_REFS)
+
+namespace compressed_heap {
+
+#if defined(MEOW_COMPRESSED_HEAP_BASE)
+inline constexpr uintptr_t base = MEOW_COMPRESSED_HEAP_BASE;
+#else
+inline constexpr uintptr_t base = uintptr_t(0x200000000000);
+#endif
+
+inline constexpr size_t granule = 16;
+inline constexpr size_t reservedBytes = (size_t(1) << 32) * granule;
+
+}
+
+template<typename T>
+class HeapRef {
+public:
+    HeapRef() noexcept = default;
+    HeapRef(std::nullptr_t) noexcept {}
+    HeapRef(T* ptr) noexcept : bits(compress(ptr)) {}
+
+    HeapRef& operator=(T* ptr) noexcept {
+        bits = compress(ptr);
+        return *this;
+    }
+
+    T* get() const noexcept {
+        if (!bits) return nullptr;
+        return reinterpret_cast<T*>(compressed_heap::base + uintptr_t(bits) * compressed_heap::granule);
+    }
+
+    operator T*() const noexcept { return get(); }
+    T* operator->() const noexcept { return get(); }
+
+private:
+    // offset 0 là trang đầu của vùng dự trữ, không bao giờ được cấp, nên dùng làm null
+    uint32_t bits = 0;
+
+    static uint32_t compress(const T* ptr) noexcept {
+        if (!ptr) return 0;
+        return static_cast<uint32_t>((reinterpret_cast<uintptr_t>(ptr) - compressed_heap::base) / compressed_heap::granule);
+    }
+};
+
+static_assert(sizeof(HeapRef<int>) == 4);
+
+#else
+
+template<typename T>
+using HeapRef = T*;
+
+#endif
@@ -0,0 +1,32 @@
+#pragma once
+#include "meow_object.h"
+#include "pch.h"
+
+class MeowVM;
+
+// Ảnh chụp đồ thị object đang sống, đi từ root của VM. Node 0 là root ảo
+// trỏ tới mọi object root; retained size tính theo cây dominator, tức là
+// số byte sẽ được giải phóng nếu object đó không còn được tham chiếu.
+class HeapSnapshot {
+public:
+    struct Node {
+        const MeowObject* object = nullptr;
+        ObjectType type = ObjectType::Count;
+        size_t selfBytes = 0;
+        size_t retainedBytes = 0;
+        std::vector<size_t> edges;
+    };
+
+    static HeapSnapshot capture(MeowVM& vm);
+
+    const std::vector<Node>& nodes() const noexcept { return graph; }
+    size_t totalBytes() const noexcept { return graph.empty() ? 0 : graph[0].retainedBytes; }
+
+    void writeJson(std::ostream& os) const;
+    void writeToFile(const std::string& path) const;
+
+private:
+    std::vector<Node> graph;
+
+    void computeRetainedSizes();
+};
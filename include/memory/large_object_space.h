@@ -0,0 +1,83 @@
+#pragma once
+#include "pch.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#endif
+
+// Large-object space: vùng dữ liệu lớn (phần tử của mảng lớn) được map thẳng
+// từ hệ điều hành thay vì đi qua malloc. Vùng này không bao giờ bị GC di chuyển
+// (compact chỉ dời header của object) và được munmap ngay khi object chết, nên
+// bộ nhớ trả lại hệ điều hành lập tức thay vì nằm lại trong arena của malloc.
+//
+// Mọi thứ ở đây đều inline và không có trạng thái chung, vì stdlib (.so) cũng
+// cấp phát mảng nhưng không gọi được hàm của file thực thi.
+namespace large_object_space {
+
+#if defined(MEOW_LARGE_OBJECT_THRESHOLD)
+inline constexpr size_t threshold = MEOW_LARGE_OBJECT_THRESHOLD;
+#else
+inline constexpr size_t threshold = 256 * 1024;
+#endif
+
+inline constexpr size_t mappingGranularity = 4096;
+
+inline size_t mappedSize(size_t bytes) noexcept {
+    return (bytes + mappingGranularity - 1) & ~(mappingGranularity - 1);
+}
+
+inline bool isLarge(size_t bytes) noexcept {
+    return bytes >= threshold;
+}
+
+inline void* map(size_t bytes) {
+#if defined(__unix__) || defined(__APPLE__)
+    void* memory = ::mmap(nullptr, mappedSize(bytes), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) throw std::bad_alloc();
+    return memory;
+#else
+    return ::operator new(bytes);
+#endif
+}
+
+inline void unmap(void* memory, size_t bytes) noexcept {
+#if defined(__unix__) || defined(__APPLE__)
+    ::munmap(memory, mappedSize(bytes));
+#else
+    ::operator delete(memory);
+    (void)bytes;
+#endif
+}
+
+} // namespace large_object_space
+
+// Allocator cho container của object: phần nhỏ đi qua operator new như cũ,
+// phần vượt ngưỡng đi thẳng vào large-object space.
+template<typename T>
+struct LargeObjectAllocator {
+    using value_type = T;
+
+    LargeObjectAllocator() noexcept = default;
+    template<typename U>
+    LargeObjectAllocator(const LargeObjectAllocator<U>&) noexcept {}
+
+    T* allocate(size_t count) {
+        size_t bytes = count * sizeof(T);
+        if (large_object_space::isLarge(bytes)) {
+            return static_cast<T*>(large_object_space::map(bytes));
+        }
+        return static_cast<T*>(::operator new(bytes));
+    }
+
+    void deallocate(T* memory, size_t count) noexcept {
+        size_t bytes = count * sizeof(T);
+        if (large_object_space::isLarge(bytes)) {
+            large_object_space::unmap(memory, bytes);
+        } else {
+            ::operator delete(memory);
+        }
+    }
+
+    template<typename U>
+    bool operator==(const LargeObjectAllocator<U>&) const noexcept { return true; }
+};
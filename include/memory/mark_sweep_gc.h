@@ -1,30 +1,115 @@
 #pragma once
 
 #include "garbage_collector.h"
+#include "gc_config.h"
+#include "gc_worker_pool.h"
+#include "heap_page.h"
+#include "page_allocator.h"
 #include "pch.h"
 
 class MeowVM;
-
-struct GCMetadata {
-    bool isMarked = false;
-};
+class MarkWorker;
 
 class MarkSweepGC : public GarbageCollector, public GCVisitor {
 private:
-    std::unordered_map<MeowObject*, GCMetadata> metadata;
+    // Các trang cùng cỡ cell. Sau mỗi lần mark, trang [sweepCursor, end) còn
+    // chờ sweep; bộ cấp phát sweep dần từng trang khi hết cell trống.
+    struct SizeClass {
+        std::vector<HeapPage*> pages;
+        size_t sweepCursor = 0;
+        HeapPage* current = nullptr;
+        // Trang của region đang mở, cấp phát tách riêng khỏi các trang thường.
+        std::vector<HeapPage*> regionPages;
+        size_t regionCursor = 0;
+        HeapPage* regionCurrent = nullptr;
+    };
+
+    static constexpr size_t maxFreePages = 64;
+
+    GCConfig config;
+    PageAllocator pageAllocator;
+    std::vector<SizeClass> sizeClasses;
+    size_t markedBytes = 0;
+    size_t permanentBytes = 0;
+    size_t permanentCount = 0;
+    // Object vĩnh viễn còn tham chiếu thay đổi được, duyệt như root mỗi chu kỳ.
+    std::vector<MeowObject*> permanentRoots;
+    GCCycleStats cycleStats;
+    size_t rootCursor = 0;
+    std::vector<std::shared_ptr<MeowObject*>> pins;
+    bool regionActive = false;
+    // Object ngoài region (hoặc vĩnh viễn) đã được ghi tham chiếu vào region.
+    std::vector<MeowObject*> rememberedSet;
     MeowVM* vm = nullptr;
 
+    std::vector<std::unique_ptr<MarkWorker>> markWorkers;
+    std::unique_ptr<GCWorkerPool> workerPool;
+
+    // Trang rỗng để tái sử dụng và trang chết chờ luồng sweep nền huỷ.
+    std::mutex pagePoolLock;
+    std::condition_variable sweeperWake;
+    std::vector<HeapPage*> freePages;
+    std::vector<HeapPage*> deadPages;
+    bool sweeperStopping = false;
+    std::thread sweeperThread;
+
 public:
+    explicit MarkSweepGC(const GCConfig& config = GCConfig{});
     ~MarkSweepGC() override;
 
+    void* allocate(size_t size) override;
+
+    void releaseCell(void* cell) noexcept override;
+
     void registerObject(MeowObject* obj) override;
 
-    void collect(MeowVM& vmInstance) override;
+    void collect(MeowVM& vmInstance, bool atSafepoint) override;
+
+    std::shared_ptr<MeowObject*> pin(MeowObject* obj) override;
+
+    void beginRegion() override;
+
+    size_t endRegion(MeowVM& vmInstance, Value& result) override;
+
+    void rememberStore(MeowObject* owner, const Value& value) override;
+
+    void makePermanent(MeowObject* obj) override;
+
+    void growPermanent(size_t bytes) override;
+
+    void releasePermanent() override;
+
+    size_t liveBytes() const override { return markedBytes + permanentBytes; }
+
+    HeapMemoryUsage memoryUsage() const override { return pageAllocator.usage(); }
+
+    const GCCycleStats& lastCycle() const override { return cycleStats; }
 
     void visitValue(Value& value) override;
 
     void visitObject(MeowObject* obj) override;
 
+    // Ghi lại con trỏ object trong value (cùng kiểu alternative), dùng khi compact.
+    static void replaceObject(Value& value, MeowObject* obj) noexcept;
+
+    static bool tryMark(MeowObject* obj) noexcept;
+
 private:
-    void mark(MeowObject* obj);
-};
\ No newline at end of file
+    SizeClass& sizeClassFor(size_t size);
+    HeapPage* acquirePage(size_t cellSize);
+    void* allocateInRegion(SizeClass& sizeClass, size_t cellSize);
+    void mark(Value* extraRoot);
+    void fixupReferences(const std::unordered_map<MeowObject*, MeowObject*>& forwarding, Value* extraRoot);
+    void recyclePage(HeapPage* page);
+    void releasePage(HeapPage* page) noexcept;
+    void drainMarkWorker(size_t workerId, std::atomic<size_t>& idleWorkers);
+    void finishSweeping();
+    void sweepPages(const std::vector<HeapPage*>& pending);
+    void scheduleSweep();
+    void backgroundSweepLoop();
+    void drainMarkWorkers();
+    void processWeakReferences();
+    static bool isLive(const MeowObject* obj) noexcept;
+    bool shouldCompact() const;
+    size_t compact();
+};
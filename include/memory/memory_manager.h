@@ -1,43 +1,224 @@
 #pragma once
 #include "garbage_collector.h"
+#include "gc_config.h"
 #include "pch.h"
 
 class MeowVM;
+
+// Được gọi sau mỗi lần newObject thành công (dùng cho profiler cấp phát).
+class AllocationObserver {
+public:
+    virtual ~AllocationObserver() = default;
+    virtual void onAllocate(const MeowObject* obj, size_t bytes) = 0;
+};
+
 class MemoryManager {
 private:
     std::unique_ptr<GarbageCollector> gc;
     MeowVM* vm;
+    GCConfig config;
 
-    size_t gcThreshold;
-    size_t objectAllocated;
-    bool gcDisabled = false;
+    size_t heapBytes = 0;
+    size_t nextCollection;
+    size_t gcDisableDepth = 0;
+    bool collectionPending = false;
+    bool regionOpen = false;
+    GCReason pendingReason = GCReason::Allocation;
+    GCStats stats;
+    AllocationObserver* allocationObserver = nullptr;
 public:
-    MemoryManager(std::unique_ptr<GarbageCollector> gcImplement);
+    MemoryManager(std::unique_ptr<GarbageCollector> gcImplement, const GCConfig& gcConfig = GCConfig{});
 
     template<typename T, typename... Args>
     T* newObject(Args&&... args) {
-        if (objectAllocated >= gcThreshold && !gcDisabled) collect();
-        T* newObj = new T(std::forward<Args>(args)...);
+        static_assert(alignof(T) <= alignof(std::max_align_t), "MeowObject không được căn lề quá max_align_t");
+        if (heapBytes >= nextCollection) requestCollection(GCReason::Allocation);
+        void* cell = gc->allocate(sizeof(T));
+        T* newObj = nullptr;
+        try {
+            newObj = new (cell) T(std::forward<Args>(args)...);
+        } catch (...) {
+            gc->releaseCell(cell);
+            throw;
+        }
         gc->registerObject(static_cast<MeowObject*>(newObj));
-        ++objectAllocated;
+        size_t bytes = newObj->T::byteSize();
+        heapBytes += bytes;
+        if (allocationObserver) allocationObserver->onAllocate(newObj, bytes);
         return newObj;
     }
 
+    // Ghi nhận bộ nhớ mà object đã có cấp thêm (phần tử mảng, field mới...).
+    // Không collect ngay vì caller có thể đang giữ con trỏ chưa được root.
+    inline void trackGrowth(size_t bytes) noexcept {
+        heapBytes += bytes;
+        if (heapBytes >= nextCollection && !collectionPending) {
+            collectionPending = true;
+            pendingReason = GCReason::Growth;
+        }
+    }
+
     inline void enableGC() noexcept {
-        gcDisabled = false;
+        if (gcDisableDepth > 0) --gcDisableDepth;
     }
 
     inline void disableGC() noexcept {
-        gcDisabled = true;
+        ++gcDisableDepth;
+    }
+
+    inline bool isGCDisabled() const noexcept {
+        return gcDisableDepth > 0;
+    }
+
+    inline bool isCollectionPending() const noexcept {
+        return collectionPending && gcDisableDepth == 0;
+    }
+
+    inline void requestCollection(GCReason reason) {
+        if (gcDisableDepth > 0 || !vm) {
+            if (!collectionPending) pendingReason = reason;
+            collectionPending = true;
+            return;
+        }
+        collect(reason);
+    }
+
+    // Thu gom ở safepoint cho yêu cầu đã bị hoãn. allowMoving = false cho
+    // safepoint trong callback mà native gọi (xem GCCallbackScope).
+    inline void collectPending(bool allowMoving = true) {
+        collect(pendingReason, allowMoving);
     }
 
-    inline void collect() {
+    inline void collect(GCReason reason = GCReason::Explicit, bool atSafepoint = false) {
         if (!vm) return;
-        gc->collect(*vm);
-        objectAllocated = 0;
+        auto start = std::chrono::steady_clock::now();
+        size_t bytesBefore = heapBytes;
+
+        gc->collect(*vm, atSafepoint);
+        finishCycle(reason, start, bytesBefore);
+    }
+
+    // Mở region cấp phát: object tạo ra từ đây tới endRegion nằm trên trang riêng.
+    inline void beginRegion() {
+        gc->beginRegion();
+        regionOpen = true;
+    }
+
+    // Đóng region: object còn được tham chiếu (kể cả qua result) được chuyển ra
+    // heap thường, phần còn lại bị giải phóng cùng lúc. Như collect trực tiếp,
+    // caller phải bảo đảm mọi giá trị đang giữ đều nằm trong root. Heap ngoài
+    // region không được mark, nên ngưỡng collect kế tiếp giữ nguyên.
+    inline void endRegion(Value& result) {
+        if (!vm) return;
+        auto start = std::chrono::steady_clock::now();
+        size_t bytesBefore = heapBytes;
+
+        size_t freed = gc->endRegion(*vm, result);
+        regionOpen = false;
+        heapBytes -= std::min(heapBytes, freed);
+        // Yêu cầu collect sinh ra từ rác của region không còn lý do khi rác đã bị huỷ.
+        if (heapBytes < nextCollection) collectionPending = false;
+        recordCycle(GCReason::Region, start, bytesBefore);
+    }
+
+    // Write barrier: gọi sau khi ghi `value` vào object `owner` đã tồn tại
+    // (field, phần tử mảng, global, upvalue đã đóng...). Native sửa object có
+    // sẵn cũng phải gọi. Ngoài region chỉ tốn một phép so sánh.
+    inline void writeBarrier(MeowObject* owner, const Value& value) {
+        if (regionOpen) gc->rememberStore(owner, value);
+    }
+
+    inline size_t allocatedBytes() const noexcept {
+        return heapBytes;
+    }
+
+    inline const GCStats& getStats() {
+        stats.memory = gc->memoryUsage();
+        return stats;
+    }
+
+    inline std::shared_ptr<MeowObject*> pin(MeowObject* obj) {
+        return gc->pin(obj);
+    }
+
+    inline void makePermanent(MeowObject* obj) {
+        if (obj && !obj->gcPermanent) gc->makePermanent(obj);
+    }
+
+    inline void growPermanent(size_t bytes) {
+        heapBytes += bytes;
+        gc->growPermanent(bytes);
+    }
+
+    inline void releasePermanent() {
+        gc->releasePermanent();
+    }
+
+    inline void setAllocationObserver(AllocationObserver* observer) noexcept {
+        allocationObserver = observer;
     }
 
     void setVM(MeowVM* _vm) {
         vm = _vm;
     }
-};
\ No newline at end of file
+
+private:
+    inline void recordCycle(GCReason reason, std::chrono::steady_clock::time_point start, size_t bytesBefore) {
+        GCCycleStats cycle = gc->lastCycle();
+        cycle.reason = reason;
+        cycle.bytesBefore = bytesBefore;
+        cycle.bytesAfter = heapBytes;
+        cycle.pauseMillis = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        stats.record(cycle);
+    }
+
+    inline void finishCycle(GCReason reason, std::chrono::steady_clock::time_point start, size_t bytesBefore) {
+        collectionPending = false;
+        heapBytes = gc->liveBytes();
+        recordCycle(reason, start, bytesBefore);
+
+        if (config.maxHeapBytes != 0 && heapBytes >= config.maxHeapBytes) {
+            throw std::runtime_error("Hết bộ nhớ heap: " + std::to_string(heapBytes) +
+                                     " byte còn sống vượt giới hạn " + std::to_string(config.maxHeapBytes) + " byte.");
+        }
+        nextCollection = std::max(config.minHeapBytes, static_cast<size_t>(static_cast<double>(heapBytes) * config.growthFactor));
+        if (config.maxHeapBytes != 0) {
+            nextCollection = std::min(nextCollection, config.maxHeapBytes);
+        }
+    }
+};
+
+// Con trỏ tới object đã ghim, dùng khi native code (ví dụ lambda capture) cần
+// giữ object qua nhiều lệnh. Bỏ ghim khi bản sao cuối cùng bị huỷ.
+template<typename T>
+class GCPin {
+private:
+    std::shared_ptr<MeowObject*> cell;
+public:
+    GCPin() = default;
+    GCPin(MemoryManager& mm, T* obj) : cell(obj ? mm.pin(obj) : nullptr) {}
+
+    T* get() const noexcept { return cell ? static_cast<T*>(*cell) : nullptr; }
+    T* operator->() const noexcept { return get(); }
+    explicit operator bool() const noexcept { return get() != nullptr; }
+};
+
+// Mở lại GC trong lúc native gọi callback script (array.map, gc.region...), để
+// yêu cầu thu gom được phục vụ ở safepoint bên trong callback thay vì đợi native
+// trả về. Thu gom ở đó không di chuyển object. Trong scope, native phải ghim mọi
+// object mà chỉ nó giữ và không tự cấp phát object mới. Chỉ có tác dụng khi lệnh
+// CALL gọi native là lớp chặn GC duy nhất đang mở.
+class GCCallbackScope {
+private:
+    MemoryManager& mm;
+    bool reopened;
+public:
+    explicit GCCallbackScope(MemoryManager& memory) : mm(memory), reopened(memory.isGCDisabled()) {
+        if (reopened) mm.enableGC();
+    }
+    ~GCCallbackScope() {
+        if (reopened) mm.disableGC();
+    }
+    GCCallbackScope(const GCCallbackScope&) = delete;
+    GCCallbackScope& operator=(const GCCallbackScope&) = delete;
+};
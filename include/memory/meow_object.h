@@ -1,18 +1,98 @@
 #pragma once
 
+#include <atomic>
+#include <cstddef>
+#include "heap_ref.h"
+
 class Value;
 class MeowObject;
 
+enum class ObjectType : unsigned char {
+    Proto, Module, Upvalue, Closure, Class, Instance, BoundMethod, Array, Object, WeakRef, WeakMap,
+    Count
+};
+
+inline const char* objectTypeName(ObjectType type) noexcept {
+    switch (type) {
+        case ObjectType::Proto: return "Proto";
+        case ObjectType::Module: return "Module";
+        case ObjectType::Upvalue: return "Upvalue";
+        case ObjectType::Closure: return "Function";
+        case ObjectType::Class: return "Class";
+        case ObjectType::Instance: return "Instance";
+        case ObjectType::BoundMethod: return "BoundMethod";
+        case ObjectType::Array: return "Array";
+        case ObjectType::Object: return "Object";
+        case ObjectType::WeakRef: return "WeakRef";
+        case ObjectType::WeakMap: return "WeakMap";
+        default: return "Unknown";
+    }
+}
+
 class GCVisitor {
 public:
     virtual ~GCVisitor() = default;
     virtual void visitValue(Value& value) = 0;
     virtual void visitObject(MeowObject* obj) = 0;
+
+    // Khe con trỏ mà GC có thể ghi lại khi object bị di chuyển (compact).
+    // Visitor chỉ đọc không cần override, mặc định chuyển sang visitObject.
+    virtual void visitObjectSlot(MeowObject*& slot) { visitObject(slot); }
+
+    template<typename T>
+    void visitSlot(T*& slot) {
+        MeowObject* obj = slot;
+        visitObjectSlot(obj);
+        slot = static_cast<T*>(obj);
+    }
+
+#if defined(MEOW_COMPRESSED_REFS)
+    template<typename T>
+    void visitSlot(HeapRef<T>& slot) {
+        MeowObject* obj = slot.get();
+        visitObjectSlot(obj);
+        slot = static_cast<T*>(obj);
+    }
+#endif
 };
 
 class MeowObject {
 public:
+    MeowObject() = default;
+    // Move chỉ dùng khi compact: header GC của bản mới luôn bắt đầu sạch.
+    MeowObject(MeowObject&&) noexcept {}
     virtual ~MeowObject() = default;
+
+    // Object chỉ được dựng tại cell do GC cấp, qua MemoryManager::newObject.
+    // `new ObjArray()` trực tiếp sẽ không biên dịch được.
+    static void* operator new(size_t) = delete;
+    static void* operator new[](size_t) = delete;
+    static void* operator new(size_t, void* cell) noexcept { return cell; }
     
     virtual void trace(GCVisitor& visitor) = 0;
-};
\ No newline at end of file
+
+    // Chỉ các tham chiếu còn thay đổi được sau khi object vào vùng vĩnh viễn
+    // (ví dụ global của module). GC duyệt phần này thay cho trace() mỗi chu kỳ.
+    virtual void traceMutable(GCVisitor&) {}
+    virtual bool hasMutableReferences() const { return false; }
+
+    // Tham chiếu yếu: trace() bỏ qua chúng, GC chỉ duyệt phần này khi cần
+    // ghi lại địa chỉ object sau compact.
+    virtual void traceWeak(GCVisitor&) {}
+
+    // Số byte heap object đang chiếm (kể cả container và chuỗi nó sở hữu).
+    virtual size_t byteSize() const = 0;
+
+    virtual ObjectType objectType() const = 0;
+
+    // Dựng lại object (bằng move) tại cell mới và trả về bản mới; object cũ vẫn cần huỷ.
+    virtual MeowObject* relocateTo(void* cell) = 0;
+
+    // Header của GC: bit đánh dấu là atomic để nhiều luồng mark cùng lúc.
+    std::atomic<bool> gcMarked{false};
+    bool gcRegistered = false;
+    // Vùng vĩnh viễn: không bao giờ bị sweep và không được mark lại.
+    bool gcPermanent = false;
+    // Đã nằm trong remembered set của region đang mở.
+    bool gcRemembered = false;
+};
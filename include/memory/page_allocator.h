@@ -0,0 +1,50 @@
+#pragma once
+#include "heap_page.h"
+#include "gc_stats.h"
+#include "pch.h"
+
+// Nguồn bộ nhớ cho các HeapPage. Bộ nhớ được xin từ hệ điều hành theo chunk
+// 2 MiB căn lề 2 MiB rồi chia thành các trang 64 KiB, để kernel có thể phủ cả
+// chunk bằng một transparent huge page và mark/sweep ít bị TLB miss hơn. Chunk
+// có thể được gắn với NUMA node của luồng xin nó. Khi dùng tham chiếu nén, các
+// chunk được cắt ra từ vùng địa chỉ dự trữ (xem heap_ref.h).
+class PageAllocator {
+public:
+    static constexpr size_t chunkSize = 2 * 1024 * 1024;
+    static constexpr size_t pagesPerChunk = chunkSize / HeapPage::pageSize;
+
+    // Số chunk rỗng được giữ lại thay vì trả ngay cho hệ điều hành.
+    static constexpr size_t maxEmptyChunks = 1;
+
+    PageAllocator(bool hugePages, bool numaLocal);
+    ~PageAllocator();
+
+    PageAllocator(const PageAllocator&) = delete;
+    PageAllocator& operator=(const PageAllocator&) = delete;
+
+    // Vùng nhớ pageSize byte căn lề pageSize. Gọi được từ nhiều luồng.
+    void* allocate();
+    void release(void* page) noexcept;
+
+    // Số chunk đang giữ, RSS và phần nằm trên huge page (đọc từ /proc, chỉ có
+    // trên Linux). Chậm, chỉ dùng khi cần in thống kê.
+    HeapMemoryUsage usage() const;
+
+private:
+    bool hugePages;
+    bool numaLocal;
+
+    mutable std::mutex lock;
+    // địa chỉ chunk -> số trang đang được dùng
+    std::unordered_map<uintptr_t, size_t> chunks;
+    std::vector<std::byte*> freePages;
+    size_t emptyChunks = 0;
+
+    static uintptr_t chunkOf(const void* page) noexcept {
+        return reinterpret_cast<uintptr_t>(page) & ~(uintptr_t(chunkSize) - 1);
+    }
+
+    std::byte* mapChunk();
+    void unmapChunk(std::byte* chunk) noexcept;
+    void adviseChunk(std::byte* chunk) noexcept;
+};
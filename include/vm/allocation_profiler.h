@@ -0,0 +1,51 @@
+#pragma once
+#include "definitions.h"
+#include "memory_manager.h"
+#include "pch.h"
+
+class MeowVM;
+
+struct AllocationSite {
+    Str function;
+    Int ip = -1;
+    ObjectType type = ObjectType::Count;
+    size_t count = 0;
+    size_t bytes = 0;
+};
+
+// Gom các lần newObject theo vị trí cấp phát (proto đang chạy, ip, loại object).
+// Chỉ được gắn vào MemoryManager khi bật nên lúc tắt không tốn gì ngoài một phép so sánh con trỏ.
+class AllocationProfiler : public AllocationObserver {
+public:
+    explicit AllocationProfiler(const MeowVM& vm) : vm(vm) {}
+
+    void onAllocate(const MeowObject* obj, size_t bytes) override;
+
+    // Các vị trí cấp phát, sắp xếp giảm dần theo số byte.
+    std::vector<AllocationSite> summary() const;
+
+    static void printSummary(std::ostream& os, const std::vector<AllocationSite>& sites, size_t limit = 20);
+
+    void clear() { sites.clear(); }
+
+private:
+    struct SiteKey {
+        const ObjFunctionProto* proto;
+        Int ip;
+        ObjectType type;
+        bool operator==(const SiteKey& other) const noexcept {
+            return proto == other.proto && ip == other.ip && type == other.type;
+        }
+    };
+
+    struct SiteKeyHash {
+        size_t operator()(const SiteKey& key) const noexcept {
+            size_t h = std::hash<const void*>{}(key.proto);
+            h ^= std::hash<Int>{}(key.ip) + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+            return h ^ static_cast<size_t>(key.type);
+        }
+    };
+
+    const MeowVM& vm;
+    std::unordered_map<SiteKey, AllocationSite, SiteKeyHash> sites;
+};
@@ -0,0 +1,53 @@
+#pragma once
+#include "definitions.h"
+#include "pch.h"
+
+class MeowVM;
+
+// Heap image (.meowi): môi trường đã khởi tạo của VM gồm module native, thư
+// viện chuẩn nạp sẵn, các module script đã import cùng những object mà global/
+// export của chúng giữ. Lần chạy ngắn boot từ image thay vì dò đường dẫn, parse
+// và chạy lại các module đó.
+//
+// Không chép nguyên trang heap được: hàm native là std::function giữ con trỏ
+// vào VM hoặc vào thư viện, và thư viện phải được dlopen lại trong mỗi tiến
+// trình. Image vì vậy lưu:
+//   - thư viện native theo thứ tự nạp cùng đường dẫn tuyệt đối đã giải, khi
+//     boot chỉ còn dlopen và gọi CreateMeowModule. Nếu không giá trị nào của
+//     image trỏ vào thư viện, việc dlopen (phần tốn nhất khi khởi động) được
+//     hoãn tới lần import module mới hoặc tra method dựng sẵn đầu tiên;
+//   - proto của mỗi module script dạng .meowb (thân hàm vẫn được nạp lười);
+//   - bảng object, tham chiếu giữa các object là chỉ số trong bảng và được đổi
+//     thành con trỏ sau khi mọi object đã được cấp phát;
+//   - giá trị thuộc module native (hàm, class do thư viện tạo) dạng ký hiệu
+//     (module, global/export, tên) hoặc (kiểu, method/getter, tên), được gắn
+//     với giá trị mới mà thư viện tạo ra khi boot.
+//
+// Module entry của lần chạy ghi image không vào cache của image, nên dùng lại
+// được chính script đó làm entry khi boot. Image là ảnh chụp: file .meow đổi
+// thì phải ghi lại image. Trạng thái bên trong thư viện native, WeakRef/WeakMap
+// và hàm native không thuộc module nào thì không ghi được.
+//
+// Bố cục (số nguyên là varint như .meowb, chuỗi là varint độ dài + byte):
+//   "MWI1"
+//   module:    varint số module, mỗi module u8 loại rồi
+//                native (0): không có gì
+//                thư viện (1): tên trong import, đường dẫn, u8 nạp ngay
+//                script (2): tên, đường dẫn, u8 cờ, varint độ dài + nội dung .meowb
+//   ký hiệu:   varint số ký hiệu, mỗi ký hiệu u8 loại, chủ (chỉ số module hoặc
+//              tên kiểu), tên
+//   object:    varint số object, mỗi object u8 ObjectType (closure thêm giá
+//              trị proto), rồi thân từng object theo cùng thứ tự
+//   global:    với mỗi module script: globals rồi exports (varint số cặp, tên + giá trị)
+//   cache:     varint số khoá, mỗi khoá chuỗi + varint chỉ số module
+// Giá trị là u8 tag rồi dữ liệu; object, module, proto và ký hiệu được ghi
+// bằng chỉ số.
+class HeapImage {
+public:
+    static void write(MeowVM& vm, const Str& path);
+    static void load(MeowVM& vm, const Str& path);
+
+private:
+    class Writer;
+    class Reader;
+};
@@ -2,6 +2,7 @@
 
 #include "value.h"
 #include "memory_manager.h"
+#include "allocation_profiler.h"
 
 class MeowEngine {
 public:
@@ -9,6 +10,11 @@ public:
 
     virtual Value call(const Value& callee, Arguments args) = 0;
 
+    // Gọi callee trong một region cấp phát: mọi object tạo ra trong lúc gọi
+    // được giải phóng cùng lúc khi trả về, trừ những object đã thoát ra ngoài
+    // (gán vào global, object sống lâu hơn, hoặc nằm trong giá trị trả về).
+    virtual Value callInRegion(const Value& callee, Arguments args) = 0;
+
     virtual MemoryManager* getMemoryManager() = 0;
 
     virtual void registerMethod(const Str& typeName, const Str& methodName, const Value& method) = 0;
@@ -16,4 +22,19 @@ public:
     virtual void registerGetter(const Str& typeName, const Str& propName, const Value& getter) = 0;
 
     virtual const std::vector<Str>& getArguments() const = 0;
+
+    virtual const GCStats& getGCStats() const = 0;
+
+    // Yêu cầu thu gom. Chạy ngay nếu không có GCScopeGuard nào đang mở, ngược
+    // lại hoãn tới safepoint kế tiếp của vòng lặp chính, nên native (và callback
+    // script mà native gọi) không cần root các giá trị tạm đang giữ.
+    virtual void collectGarbage() = 0;
+
+    // Ghi heap snapshot (JSON) của các object đang sống ra file.
+    virtual void writeHeapSnapshot(const Str& path) = 0;
+
+    virtual void setAllocationProfiling(bool enabled) = 0;
+
+    // Vị trí cấp phát đã ghi nhận từ khi bật profiler, giảm dần theo số byte.
+    virtual std::vector<AllocationSite> getAllocationSites() const = 0;
 };
\ No newline at end of file
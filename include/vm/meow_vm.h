@@ -1,9 +1,13 @@
 #pragma once
 #include "definitions.h"
 #include "bytecode_parser.h"
+#include "bytecode_optimizer.h"
 #include "binary_parser.h"
+#include "bytecode_cache.h"
+#include "module_prefetcher.h"
 #include "operator_dispatcher.h"
 #include "memory_manager.h"
+#include "gc_config.h"
 #include "meow_engine.h"
 #include "pch.h"
 
@@ -23,12 +27,35 @@ public:
 struct GCVisitor;
 
 class MeowVM: public MeowEngine {
+    friend class HeapImage;
 public:
-    MeowVM(const Str& entryPointDir);
-    MeowVM(const Str& entryPointDir, int argc, char* argv[]);
+    MeowVM(const Str& entryPointDir, const GCConfig& gcConfig = GCConfig{});
+    MeowVM(const Str& entryPointDir, int argc, char* argv[], const GCConfig& gcConfig = GCConfig{});
     void interpret(const Str& entryPath, Bool isBinary);
     std::vector<Value*> findRoots();
     void traceRoots(GCVisitor&);
+    // Chỉ pha mark của GC gọi, ngay trước traceRoots: visitor chỉ đọc
+    // (snapshot, sửa con trỏ sau compact, ghi image) không được xoá thanh ghi.
+    void clearDeadRegisters();
+
+    const GCStats& getGCStats() const override { return memoryManager->getStats(); }
+    void collectGarbage() override { memoryManager->requestCollection(GCReason::Explicit); }
+    void writeHeapSnapshot(const Str& path) override;
+    void setAllocationProfiling(bool enabled) override;
+    std::vector<AllocationSite> getAllocationSites() const override;
+
+    // Ghi module đã nạp (và heap mà global/export của chúng giữ) ra heap image,
+    // hoặc dựng môi trường từ image thay cho bước khởi tạo của lần interpret
+    // kế tiếp. Xem heap_image.h.
+    void writeHeapImage(const Str& path);
+    void loadHeapImage(const Str& path);
+
+    void setBytecodeCache(BytecodeCache cache) { bytecodeCache = std::move(cache); }
+    void setModulePrefetch(const ModulePrefetchConfig& config) { modulePrefetchConfig = config; }
+    void setOptimizer(const OptimizerConfig& config) { optimizerConfig = config; }
+
+    // Proto và ip của lệnh đang chạy (nullptr, -1 nếu không có frame nào).
+    std::pair<const ObjFunctionProto*, Int> currentSite() const;
 
 private:
     std::vector<CallFrame> callStack;
@@ -36,15 +63,33 @@ private:
     std::vector<Upvalue> openUpvalues;
     std::vector<Str> commandLineArgs;
     std::unordered_map<Str, Module> moduleCache;
+    // Thư viện native đã dlopen theo thứ tự nạp: tên trong import -> đường dẫn tuyệt đối.
+    std::vector<std::pair<Str, Str>> nativeLibraries;
+    // Thư viện trong heap image mà không giá trị nào của image cần tới: chỉ được
+    // dlopen khi chương trình import module chưa có trong cache hoặc tra method
+    // dựng sẵn (builtin) lần đầu.
+    std::vector<std::pair<Str, Str>> deferredLibraries;
+    // Module entry của lần interpret gần nhất (không được ghi vào cache của heap image).
+    Module entryModule = nullptr;
+    // Môi trường (module native, stdlib nạp sẵn) đã được dựng cho lần interpret kế tiếp.
+    Bool environmentReady = false;
     std::unordered_map<Module, std::unordered_map<Str, Value>> moduleGlobals;
     std::unordered_map<Str, std::unordered_map<Str, Value>> builtinMethods;
     std::unordered_map<Str, std::unordered_map<Str, Value>> builtinGetters;
+    // Chỉ duyệt builtin khi có giá trị không phải hàm native (hàm native không phải object GC).
+    Bool builtinsNeedTracing = false;
     
     std::vector<ExceptionHandler> exceptionHandlers;
     BytecodeParser textParser;
     BinaryParser binaryParser;
+    BytecodeCache bytecodeCache;
+    ModulePrefetchConfig modulePrefetchConfig;
+    OptimizerConfig optimizerConfig;
+    // Tạo khi module văn bản đầu tiên có import được parse.
+    std::unique_ptr<ModulePrefetcher> modulePrefetcher;
     OperatorDispatcher opDispatcher;
     std::unique_ptr<MemoryManager> memoryManager;
+    std::unique_ptr<AllocationProfiler> allocationProfiler;
     Str entryPointDir;
 
     using OpCodeHandler = void (MeowVM::*)();
@@ -54,8 +99,19 @@ private:
     const Instruction* currentInst = nullptr;
     Int currentBase = 0;
 
+    // Xoá thanh ghi chết theo stack map trước khi quét stack (GCConfig::stackMaps).
+    Bool useStackMaps = true;
+    // true khi GC chạy ở safepoint của run() hoặc của vòng lặp trong call(): frame
+    // trên cùng chưa bắt đầu lệnh ip.
+    Bool collectingAtSafepoint = false;
+
+    void resetEnvironment();
     void defineNativeFunctions();
+    void defineNativeModule();
+    Module loadNativeLibrary(const Str& modulePath, const Str& libPath);
+    void loadDeferredLibraries();
     Module _getOrLoadModule(const Str& modulePath, const Str& importerPath, Bool isBinary);
+    void prefetchImports(const ParsedModule& module, const Str& importerPath);
     void run();
     void initializeJumpTable();
     void _handleRuntimeException(const VMError& e);
@@ -65,12 +121,16 @@ private:
 
     MemoryManager* getMemoryManager() override { return this->memoryManager.get(); }
     Value call(const Value& callee, Arguments args) override;
+    Value callInRegion(const Value& callee, Arguments args) override;
     void registerMethod(const Str& typeName, const Str& methodName, const Value& method) override;
     void registerGetter(const Str& typeName, const Str& propName, const Value& getter) override;
     const std::vector<Str>& getArguments() const override { return commandLineArgs; }
 
     Function wrapClosure(const Value& maybeCallable);
+    void setField(MeowObject* owner, std::unordered_map<Str, Value>& fields, const Str& key, const Value& value);
     std::optional<Value> getMagicMethod(const Value& obj, const Str& name);
+    // Thân của GET_PROP, dùng chung với GET_PROP_CALL.
+    void getProperty(Int dst, Int objReg, Int nameIdx);
     
     void opMove();
     void opLoadConst();
@@ -113,6 +173,10 @@ private:
     void opSetupTry();
     void opPopTry();
     void opThrow();
+    void opCompareJump();
+    void opAddIntImm();
+    void opGetPropCall();
+    void opLoadConstReturn();
     void opUnsupported();
 
     Bool isNull(const Value& v) const;
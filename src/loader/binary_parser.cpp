@@ -1,51 +1,424 @@
 #include "binary_parser.h"
 #include "memory_manager.h"
+#include "binary_format.h"
+
+#include <cstring>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Vùng byte chứa nội dung một file .meowb. Với file v3 vùng này được giữ lại
+// (chia sẻ giữa các proto) cho tới khi mọi thân hàm đã được giải mã.
+class ByteImage {
+public:
+    virtual ~ByteImage() = default;
+    virtual const char* data() const noexcept = 0;
+    virtual size_t size() const noexcept = 0;
+};
+
+namespace {
+
+// Toàn bộ nội dung file: mmap chỉ đọc trên POSIX, nếu không được thì đọc một
+// lần vào buffer.
+class FileBytes : public ByteImage {
+public:
+    explicit FileBytes(const Str& path) {
+#if defined(__unix__) || defined(__APPLE__)
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return;
+        struct stat info {};
+        if (fstat(fd, &info) == 0 && info.st_size > 0) {
+            void* mapping = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapping != MAP_FAILED) {
+                mapped = mapping;
+                bytes = static_cast<const char*>(mapping);
+                length = static_cast<size_t>(info.st_size);
+                opened = true;
+            }
+        }
+        ::close(fd);
+        if (opened) return;
+#endif
+        std::ifstream in(path, std::ios::binary);
+        if (!in) return;
+        buffer.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        bytes = buffer.data();
+        length = buffer.size();
+        opened = true;
+    }
+
+    ~FileBytes() override {
+#if defined(__unix__) || defined(__APPLE__)
+        if (mapped) munmap(mapped, length);
+#endif
+    }
+
+    FileBytes(const FileBytes&) = delete;
+    FileBytes& operator=(const FileBytes&) = delete;
+
+    bool isOpen() const noexcept { return opened; }
+    const char* data() const noexcept override { return bytes; }
+    size_t size() const noexcept override { return length; }
+
+private:
+    bool opened = false;
+    void* mapped = nullptr;
+    const char* bytes = nullptr;
+    size_t length = 0;
+    std::vector<char> buffer;
+};
+
+class StringBytes : public ByteImage {
+public:
+    explicit StringBytes(std::string bytes) : bytes(std::move(bytes)) {}
+
+    const char* data() const noexcept override { return bytes.data(); }
+    size_t size() const noexcept override { return bytes.size(); }
+
+private:
+    std::string bytes;
+};
+
+// Những gì thân hàm v3 cần khi được giải mã: vùng byte, bảng chuỗi và bảng
+// proto (để nối hằng proto).
+struct LazyBinaryFile {
+    MemoryManager* memoryManager = nullptr;
+    Uint8 version = 0;
+    std::shared_ptr<const ByteImage> image;
+    std::vector<Str> strings;
+    std::vector<Proto> table;
+};
+
+}
+
+class LazyBinaryBody : public LazyProtoBody {
+public:
+    LazyBinaryBody(std::shared_ptr<LazyBinaryFile> file, const char* begin, const char* end)
+        : file(std::move(file)), begin(begin), end(end) {}
+
+    void load(ObjFunctionProto& proto) override {
+        size_t bytesBefore = proto.byteSize();
+        BinaryParser parser;
+        parser.formatVersion = file->version;
+        parser.cursor = begin;
+        parser.end = end;
+        std::vector<std::tuple<Proto, size_t, size_t>> protoRefs;
+        try {
+            parser.decodeBody(&proto, file->strings, protoRefs);
+            if (parser.cursor != end) throw std::runtime_error("Độ dài thân hàm không khớp với nội dung.");
+            for (const auto& [owner, slot, index] : protoRefs) {
+                if (index >= file->table.size()) throw std::runtime_error("Hằng proto trỏ ra ngoài bảng proto.");
+                owner->constantPool[slot] = Value(file->table[index]);
+            }
+        } catch (const std::exception& e) {
+            proto.constantPool.clear();
+            proto.upvalueDescs.clear();
+            proto.code.clear();
+            proto.stackMap = StackMap{};
+            throw std::runtime_error("Không nạp được thân hàm '" + proto.sourceName + "': " + e.what());
+        }
+        // Proto vĩnh viễn đã được tính byte lúc còn là stub.
+        if (proto.gcPermanent) file->memoryManager->growPermanent(proto.byteSize() - bytesBefore);
+    }
+
+    // Bảng proto bình thường nằm trong vùng vĩnh viễn; sau khi VM trả vùng đó
+    // về heap thường (resetEnvironment) nó phải được duyệt và sửa khi compact.
+    void trace(GCVisitor& visitor) override {
+        for (Proto& proto : file->table) {
+            visitor.visitSlot(proto);
+        }
+    }
+
+private:
+    std::shared_ptr<LazyBinaryFile> file;
+    const char* begin;
+    const char* end;
+};
 
 Bool BinaryParser::parseFile(const Str& filepath, MemoryManager& mm) {
-    this->memoryManager = &mm;
-    fileStream.open(filepath, std::ios::binary);
-    if (!fileStream.is_open()) {
+    auto file = std::make_shared<FileBytes>(filepath);
+    if (!file->isOpen()) {
         std::cerr << "Lỗi: Không thể mở file nhị phân: " << filepath << std::endl;
         return false;
     }
+    return parseImage(std::move(file), 0, mm);
+}
+
+Bool BinaryParser::parseBuffer(std::string bytes, size_t offset, MemoryManager& mm) {
+    return parseImage(std::make_shared<StringBytes>(std::move(bytes)), offset, mm);
+}
+
+Bool BinaryParser::parseImage(std::shared_ptr<const ByteImage> image, size_t offset, MemoryManager& mm) {
+    this->memoryManager = &mm;
     protos.clear();
+    formatVersion = 0;
+    offset = std::min(offset, image->size());
+    cursor = image->data() + offset;
+    end = image->data() + image->size();
 
     try {
-        Int numProtos = read<Int>();
-        for (Int i = 0; i < numProtos; ++i) {
-            Str protoName = readString();
-            parseProto(protoName);
-        }
-        linkProtos();
+        // v1 không có header, bắt đầu ngay bằng số proto.
+        bool hasHeader = static_cast<size_t>(end - cursor) >= sizeof(meowb::magic) &&
+                         std::memcmp(cursor, meowb::magic, sizeof(meowb::magic)) == 0;
+        if (hasHeader) parseVersioned(image);
+        else parseVersion1();
     } catch (const std::exception& e) {
         std::cerr << "Lỗi đọc file nhị phân: " << e.what() << std::endl;
-        fileStream.close();
+        cursor = end = nullptr;
         return false;
     }
 
-    fileStream.close();
+    cursor = end = nullptr;
     this->memoryManager = nullptr;
     return true;
 }
 
+void BinaryParser::parseVersion1() {
+    Int numProtos = readCount(sizeof(Int));
+    for (Int i = 0; i < numProtos; ++i) {
+        Str protoName = readString();
+        parseProto(protoName);
+    }
+    linkProtos();
+}
+
+void BinaryParser::parseVersioned(const std::shared_ptr<const ByteImage>& image) {
+    cursor += sizeof(meowb::magic);
+    Uint8 version = read<Uint8>();
+    if (version < meowb::minVersion || version > meowb::version) {
+        throw std::runtime_error("Phiên bản .meowb không được hỗ trợ: " + std::to_string(version));
+    }
+    formatVersion = version;
+    require(meowb::headerSize - sizeof(meowb::magic) - 1);
+    cursor += meowb::headerSize - sizeof(meowb::magic) - 1;
+
+    std::vector<Str> strings = parseStringTable();
+    if (version == 2) parseProtoTableV2(strings);
+    else parseProtoIndexV3(image, std::move(strings));
+    if (cursor != end) throw std::runtime_error("Dữ liệu thừa ở cuối file.");
+}
+
+std::vector<Str> BinaryParser::parseStringTable() {
+    const char* sectionEnd = enterSection();
+    std::vector<Str> strings(readVarintCount(1));
+    for (Str& s : strings) {
+        size_t size = readVarintCount(1);
+        s.assign(cursor, size);
+        cursor += size;
+    }
+    leaveSection(sectionEnd);
+    return strings;
+}
+
+void BinaryParser::parseProtoTableV2(const std::vector<Str>& strings) {
+    // Hằng proto có thể trỏ tới proto đứng sau, nên được nối sau khi đọc hết.
+    std::vector<std::tuple<Proto, size_t, size_t>> protoRefs;
+    const char* sectionEnd = enterSection();
+    std::vector<Proto> table(readVarintCount(1));
+    for (Proto& proto : table) {
+        Uint64 nameIndex = readVarint();
+        if (nameIndex >= strings.size()) throw std::runtime_error("Chỉ số chuỗi nằm ngoài bảng chuỗi.");
+        proto = memoryManager->newObject<ObjFunctionProto>();
+        proto->sourceName = strings[nameIndex];
+        proto->numRegisters = static_cast<Int>(readVarint());
+        proto->numUpvalues = static_cast<Int>(readVarint());
+        decodeBody(proto, strings, protoRefs);
+    }
+    leaveSection(sectionEnd);
+
+    for (const auto& [proto, slot, index] : protoRefs) {
+        if (index >= table.size()) throw std::runtime_error("Hằng proto trỏ ra ngoài bảng proto.");
+        proto->constantPool[slot] = Value(table[index]);
+    }
+    // Proto trùng tên bị che trong `protos` nhưng hằng proto vẫn trỏ tới nó,
+    // nên cả bảng vào vùng vĩnh viễn chứ không chỉ những proto có tên.
+    for (Proto proto : table) {
+        memoryManager->makePermanent(proto);
+        protos[proto->sourceName] = proto;
+    }
+}
+
+// v3, v4: chỉ đọc mục lục; mỗi proto là một stub giữ vị trí thân hàm của nó, thân
+// hàm được giải mã khi closure đầu tiên được tạo (xem ObjFunctionProto::materialize).
+void BinaryParser::parseProtoIndexV3(const std::shared_ptr<const ByteImage>& image, std::vector<Str> strings) {
+    struct IndexEntry {
+        Proto proto;
+        size_t offset;
+        size_t length;
+    };
+
+    auto file = std::make_shared<LazyBinaryFile>();
+    file->memoryManager = memoryManager;
+    file->version = formatVersion;
+    file->image = image;
+    file->strings = std::move(strings);
+
+    std::vector<IndexEntry> entries;
+    const char* sectionEnd = enterSection();
+    entries.resize(readVarintCount(5));
+    file->table.reserve(entries.size());
+    for (IndexEntry& entry : entries) {
+        Uint64 nameIndex = readVarint();
+        if (nameIndex >= file->strings.size()) throw std::runtime_error("Chỉ số chuỗi nằm ngoài bảng chuỗi.");
+        entry.proto = memoryManager->newObject<ObjFunctionProto>();
+        entry.proto->sourceName = file->strings[nameIndex];
+        entry.proto->numRegisters = static_cast<Int>(readVarint());
+        entry.proto->numUpvalues = static_cast<Int>(readVarint());
+        entry.offset = static_cast<size_t>(readVarint());
+        entry.length = static_cast<size_t>(readVarint());
+        file->table.push_back(entry.proto);
+    }
+    leaveSection(sectionEnd);
+
+    sectionEnd = enterSection();
+    const char* bodies = cursor;
+    size_t bodiesSize = static_cast<size_t>(sectionEnd - bodies);
+    cursor = sectionEnd;
+
+    for (const IndexEntry& entry : entries) {
+        if (entry.offset > bodiesSize || entry.length > bodiesSize - entry.offset) {
+            throw std::runtime_error("Thân hàm của '" + entry.proto->sourceName + "' nằm ngoài section thân.");
+        }
+        const char* begin = bodies + entry.offset;
+        entry.proto->lazyBody = std::make_unique<LazyBinaryBody>(file, begin, begin + entry.length);
+        // Như v2: bảng của thân nạp lười giữ con trỏ thô tới mọi proto, kể cả
+        // proto trùng tên không có trong `protos`.
+        memoryManager->makePermanent(entry.proto);
+        protos[entry.proto->sourceName] = entry.proto;
+    }
+}
+
+// Phần thân một proto (dùng chung cho mọi bản có header): hằng số, upvalue,
+// code, và từ v4 là stack map.
+void BinaryParser::decodeBody(Proto proto, const std::vector<Str>& strings, std::vector<std::tuple<Proto, size_t, size_t>>& protoRefs) {
+    auto stringAt = [&strings](Uint64 index) -> const Str& {
+        if (index >= strings.size()) throw std::runtime_error("Chỉ số chuỗi nằm ngoài bảng chuỗi.");
+        return strings[index];
+    };
+
+    size_t numConstants = readVarintCount(1);
+    proto->constantPool.reserve(numConstants);
+    for (size_t i = 0; i < numConstants; ++i) {
+        switch (static_cast<meowb::ConstantTag>(read<Uint8>())) {
+            case meowb::ConstantTag::Null: proto->constantPool.push_back(Value(Null{})); break;
+            case meowb::ConstantTag::Int: proto->constantPool.push_back(Value(meowb::zigzagDecode(readVarint()))); break;
+            case meowb::ConstantTag::Real: proto->constantPool.push_back(Value(read<Real>())); break;
+            case meowb::ConstantTag::Bool: proto->constantPool.push_back(Value(read<Uint8>() != 0)); break;
+            case meowb::ConstantTag::String: proto->constantPool.push_back(Value(stringAt(readVarint()))); break;
+            case meowb::ConstantTag::Proto:
+                protoRefs.emplace_back(proto, i, readVarint());
+                proto->constantPool.push_back(Value(Null{}));
+                break;
+            default:
+                throw std::runtime_error("Kiểu hằng số không hợp lệ.");
+        }
+    }
+
+    size_t numUpvalues = readVarintCount(2);
+    proto->upvalueDescs.reserve(numUpvalues);
+    for (size_t i = 0; i < numUpvalues; ++i) {
+        Bool isLocal = read<Uint8>() != 0;
+        Int index = static_cast<Int>(readVarint());
+        proto->upvalueDescs.emplace_back(isLocal, index);
+    }
+
+    const char* codeEnd = enterSection();
+    size_t numInstructions = readVarintCount(2);
+    proto->code.reserve(numInstructions);
+    for (size_t i = 0; i < numInstructions; ++i) {
+        Uint8 opcode = read<Uint8>();
+        if (opcode >= static_cast<Uint8>(OpCode::TOTAL_OPCODES)) throw std::runtime_error("Opcode không hợp lệ.");
+        Uint8 numArgs = read<Uint8>();
+        std::vector<Int> args(numArgs);
+        for (Int& arg : args) arg = meowb::zigzagDecode(readVarint());
+        proto->code.emplace_back(static_cast<OpCode>(opcode), std::move(args));
+    }
+    leaveSection(codeEnd);
+
+    if (formatVersion >= 4) decodeStackMap(proto);
+}
+
+// Bản đồ không khớp với số thanh ghi hay số lệnh là file hỏng, vì GC sẽ xoá
+// thanh ghi theo nó.
+void BinaryParser::decodeStackMap(Proto proto) {
+    const char* sectionEnd = enterSection();
+    size_t wordsPerEntry = readVarintCount(1);
+    if (wordsPerEntry != 0) {
+        size_t registers = static_cast<size_t>(std::max<Int>(proto->numRegisters, 0));
+        if (wordsPerEntry != (registers + 63) / 64) throw std::runtime_error("Stack map không khớp số thanh ghi.");
+        size_t count = proto->code.size() * wordsPerEntry;
+        if (count > static_cast<size_t>(sectionEnd - cursor)) throw std::runtime_error("Stack map không khớp số lệnh.");
+        proto->stackMap.wordsPerEntry = wordsPerEntry;
+        proto->stackMap.bits.resize(count);
+        for (Uint64& word : proto->stackMap.bits) word = readVarint();
+    }
+    leaveSection(sectionEnd);
+}
+
+void BinaryParser::require(size_t bytes) const {
+    if (static_cast<size_t>(end - cursor) < bytes) {
+        throw std::runtime_error("Lỗi đọc file, file không đúng định dạng hoặc kết thúc đột ngột.");
+    }
+}
+
+// Đọc số phần tử, kiểm tra luôn rằng phần còn lại của file đủ chứa chừng ấy
+// phần tử (mỗi phần tử ít nhất elementBytes byte) trước khi reserve.
+Int BinaryParser::readCount(size_t elementBytes) {
+    Int count = read<Int>();
+    if (count < 0 || static_cast<size_t>(count) > static_cast<size_t>(end - cursor) / elementBytes) {
+        throw std::runtime_error("Số phần tử không hợp lệ, file không đúng định dạng hoặc kết thúc đột ngột.");
+    }
+    return count;
+}
+
+Uint64 BinaryParser::readVarint() {
+    Uint64 value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        require(1);
+        auto byte = static_cast<Uint8>(*cursor++);
+        value |= static_cast<Uint64>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) return value;
+    }
+    throw std::runtime_error("Varint quá dài, file không đúng định dạng.");
+}
+
+size_t BinaryParser::readVarintCount(size_t elementBytes) {
+    Uint64 count = readVarint();
+    if (count > static_cast<size_t>(end - cursor) / elementBytes) {
+        throw std::runtime_error("Số phần tử không hợp lệ, file không đúng định dạng hoặc kết thúc đột ngột.");
+    }
+    return static_cast<size_t>(count);
+}
+
+// Section v2: độ dài varint rồi nội dung; trả về vị trí kết thúc để kiểm tra
+// sau khi đọc xong.
+const char* BinaryParser::enterSection() {
+    size_t length = readVarintCount(1);
+    return cursor + length;
+}
+
+void BinaryParser::leaveSection(const char* sectionEnd) {
+    if (cursor != sectionEnd) throw std::runtime_error("Độ dài section không khớp với nội dung.");
+}
+
 template<typename T>
 T BinaryParser::read() {
+    require(sizeof(T));
     T value;
-    fileStream.read(reinterpret_cast<char*>(&value), sizeof(T));
-    if (fileStream.gcount() != sizeof(T)) {
-        throw std::runtime_error("Lỗi đọc file, file không đúng định dạng hoặc kết thúc đột ngột.");
-    }
+    std::memcpy(&value, cursor, sizeof(T));
+    cursor += sizeof(T);
     return value;
 }
 
 Str BinaryParser::readString() {
-    Int size = read<Int>();
-    std::vector<char> buffer(size);
-    fileStream.read(buffer.data(), size);
-    if (fileStream.gcount() != size) {
-        throw std::runtime_error("Lỗi đọc chuỗi, file không đúng định dạng hoặc kết thúc đột ngột.");
-    }
-    return Str(buffer.begin(), buffer.end());
+    Int size = readCount(1);
+    Str value(cursor, static_cast<size_t>(size));
+    cursor += size;
+    return value;
 }
 
 void BinaryParser::parseProto(const Str& sourceName) {
@@ -55,14 +428,14 @@ void BinaryParser::parseProto(const Str& sourceName) {
     proto->numRegisters = read<Int>();
     proto->numUpvalues = read<Int>();
 
-    Int numConstants = read<Int>();
+    Int numConstants = readCount(sizeof(Int));
     proto->constantPool.reserve(numConstants);
     for (Int i = 0; i < numConstants; ++i) {
         Int type = read<Int>();
         if (type == 0) proto->constantPool.push_back(Value(Null{}));
         else if (type == 1) proto->constantPool.push_back(Value(read<Int>()));
         else if (type == 2) proto->constantPool.push_back(Value(read<Real>()));
-        else if (type == 3) proto->constantPool.push_back(Value(read<Bool>()));
+        else if (type == 3) proto->constantPool.push_back(Value(read<Uint8>() != 0));
         else if (type == 4) proto->constantPool.push_back(Value(readString()));
         else if (type == 5) {
             Str protoName = readString();
@@ -72,24 +445,26 @@ void BinaryParser::parseProto(const Str& sourceName) {
         }
     }
 
-    Int numUpvalues = read<Int>();
+    Int numUpvalues = readCount(sizeof(Uint8) + sizeof(Int));
     proto->upvalueDescs.reserve(numUpvalues);
     for (Int i = 0; i < numUpvalues; ++i) {
-        Bool isLocal = read<Bool>();
+        Bool isLocal = read<Uint8>() != 0;
         Int index = read<Int>();
         proto->upvalueDescs.emplace_back(isLocal, index);
     }
 
-    Int numInstructions = read<Int>();
+    // Đối số của mỗi lệnh nằm liền nhau trong file nên được chép một lần.
+    Int numInstructions = readCount(2 * sizeof(Int));
     proto->code.reserve(numInstructions);
     for (Int i = 0; i < numInstructions; ++i) {
         Int opcode = read<Int>();
-        Int numArgs = read<Int>();
+        Int numArgs = readCount(sizeof(Int));
         std::vector<Int> args(numArgs);
-        for (Int j = 0; j < numArgs; ++j) {
-            args[j] = read<Int>();
+        if (numArgs > 0) {
+            std::memcpy(args.data(), cursor, numArgs * sizeof(Int));
+            cursor += numArgs * sizeof(Int);
         }
-        proto->code.emplace_back(static_cast<OpCode>(opcode), args);
+        proto->code.emplace_back(static_cast<OpCode>(opcode), std::move(args));
     }
     protos[sourceName] = proto;
 }
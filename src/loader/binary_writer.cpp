@@ -0,0 +1,174 @@
+#include "binary_writer.h"
+#include "binary_format.h"
+
+#include <cstring>
+
+namespace {
+
+class ByteSink {
+public:
+    std::string bytes;
+
+    void u8(Uint8 value) {
+        bytes.push_back(static_cast<char>(value));
+    }
+
+    void varint(Uint64 value) {
+        while (value >= 0x80) {
+            bytes.push_back(static_cast<char>((value & 0x7F) | 0x80));
+            value >>= 7;
+        }
+        bytes.push_back(static_cast<char>(value));
+    }
+
+    void signedVarint(Int value) {
+        varint(meowb::zigzagEncode(value));
+    }
+
+    void real(Real value) {
+        char raw[sizeof(Real)];
+        std::memcpy(raw, &value, sizeof(Real));
+        bytes.append(raw, sizeof(Real));
+    }
+
+    void raw(std::string_view data) {
+        bytes.append(data);
+    }
+
+    // Section: độ dài varint rồi nội dung.
+    void section(const ByteSink& body) {
+        varint(body.bytes.size());
+        bytes.append(body.bytes);
+    }
+};
+
+class StringTable {
+public:
+    std::vector<Str> strings;
+
+    size_t indexOf(const Str& s) {
+        auto [it, inserted] = indices.emplace(s, strings.size());
+        if (inserted) strings.push_back(s);
+        return it->second;
+    }
+
+private:
+    std::unordered_map<Str, size_t> indices;
+};
+
+}
+
+std::string BinaryWriter::encode(const std::unordered_map<Str, Proto>& protos) {
+    // Thứ tự cố định để cùng một nguồn luôn cho cùng một file.
+    std::vector<Proto> ordered;
+    ordered.reserve(protos.size());
+    for (const auto& [name, proto] : protos) ordered.push_back(proto);
+    std::sort(ordered.begin(), ordered.end(), [](Proto a, Proto b) { return a->sourceName < b->sourceName; });
+
+    std::unordered_map<const ObjFunctionProto*, size_t> protoIndices;
+    for (size_t i = 0; i < ordered.size(); ++i) protoIndices[ordered[i]] = i;
+
+    // Mục lục ghi vị trí từng thân hàm trong section thân để bộ đọc chỉ giải
+    // mã thân hàm khi proto được dùng tới.
+    StringTable strings;
+    ByteSink indexSection;
+    ByteSink bodySection;
+    indexSection.varint(ordered.size());
+    for (Proto proto : ordered) {
+        ByteSink body;
+        body.varint(proto->constantPool.size());
+        for (const Value& constant : proto->constantPool) {
+            if (constant.is<Null>()) {
+                body.u8(static_cast<Uint8>(meowb::ConstantTag::Null));
+            } else if (constant.is<Int>()) {
+                body.u8(static_cast<Uint8>(meowb::ConstantTag::Int));
+                body.signedVarint(constant.get<Int>());
+            } else if (constant.is<Real>()) {
+                body.u8(static_cast<Uint8>(meowb::ConstantTag::Real));
+                body.real(constant.get<Real>());
+            } else if (constant.is<Bool>()) {
+                body.u8(static_cast<Uint8>(meowb::ConstantTag::Bool));
+                body.u8(constant.get<Bool>() ? 1 : 0);
+            } else if (constant.is<Str>()) {
+                body.u8(static_cast<Uint8>(meowb::ConstantTag::String));
+                body.varint(strings.indexOf(constant.get<Str>()));
+            } else if (constant.is<Proto>()) {
+                auto it = protoIndices.find(constant.get<Proto>());
+                if (it == protoIndices.end()) {
+                    throw std::runtime_error("Hằng proto trong '" + proto->sourceName + "' trỏ tới proto không nằm trong file.");
+                }
+                body.u8(static_cast<Uint8>(meowb::ConstantTag::Proto));
+                body.varint(it->second);
+            } else {
+                throw std::runtime_error("Hằng số kiểu không ghi được ra file nhị phân trong '" + proto->sourceName + "'.");
+            }
+        }
+
+        body.varint(proto->upvalueDescs.size());
+        for (const UpvalueDesc& desc : proto->upvalueDescs) {
+            body.u8(desc.isLocal ? 1 : 0);
+            body.varint(static_cast<Uint64>(desc.index));
+        }
+
+        ByteSink code;
+        code.varint(proto->code.size());
+        for (const Instruction& inst : proto->code) {
+            if (inst.args.size() > std::numeric_limits<Uint8>::max()) {
+                throw std::runtime_error("Lệnh có quá nhiều đối số trong '" + proto->sourceName + "'.");
+            }
+            code.u8(static_cast<Uint8>(inst.op));
+            code.u8(static_cast<Uint8>(inst.args.size()));
+            for (Int arg : inst.args) code.signedVarint(arg);
+        }
+        body.section(code);
+
+        ByteSink stackMap;
+        stackMap.varint(proto->stackMap.wordsPerEntry);
+        for (Uint64 word : proto->stackMap.bits) stackMap.varint(word);
+        body.section(stackMap);
+
+        indexSection.varint(strings.indexOf(proto->sourceName));
+        indexSection.varint(static_cast<Uint64>(proto->numRegisters));
+        indexSection.varint(static_cast<Uint64>(proto->numUpvalues));
+        indexSection.varint(bodySection.bytes.size());
+        indexSection.varint(body.bytes.size());
+        bodySection.raw(body.bytes);
+    }
+
+    ByteSink stringSection;
+    stringSection.varint(strings.strings.size());
+    for (const Str& s : strings.strings) {
+        stringSection.varint(s.size());
+        stringSection.raw(s);
+    }
+
+    ByteSink file;
+    file.raw(std::string_view(meowb::magic, sizeof(meowb::magic)));
+    file.u8(meowb::version);
+    file.raw(std::string_view("\0\0\0", 3));
+    file.section(stringSection);
+    file.section(indexSection);
+    file.section(bodySection);
+    return std::move(file.bytes);
+}
+
+Bool BinaryWriter::writeFile(const Str& filepath, const std::unordered_map<Str, Proto>& protos) {
+    std::string bytes;
+    try {
+        bytes = encode(protos);
+    } catch (const std::exception& e) {
+        std::cerr << "Lỗi ghi file nhị phân: " << e.what() << std::endl;
+        return false;
+    }
+    std::ofstream out(filepath, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        std::cerr << "Lỗi: Không thể mở file để ghi: " << filepath << std::endl;
+        return false;
+    }
+    out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    if (!out) {
+        std::cerr << "Lỗi: Ghi file thất bại: " << filepath << std::endl;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,194 @@
+#include "bytecode_cache.h"
+#include "binary_writer.h"
+#include "memory_manager.h"
+
+#include <cstring>
+
+#if defined(_WIN32)
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+
+// Header của một entry: magic, rồi thông tin file nguồn và mức tối ưu, rồi nội dung .meowb.
+// Đổi magic khi code sinh ra ở cùng mức tối ưu thay đổi (MWC3: có siêu lệnh;
+// MWC4: thanh ghi được đánh số lại và có stack map).
+constexpr char entryMagic[4] = { 'M', 'W', 'C', '4' };
+
+Uint64 fnv1a(const char* data, size_t size) {
+    Uint64 hash = 1469598103934665603ULL;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+template<typename T>
+void appendRaw(std::string& out, T value) {
+    char raw[sizeof(T)];
+    std::memcpy(raw, &value, sizeof(T));
+    out.append(raw, sizeof(T));
+}
+
+template<typename T>
+bool readRaw(const std::string& in, size_t& offset, T& value) {
+    if (in.size() - offset < sizeof(T)) return false;
+    std::memcpy(&value, in.data() + offset, sizeof(T));
+    offset += sizeof(T);
+    return true;
+}
+
+bool readWholeFile(const std::filesystem::path& path, std::string& out) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return false;
+    out.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    return !in.bad();
+}
+
+}
+
+BytecodeCache BytecodeCache::fromEnvironment() {
+    BytecodeCache cache;
+    cache.directory = defaultDirectory();
+    if (const char* value = std::getenv("MEOW_BYTECODE_CACHE")) {
+        Str lower;
+        for (const char* c = value; *c; ++c) lower += static_cast<char>(std::tolower(static_cast<unsigned char>(*c)));
+        if (lower == "0" || lower == "off" || lower == "false" || lower == "no") cache.enabled = false;
+    }
+    if (const char* dir = std::getenv("MEOW_BYTECODE_CACHE_DIR"); dir && *dir) {
+        cache.directory = dir;
+    }
+    return cache;
+}
+
+bool BytecodeCache::parseFlag(const Str& arg) {
+    if (arg == "--no-bytecode-cache") {
+        enabled = false;
+        return true;
+    }
+    const Str dirFlag = "--bytecode-cache-dir=";
+    if (arg.rfind(dirFlag, 0) == 0) {
+        directory = arg.substr(dirFlag.size());
+        if (directory.empty()) throw std::invalid_argument("Giá trị không hợp lệ cho " + arg);
+        return true;
+    }
+    return false;
+}
+
+Str BytecodeCache::defaultDirectory() {
+    if (const char* xdg = std::getenv("XDG_CACHE_HOME"); xdg && *xdg) {
+        return (std::filesystem::path(xdg) / "meow-vm").string();
+    }
+    if (const char* home = std::getenv("HOME"); home && *home) {
+        return (std::filesystem::path(home) / ".cache" / "meow-vm").string();
+    }
+    std::error_code ec;
+    auto temp = std::filesystem::temp_directory_path(ec);
+    return ec ? Str() : (temp / "meow-vm-cache").string();
+}
+
+std::filesystem::path BytecodeCache::entryPath(const Str& sourcePath) const {
+    std::ostringstream name;
+    name << std::hex << std::setw(16) << std::setfill('0') << fnv1a(sourcePath.data(), sourcePath.size()) << ".meowb";
+    return std::filesystem::path(directory) / name.str();
+}
+
+std::optional<BytecodeCache::SourceStamp> BytecodeCache::stamp(const Str& sourcePath, Int optimizationLevel) const {
+    if (!enabled || directory.empty()) return std::nullopt;
+
+    std::error_code ec;
+    auto mtime = std::filesystem::last_write_time(sourcePath, ec);
+    if (ec) return std::nullopt;
+    std::string content;
+    if (!readWholeFile(sourcePath, content)) return std::nullopt;
+
+    SourceStamp source;
+    source.path = sourcePath;
+    source.size = content.size();
+    source.mtime = static_cast<Int64>(mtime.time_since_epoch().count());
+    source.contentHash = fnv1a(content.data(), content.size());
+    source.optimizationLevel = optimizationLevel;
+    return source;
+}
+
+Bool BytecodeCache::contains(const SourceStamp& source) const {
+    std::string entry;
+    size_t offset = 0;
+    return readEntry(source, entry, offset);
+}
+
+Bool BytecodeCache::load(const SourceStamp& source, MemoryManager& mm, std::unordered_map<Str, Proto>& protos) {
+    std::string entry;
+    size_t offset = 0;
+    if (!readEntry(source, entry, offset)) return false;
+    if (!parser.parseBuffer(std::move(entry), offset, mm)) return false;
+    protos = parser.protos;
+    return true;
+}
+
+// Đọc bản cache của `source` và kiểm tra header; `offset` trỏ tới phần .meowb.
+Bool BytecodeCache::readEntry(const SourceStamp& source, std::string& entry, size_t& offset) const {
+    if (!readWholeFile(entryPath(source.path), entry)) return false;
+
+    offset = 0;
+    if (entry.size() < sizeof(entryMagic) || std::memcmp(entry.data(), entryMagic, sizeof(entryMagic)) != 0) return false;
+    offset += sizeof(entryMagic);
+
+    Uint64 size = 0;
+    Int64 mtime = 0;
+    Uint64 contentHash = 0;
+    Int64 optimizationLevel = 0;
+    Uint64 pathLength = 0;
+    if (!readRaw(entry, offset, size) || !readRaw(entry, offset, mtime) || !readRaw(entry, offset, contentHash) ||
+        !readRaw(entry, offset, optimizationLevel) || !readRaw(entry, offset, pathLength)) return false;
+    if (entry.size() - offset < pathLength) return false;
+    std::string_view path(entry.data() + offset, static_cast<size_t>(pathLength));
+    offset += static_cast<size_t>(pathLength);
+
+    // Hai đường dẫn trùng hash tên file thì path trong header sẽ khác.
+    if (path != source.path || size != source.size || mtime != source.mtime || contentHash != source.contentHash ||
+        optimizationLevel != source.optimizationLevel) {
+        return false;
+    }
+    return true;
+}
+
+void BytecodeCache::store(const SourceStamp& source, const std::unordered_map<Str, Proto>& protos) const {
+    std::string entry(entryMagic, sizeof(entryMagic));
+    appendRaw(entry, source.size);
+    appendRaw(entry, source.mtime);
+    appendRaw(entry, source.contentHash);
+    appendRaw(entry, static_cast<Int64>(source.optimizationLevel));
+    appendRaw(entry, static_cast<Uint64>(source.path.size()));
+    entry += source.path;
+    try {
+        entry += BinaryWriter::encode(protos);
+    } catch (const std::exception&) {
+        return;
+    }
+
+    // Cache chỉ là tăng tốc: mọi lỗi ghi đều bị bỏ qua. Ghi ra file tạm riêng
+    // của tiến trình rồi rename để tiến trình khác không đọc phải file dở dang.
+    std::error_code ec;
+    std::filesystem::create_directories(directory, ec);
+    if (ec) return;
+    auto finalPath = entryPath(source.path);
+    auto tempPath = finalPath;
+    tempPath += ".tmp." + std::to_string(getpid());
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        if (!out) return;
+        out.write(entry.data(), static_cast<std::streamsize>(entry.size()));
+        if (!out) {
+            out.close();
+            std::filesystem::remove(tempPath, ec);
+            return;
+        }
+    }
+    std::filesystem::rename(tempPath, finalPath, ec);
+    if (ec) std::filesystem::remove(tempPath, ec);
+}
@@ -0,0 +1,1105 @@
+#include "bytecode_optimizer.h"
+#include "operator_dispatcher.h"
+#include "pch.h"
+
+#include <cstring>
+
+namespace {
+
+// Các pass được lặp lại tới khi không còn gì đổi, nhưng không quá số vòng này.
+constexpr int maxRounds = 8;
+
+// Chuỗi gấp ra dài hơn thì để VM tự tính, tránh phình bảng hằng.
+constexpr size_t maxFoldedStringLength = 1024;
+
+// Bảng sự kiện của lan truyền hằng có (số khối x số thanh ghi) ô; proto lớn
+// hơn thì chỉ chạy các pass mức 1.
+constexpr size_t maxDataflowCells = size_t(1) << 20;
+
+constexpr std::string_view protoPrefix = "::function_proto::";
+
+// Vị trí đích nhảy trong args, -1 nếu lệnh không nhảy.
+Int jumpTargetArg(OpCode op) {
+    switch (op) {
+        case OpCode::JUMP:
+        case OpCode::SETUP_TRY:
+            return 0;
+        case OpCode::JUMP_IF_FALSE:
+        case OpCode::JUMP_IF_TRUE:
+            return 1;
+        case OpCode::JUMP_IF_LT: case OpCode::JUMP_IF_LE: case OpCode::JUMP_IF_EQ:
+        case OpCode::JUMP_IF_NOT_LT: case OpCode::JUMP_IF_NOT_LE: case OpCode::JUMP_IF_NOT_EQ:
+            return 3;
+        default:
+            return -1;
+    }
+}
+
+bool isConditional(OpCode op) {
+    return op == OpCode::JUMP_IF_FALSE || op == OpCode::JUMP_IF_TRUE;
+}
+
+bool isBranch(OpCode op) {
+    return op == OpCode::JUMP || isConditional(op);
+}
+
+bool endsBlock(OpCode op) {
+    switch (op) {
+        case OpCode::JUMP: case OpCode::JUMP_IF_FALSE: case OpCode::JUMP_IF_TRUE:
+        case OpCode::SETUP_TRY: case OpCode::RETURN: case OpCode::HALT: case OpCode::THROW:
+        case OpCode::JUMP_IF_LT: case OpCode::JUMP_IF_LE: case OpCode::JUMP_IF_EQ:
+        case OpCode::JUMP_IF_NOT_LT: case OpCode::JUMP_IF_NOT_LE: case OpCode::JUMP_IF_NOT_EQ:
+        case OpCode::LOAD_CONST_RETURN:
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool fallsThrough(OpCode op) {
+    return op != OpCode::JUMP && op != OpCode::RETURN && op != OpCode::HALT && op != OpCode::THROW &&
+           op != OpCode::LOAD_CONST_RETURN;
+}
+
+bool isBinaryOperator(OpCode op) {
+    switch (op) {
+        case OpCode::ADD: case OpCode::SUB: case OpCode::MUL: case OpCode::DIV: case OpCode::MOD: case OpCode::POW:
+        case OpCode::EQ: case OpCode::NEQ: case OpCode::GT: case OpCode::GE: case OpCode::LT: case OpCode::LE:
+        case OpCode::BIT_AND: case OpCode::BIT_OR: case OpCode::BIT_XOR: case OpCode::LSHIFT: case OpCode::RSHIFT:
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool isUnaryOperator(OpCode op) {
+    return op == OpCode::NEG || op == OpCode::NOT || op == OpCode::BIT_NOT;
+}
+
+// Đích nhảy nằm trong code thì CFG mới dựng được; đích sai là lỗi lúc chạy và
+// phải giữ nguyên.
+bool hasValidJumps(const ParsedProto& proto) {
+    const Int size = static_cast<Int>(proto.code.size());
+    for (const Instruction& inst : proto.code) {
+        Int arg = jumpTargetArg(inst.op);
+        if (arg < 0) continue;
+        if (static_cast<Int>(inst.args.size()) <= arg) return false;
+        Int target = inst.args[arg];
+        if (target < 0 || target >= size) return false;
+    }
+    return true;
+}
+
+// Thanh ghi mà một lệnh đọc và ghi.
+struct RegisterEffects {
+    Int def = -1;
+    size_t defPos = 0;
+    // thanh ghi thứ hai được ghi, chỉ có ở siêu lệnh ADD_INT_IMM/GET_PROP_CALL
+    Int secondDef = -1;
+    size_t secondDefPos = 0;
+    // def bị sửa tại chỗ nên cũng được đọc (SET_INDEX ghi thẳng vào chuỗi trong thanh ghi)
+    Bool defInPlace = false;
+    // vị trí trong args của các thanh ghi được đọc riêng lẻ, thay được bằng bản sao
+    size_t uses[3] = {};
+    size_t numUses = 0;
+    // dải thanh ghi đọc liền nhau (đối số CALL, phần tử NEW_ARRAY/NEW_HASH)
+    Int rangeStart = 0;
+    Int rangeCount = 0;
+    // GET_SUPER đọc receiver ở thanh ghi 0
+    Bool readsReceiver = false;
+    // bỏ được khi không ai đọc def
+    Bool removable = false;
+};
+
+// Điền `effects` cho lệnh; false nếu thiếu đối số, thanh ghi ngoài khung, hoặc
+// opcode chưa biết.
+bool describe(const Instruction& inst, const ParsedProto& proto, RegisterEffects& effects) {
+    effects = RegisterEffects{};
+    const auto& args = inst.args;
+    auto isRegister = [&proto](Int reg) { return reg >= 0 && reg < proto.numRegisters; };
+    auto isConstant = [&proto](Int idx) { return idx >= 0 && idx < static_cast<Int>(proto.constantPool.size()); };
+    auto has = [&args](size_t count) { return args.size() >= count; };
+    auto def = [&](size_t pos) {
+        effects.def = args[pos];
+        effects.defPos = pos;
+        return isRegister(args[pos]);
+    };
+    auto secondDef = [&](size_t pos) {
+        effects.secondDef = args[pos];
+        effects.secondDefPos = pos;
+        return isRegister(args[pos]);
+    };
+    auto use = [&](size_t pos) {
+        effects.uses[effects.numUses++] = pos;
+        return isRegister(args[pos]);
+    };
+    auto inPlace = [&](size_t pos) {
+        effects.defInPlace = true;
+        return def(pos);
+    };
+    auto range = [&](Int start, Int count) {
+        effects.rangeStart = start;
+        effects.rangeCount = count;
+        return count == 0 || (count > 0 && start >= 0 && start + count <= proto.numRegisters);
+    };
+
+    if (isBinaryOperator(inst.op)) return has(3) && def(0) && use(1) && use(2);
+    switch (inst.op) {
+        case OpCode::LOAD_NULL: case OpCode::LOAD_TRUE: case OpCode::LOAD_FALSE:
+            effects.removable = true;
+            return has(1) && def(0);
+        case OpCode::LOAD_INT:
+            effects.removable = true;
+            return has(2) && def(0);
+        case OpCode::LOAD_CONST:
+            if (!has(2)) return false;
+            effects.removable = isConstant(args[1]);
+            return def(0);
+        case OpCode::GET_GLOBAL:
+            if (!has(2)) return false;
+            effects.removable = isConstant(args[1]) && proto.constantPool[args[1]].is<Str>();
+            return def(0);
+        case OpCode::MOVE:
+            effects.removable = true;
+            return has(2) && def(0) && use(1);
+
+        case OpCode::NEG: case OpCode::NOT: case OpCode::BIT_NOT:
+        case OpCode::GET_KEYS: case OpCode::GET_VALUES: case OpCode::NEW_INSTANCE:
+            return has(2) && def(0) && use(1);
+        case OpCode::GET_INDEX:
+            return has(3) && def(0) && use(1) && use(2);
+        case OpCode::GET_PROP: case OpCode::GET_EXPORT: case OpCode::GET_MODULE_EXPORT:
+            return has(3) && def(0) && use(1);
+        case OpCode::GET_UPVALUE: case OpCode::CLOSURE: case OpCode::NEW_CLASS: case OpCode::IMPORT_MODULE:
+            return has(2) && def(0);
+        case OpCode::GET_SUPER:
+            effects.readsReceiver = true;
+            return has(2) && def(0) && isRegister(0);
+
+        case OpCode::SET_GLOBAL: case OpCode::SET_UPVALUE: case OpCode::EXPORT:
+            return has(2) && use(1);
+        case OpCode::JUMP_IF_FALSE: case OpCode::JUMP_IF_TRUE: case OpCode::THROW: case OpCode::IMPORT_ALL:
+            return has(1) && use(0);
+        case OpCode::SET_INDEX:
+            return has(3) && inPlace(0) && use(1) && use(2);
+        case OpCode::SET_PROP:
+            return has(3) && inPlace(0) && use(2);
+        case OpCode::SET_METHOD:
+            return has(3) && use(0) && use(2);
+        case OpCode::INHERIT:
+            return has(2) && use(0) && use(1);
+
+        case OpCode::CALL:
+            if (!has(4)) return false;
+            if (args[0] != -1 && !def(0)) return false;
+            return use(1) && range(args[2], args[3]);
+        case OpCode::NEW_ARRAY:
+            return has(3) && def(0) && range(args[1], args[2]);
+        case OpCode::NEW_HASH:
+            return has(3) && def(0) && range(args[1], args[2] * 2);
+        case OpCode::RETURN:
+            return args.empty() || args[0] < 0 || use(0);
+
+        case OpCode::JUMP: case OpCode::SETUP_TRY: case OpCode::POP_TRY:
+        case OpCode::CLOSE_UPVALUES: case OpCode::HALT:
+            return true;
+
+        case OpCode::JUMP_IF_LT: case OpCode::JUMP_IF_LE: case OpCode::JUMP_IF_EQ:
+        case OpCode::JUMP_IF_NOT_LT: case OpCode::JUMP_IF_NOT_LE: case OpCode::JUMP_IF_NOT_EQ:
+            return has(4) && def(0) && use(1) && use(2);
+        case OpCode::ADD_INT_IMM:
+            return has(4) && def(0) && use(1) && secondDef(3);
+        case OpCode::GET_PROP_CALL:
+            if (!has(6)) return false;
+            if (args[0] != -1 && !secondDef(0)) return false;
+            return def(1) && use(2) && range(args[4], args[5]);
+        case OpCode::LOAD_CONST_RETURN:
+            return has(2) && def(0);
+        default:
+            return false;
+    }
+}
+
+// Thông tin cố định của proto cho các pass phân tích thanh ghi.
+struct ProtoInfo {
+    // thanh ghi bị closure con bắt làm upvalue
+    std::vector<bool> captured;
+    Bool hasTry = false;
+    // Siêu lệnh ghi một thanh ghi rồi mới đọc thanh ghi khác, điều các pass tối
+    // ưu không mô hình được; chỉ stack map dùng được proto có chúng.
+    Bool hasSuperinstructions = false;
+};
+
+bool inspect(const ParsedProto& proto, const ParsedModule& module, ProtoInfo& info) {
+    info.captured.assign(static_cast<size_t>(std::max<Int>(proto.numRegisters, 0)), false);
+    RegisterEffects effects;
+    for (const Instruction& inst : proto.code) {
+        if (!describe(inst, proto, effects)) return false;
+        if (inst.op == OpCode::SETUP_TRY) info.hasTry = true;
+        if (inst.op >= OpCode::JUMP_IF_LT) info.hasSuperinstructions = true;
+        if (inst.op != OpCode::CLOSURE) continue;
+
+        // Không biết closure con bắt thanh ghi nào thì không phân tích được gì.
+        Int idx = inst.args[1];
+        if (idx < 0 || idx >= static_cast<Int>(proto.constantPool.size())) return false;
+        const Value& ref = proto.constantPool[idx];
+        if (!ref.is<Str>() || !ref.get<Str>().starts_with(protoPrefix)) return false;
+        auto child = module.find(ref.get<Str>().substr(protoPrefix.size()));
+        if (child == module.end()) return false;
+        for (const UpvalueDesc& desc : child->second.upvalueDescs) {
+            if (desc.isLocal && desc.index >= 0 && desc.index < proto.numRegisters) info.captured[desc.index] = true;
+        }
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// CFG
+
+struct BasicBlock {
+    size_t begin = 0;
+    size_t end = 0;
+    std::vector<size_t> successors;
+};
+
+struct ControlFlowGraph {
+    std::vector<BasicBlock> blocks;
+    // lệnh -> khối chứa nó
+    std::vector<size_t> blockOf;
+    // khối là đích của SETUP_TRY; vào từ bất kỳ lệnh nào ném lỗi
+    std::vector<bool> handler;
+};
+
+ControlFlowGraph buildCfg(const std::vector<Instruction>& code) {
+    const size_t size = code.size();
+    std::vector<bool> leader(size + 1, false);
+    leader[0] = true;
+    for (size_t i = 0; i < size; ++i) {
+        Int arg = jumpTargetArg(code[i].op);
+        if (arg >= 0) leader[code[i].args[arg]] = true;
+        if (endsBlock(code[i].op)) leader[i + 1] = true;
+    }
+
+    ControlFlowGraph cfg;
+    cfg.blockOf.resize(size);
+    for (size_t i = 0; i < size; ++i) {
+        if (leader[i]) cfg.blocks.push_back(BasicBlock{ i, i, {} });
+        cfg.blocks.back().end = i + 1;
+        cfg.blockOf[i] = cfg.blocks.size() - 1;
+    }
+
+    cfg.handler.assign(cfg.blocks.size(), false);
+    for (BasicBlock& block : cfg.blocks) {
+        const Instruction& last = code[block.end - 1];
+        Int arg = jumpTargetArg(last.op);
+        if (arg >= 0) {
+            size_t target = cfg.blockOf[last.args[arg]];
+            block.successors.push_back(target);
+            if (last.op == OpCode::SETUP_TRY) cfg.handler[target] = true;
+        }
+        if (fallsThrough(last.op) && block.end < size) block.successors.push_back(cfg.blockOf[block.end]);
+    }
+    return cfg;
+}
+
+// Xoá các lệnh được đánh dấu rồi dời đích nhảy và nhãn theo. Lệnh bị xoá đều
+// là lệnh không làm gì, nên đích nhảy vào nó được dời sang lệnh còn lại kế tiếp.
+void compact(ParsedProto& proto, std::vector<bool>& removed) {
+    auto& code = proto.code;
+    const size_t size = code.size();
+    std::vector<Int> newIndex(size + 1);
+    while (true) {
+        Int next = 0;
+        for (size_t i = 0; i < size; ++i) {
+            newIndex[i] = next;
+            if (!removed[i]) ++next;
+        }
+        newIndex[size] = next;
+
+        // Nhảy tới cuối code là lỗi lúc chạy, còn code gốc chạy qua vài lệnh vô
+        // hại rồi mới hết hàm: giữ lại lệnh ở đích.
+        bool restored = false;
+        for (size_t i = 0; i < size; ++i) {
+            Int arg = jumpTargetArg(code[i].op);
+            if (removed[i] || arg < 0) continue;
+            Int target = code[i].args[arg];
+            if (newIndex[target] == next) {
+                removed[target] = false;
+                restored = true;
+            }
+        }
+        if (!restored) break;
+    }
+
+    std::vector<Instruction> kept;
+    kept.reserve(static_cast<size_t>(newIndex[size]));
+    for (size_t i = 0; i < size; ++i) {
+        if (removed[i]) continue;
+        Instruction inst = std::move(code[i]);
+        Int arg = jumpTargetArg(inst.op);
+        if (arg >= 0) inst.args[arg] = newIndex[inst.args[arg]];
+        kept.push_back(std::move(inst));
+    }
+    code = std::move(kept);
+
+    for (auto& [name, ip] : proto.labels) {
+        if (ip >= 0 && ip <= static_cast<Int>(size)) ip = newIndex[ip];
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Khoảng sống của thanh ghi
+//
+// Giải ngược trên CFG: thanh ghi sống trước một lệnh nếu lệnh đọc nó, hoặc nó
+// sống sau lệnh mà lệnh không ghi đè. Dùng cho bỏ lệnh ghi chết, đánh số lại
+// thanh ghi và stack map.
+
+using LiveSet = std::vector<bool>;
+
+void stepBackward(LiveSet& live, const Instruction& inst, const RegisterEffects& effects) {
+    if (effects.def >= 0 && !effects.defInPlace) live[effects.def] = false;
+    if (effects.secondDef >= 0) live[effects.secondDef] = false;
+    if (effects.defInPlace) live[effects.def] = true;
+    for (size_t u = 0; u < effects.numUses; ++u) live[inst.args[effects.uses[u]]] = true;
+    for (Int r = 0; r < effects.rangeCount; ++r) live[effects.rangeStart + r] = true;
+    if (effects.readsReceiver) live[0] = true;
+}
+
+LiveSet liveOut(const std::vector<LiveSet>& liveIn, const BasicBlock& block, size_t registers) {
+    LiveSet live(registers, false);
+    for (size_t next : block.successors) {
+        for (size_t r = 0; r < registers; ++r) {
+            if (liveIn[next][r]) live[r] = true;
+        }
+    }
+    return live;
+}
+
+// Thanh ghi sống ở đầu mỗi khối. Khối catch chỉ có cạnh từ SETUP_TRY chứ không
+// từ từng lệnh có thể ném lỗi, nên proto có try không dùng được kết quả này.
+std::vector<LiveSet> solveLiveness(const std::vector<Instruction>& code, const std::vector<RegisterEffects>& effects,
+                                   const ControlFlowGraph& cfg, size_t registers) {
+    std::vector<LiveSet> liveIn(cfg.blocks.size(), LiveSet(registers, false));
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t b = cfg.blocks.size(); b-- > 0;) {
+            const BasicBlock& block = cfg.blocks[b];
+            LiveSet live = liveOut(liveIn, block, registers);
+            for (size_t i = block.end; i-- > block.begin;) stepBackward(live, code[i], effects[i]);
+            if (live != liveIn[b]) {
+                liveIn[b] = std::move(live);
+                changed = true;
+            }
+        }
+    }
+    return liveIn;
+}
+
+// ---------------------------------------------------------------------------
+// Mức 1: nối lệnh nhảy, bỏ lệnh nhảy thừa và code không tới được
+
+// Nhảy tới một JUMP thì nhảy thẳng tới đích của nó. Nhảy có điều kiện tới một
+// lệnh nhảy có điều kiện trên cùng thanh ghi thì kết quả kiểm tra đã biết.
+bool threadJumps(ParsedProto& proto) {
+    auto& code = proto.code;
+    const Int size = static_cast<Int>(code.size());
+    bool changed = false;
+    for (Instruction& inst : code) {
+        if (!isBranch(inst.op)) continue;
+        Int arg = jumpTargetArg(inst.op);
+        Int target = inst.args[arg];
+        // giới hạn số bước để không kẹt trong vòng JUMP khép kín
+        for (Int steps = 0; steps < size; ++steps) {
+            const Instruction& next = code[target];
+            Int hop = -1;
+            if (next.op == OpCode::JUMP) {
+                hop = next.args[0];
+            } else if (isConditional(inst.op) && isConditional(next.op) && next.args[0] == inst.args[0]) {
+                hop = next.op == inst.op ? next.args[1] : target + 1;
+            }
+            if (hop < 0 || hop >= size || hop == target) break;
+            target = hop;
+        }
+        if (target != inst.args[arg]) {
+            inst.args[arg] = target;
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+bool simplifyControlFlow(ParsedProto& proto) {
+    auto& code = proto.code;
+    const size_t size = code.size();
+    if (size == 0) return false;
+    ControlFlowGraph cfg = buildCfg(code);
+
+    std::vector<bool> reachable(cfg.blocks.size(), false);
+    std::vector<size_t> pending{ 0 };
+    reachable[0] = true;
+    while (!pending.empty()) {
+        size_t block = pending.back();
+        pending.pop_back();
+        for (size_t next : cfg.blocks[block].successors) {
+            if (reachable[next]) continue;
+            reachable[next] = true;
+            pending.push_back(next);
+        }
+    }
+
+    bool changed = false;
+    std::vector<bool> removed(size, false);
+    for (size_t b = 0; b < cfg.blocks.size(); ++b) {
+        if (reachable[b]) continue;
+        for (size_t i = cfg.blocks[b].begin; i < cfg.blocks[b].end; ++i) removed[i] = true;
+        changed = true;
+    }
+
+    std::vector<bool> targeted(size, false);
+    for (size_t i = 0; i < size; ++i) {
+        Int arg = jumpTargetArg(code[i].op);
+        if (!removed[i] && arg >= 0) targeted[code[i].args[arg]] = true;
+    }
+    auto nextKept = [&](size_t i) {
+        do ++i; while (i < size && removed[i]);
+        return i;
+    };
+
+    for (size_t i = 0; i < size; ++i) {
+        Instruction& inst = code[i];
+        if (removed[i] || !isBranch(inst.op)) continue;
+        Int arg = jumpTargetArg(inst.op);
+        size_t after = nextKept(i);
+        if (static_cast<size_t>(inst.args[arg]) == after) {
+            // nhảy tới ngay lệnh kế tiếp
+            removed[i] = true;
+            changed = true;
+            continue;
+        }
+        // JUMP_IF_FALSE r L; JUMP M; L:  =>  JUMP_IF_TRUE r M; L:
+        if (isConditional(inst.op) && after < size && code[after].op == OpCode::JUMP && !targeted[after] &&
+            static_cast<size_t>(inst.args[1]) == nextKept(after)) {
+            inst.op = inst.op == OpCode::JUMP_IF_FALSE ? OpCode::JUMP_IF_TRUE : OpCode::JUMP_IF_FALSE;
+            inst.args[1] = code[after].args[0];
+            removed[after] = true;
+            changed = true;
+        }
+    }
+
+    if (changed) compact(proto, removed);
+    return changed;
+}
+
+// ---------------------------------------------------------------------------
+// Mức 2: lan truyền hằng và bản sao
+
+struct RegisterFact {
+    enum class Kind : Uint8 { Unknown, Constant, CopyOf };
+    Kind kind = Kind::Unknown;
+    // thanh ghi mà thanh ghi này đang là bản sao; nguồn luôn không phải CopyOf
+    Int source = -1;
+    Value constant;
+};
+
+using RegisterState = std::vector<RegisterFact>;
+
+bool isFoldableConstant(const Value& value) {
+    if (value.is<Str>()) return !value.get<Str>().starts_with(protoPrefix);
+    return value.is<Null>() || value.is<Int>() || value.is<Real>() || value.is<Bool>();
+}
+
+bool sameConstant(const Value& a, const Value& b) {
+    if (a.index() != b.index()) return false;
+    if (a.is<Null>()) return true;
+    if (a.is<Int>()) return a.get<Int>() == b.get<Int>();
+    if (a.is<Bool>()) return a.get<Bool>() == b.get<Bool>();
+    if (a.is<Str>()) return a.get<Str>() == b.get<Str>();
+    if (a.is<Real>()) {
+        // so từng bit để phân biệt 0.0/-0.0 và coi NaN bằng chính nó
+        Real x = a.get<Real>();
+        Real y = b.get<Real>();
+        return std::memcmp(&x, &y, sizeof(Real)) == 0;
+    }
+    return false;
+}
+
+bool sameFact(const RegisterFact& a, const RegisterFact& b) {
+    if (a.kind != b.kind) return false;
+    if (a.kind == RegisterFact::Kind::CopyOf) return a.source == b.source;
+    if (a.kind == RegisterFact::Kind::Constant) return sameConstant(a.constant, b.constant);
+    return true;
+}
+
+// Giống MeowVM::_isTruthy với các kiểu hằng.
+bool isTruthy(const Value& value) {
+    if (value.is<Null>()) return false;
+    if (value.is<Bool>()) return value.get<Bool>();
+    if (value.is<Int>()) return value.get<Int>() != 0;
+    if (value.is<Real>()) {
+        Real r = value.get<Real>();
+        return r != 0.0 && !std::isnan(r);
+    }
+    if (value.is<Str>()) return !value.get<Str>().empty();
+    return true;
+}
+
+OperatorDispatcher& dispatcher() {
+    // chỉ đọc sau khi dựng xong nên các luồng đọc trước dùng chung được
+    static OperatorDispatcher instance;
+    return instance;
+}
+
+std::optional<Value> acceptFolded(Value result) {
+    if (!isFoldableConstant(result)) return std::nullopt;
+    if (result.is<Str>() && result.get<Str>().size() > maxFoldedStringLength) return std::nullopt;
+    return result;
+}
+
+std::optional<Value> foldBinary(OpCode op, const Value& left, const Value& right) {
+    // EQ/NEQ trên số thực đi qua lambda realEq, lambda này giữ tham chiếu tới
+    // biến cục bộ của constructor OperatorDispatcher: để VM tự tính.
+    if ((op == OpCode::EQ || op == OpCode::NEQ) && (left.is<Real>() || right.is<Real>())) return std::nullopt;
+    try {
+        BinaryOpFunc* func = dispatcher().find(op, left, right);
+        if (!func) return std::nullopt;
+        return acceptFolded((*func)(left, right));
+    } catch (const std::exception&) {
+        return std::nullopt;
+    }
+}
+
+std::optional<Value> foldUnary(OpCode op, const Value& operand) {
+    try {
+        UnaryOpFunc* func = dispatcher().find(op, operand);
+        if (!func) return std::nullopt;
+        return acceptFolded((*func)(operand));
+    } catch (const std::exception&) {
+        return std::nullopt;
+    }
+}
+
+// Giá trị hằng mà lệnh ghi vào def, nếu biết trước được.
+std::optional<Value> evaluate(const Instruction& inst, const RegisterEffects& effects,
+                              const RegisterState& state, const ParsedProto& proto) {
+    auto constantOf = [&state](Int reg) -> const Value* {
+        const RegisterFact& fact = state[reg];
+        return fact.kind == RegisterFact::Kind::Constant ? &fact.constant : nullptr;
+    };
+    switch (inst.op) {
+        case OpCode::LOAD_NULL: return Value(Null{});
+        case OpCode::LOAD_TRUE: return Value(true);
+        case OpCode::LOAD_FALSE: return Value(false);
+        case OpCode::LOAD_INT: return Value(inst.args[1]);
+        case OpCode::LOAD_CONST:
+            if (effects.removable && isFoldableConstant(proto.constantPool[inst.args[1]])) {
+                return proto.constantPool[inst.args[1]];
+            }
+            return std::nullopt;
+        case OpCode::MOVE:
+            if (const Value* value = constantOf(inst.args[1])) return *value;
+            return std::nullopt;
+        default:
+            break;
+    }
+    if (isBinaryOperator(inst.op)) {
+        const Value* left = constantOf(inst.args[1]);
+        const Value* right = constantOf(inst.args[2]);
+        if (left && right) return foldBinary(inst.op, *left, *right);
+    } else if (isUnaryOperator(inst.op)) {
+        if (const Value* operand = constantOf(inst.args[1])) return foldUnary(inst.op, *operand);
+    }
+    return std::nullopt;
+}
+
+void kill(RegisterState& state, Int reg) {
+    state[reg] = RegisterFact{};
+    for (RegisterFact& fact : state) {
+        if (fact.kind == RegisterFact::Kind::CopyOf && fact.source == reg) fact = RegisterFact{};
+    }
+}
+
+void transfer(RegisterState& state, const Instruction& inst, const RegisterEffects& effects,
+              const std::optional<Value>& result, const ProtoInfo& info) {
+    Int dst = effects.def;
+    if (dst < 0) return;
+    if (inst.op == OpCode::MOVE && inst.args[1] == dst) return;
+
+    RegisterFact fact;
+    if (result) {
+        fact.kind = RegisterFact::Kind::Constant;
+        fact.constant = *result;
+    } else if (inst.op == OpCode::MOVE) {
+        Int source = inst.args[1];
+        if (state[source].kind == RegisterFact::Kind::CopyOf) source = state[source].source;
+        if (source != dst && !info.captured[source]) {
+            fact.kind = RegisterFact::Kind::CopyOf;
+            fact.source = source;
+        }
+    }
+    kill(state, dst);
+    if (!info.captured[dst]) state[dst] = std::move(fact);
+}
+
+// Lệnh nạp hằng `value` vào `dst`; Real và Str dùng lại hoặc thêm vào bảng hằng.
+Instruction loadConstant(Int dst, const Value& value, ParsedProto& proto) {
+    if (value.is<Null>()) return Instruction(OpCode::LOAD_NULL, { dst });
+    if (value.is<Bool>()) return Instruction(value.get<Bool>() ? OpCode::LOAD_TRUE : OpCode::LOAD_FALSE, { dst });
+    if (value.is<Int>()) return Instruction(OpCode::LOAD_INT, { dst, value.get<Int>() });
+    auto& pool = proto.constantPool;
+    for (size_t i = 0; i < pool.size(); ++i) {
+        if (sameConstant(pool[i], value)) return Instruction(OpCode::LOAD_CONST, { dst, static_cast<Int>(i) });
+    }
+    pool.push_back(value);
+    return Instruction(OpCode::LOAD_CONST, { dst, static_cast<Int>(pool.size() - 1) });
+}
+
+// Sự kiện về thanh ghi ở đầu mỗi khối; nullopt nếu khối không tới được kể cả
+// khi tính tới các nhánh có điều kiện là hằng.
+std::vector<std::optional<RegisterState>> analyzeFacts(const ParsedProto& proto, const ProtoInfo& info,
+                                                       const ControlFlowGraph& cfg) {
+    const auto& code = proto.code;
+    const size_t size = code.size();
+    const size_t registers = info.captured.size();
+
+    // Đầu hàm và đầu khối catch: chưa biết gì về thanh ghi (tham số, hoặc giá
+    // trị tại lệnh ném lỗi).
+    std::vector<std::optional<RegisterState>> entry(cfg.blocks.size());
+    std::vector<bool> queued(cfg.blocks.size(), false);
+    std::deque<size_t> worklist;
+    auto seed = [&](size_t block) {
+        entry[block] = RegisterState(registers);
+        queued[block] = true;
+        worklist.push_back(block);
+    };
+    seed(0);
+    for (size_t b = 1; b < cfg.blocks.size(); ++b) {
+        if (cfg.handler[b]) seed(b);
+    }
+
+    auto merge = [&](size_t block, const RegisterState& state) {
+        bool changed = false;
+        if (!entry[block]) {
+            entry[block] = state;
+            changed = true;
+        } else {
+            RegisterState& into = *entry[block];
+            for (size_t r = 0; r < registers; ++r) {
+                if (into[r].kind == RegisterFact::Kind::Unknown || sameFact(into[r], state[r])) continue;
+                into[r] = RegisterFact{};
+                changed = true;
+            }
+        }
+        if (changed && !queued[block]) {
+            queued[block] = true;
+            worklist.push_back(block);
+        }
+    };
+
+    // Nhánh có điều kiện là hằng thì chỉ đi theo một phía.
+    auto forwardState = [&](const BasicBlock& block, const RegisterState& state) {
+        const Instruction& last = code[block.end - 1];
+        if (isConditional(last.op) && state[last.args[0]].kind == RegisterFact::Kind::Constant) {
+            bool taken = isTruthy(state[last.args[0]].constant) == (last.op == OpCode::JUMP_IF_TRUE);
+            if (taken) merge(cfg.blockOf[last.args[1]], state);
+            else if (block.end < size) merge(cfg.blockOf[block.end], state);
+            return;
+        }
+        for (size_t next : block.successors) merge(next, state);
+    };
+
+    RegisterEffects effects;
+    while (!worklist.empty()) {
+        size_t b = worklist.front();
+        worklist.pop_front();
+        queued[b] = false;
+        const BasicBlock& block = cfg.blocks[b];
+        RegisterState state = *entry[b];
+        for (size_t i = block.begin; i < block.end; ++i) {
+            describe(code[i], proto, effects);
+            transfer(state, code[i], effects, evaluate(code[i], effects, state, proto), info);
+        }
+        forwardState(block, state);
+    }
+    return entry;
+}
+
+bool propagateConstants(ParsedProto& proto, const ProtoInfo& info) {
+    auto& code = proto.code;
+    const size_t size = code.size();
+    if (size == 0) return false;
+    const size_t registers = info.captured.size();
+    ControlFlowGraph cfg = buildCfg(code);
+    if (cfg.blocks.size() * std::max<size_t>(registers, 1) > maxDataflowCells) return false;
+
+    std::vector<std::optional<RegisterState>> entry = analyzeFacts(proto, info, cfg);
+
+    // Viết lại code theo trạng thái đã hội tụ.
+    bool changed = false;
+    std::vector<bool> removed(size, false);
+    bool anyRemoved = false;
+    RegisterEffects effects;
+    for (size_t b = 0; b < cfg.blocks.size(); ++b) {
+        if (!entry[b]) continue;
+        RegisterState state = std::move(*entry[b]);
+        for (size_t i = cfg.blocks[b].begin; i < cfg.blocks[b].end; ++i) {
+            Instruction& inst = code[i];
+            describe(inst, proto, effects);
+            for (size_t u = 0; u < effects.numUses; ++u) {
+                Int& reg = inst.args[effects.uses[u]];
+                if (state[reg].kind != RegisterFact::Kind::CopyOf) continue;
+                reg = state[reg].source;
+                changed = true;
+            }
+
+            if (inst.op == OpCode::MOVE && inst.args[0] == inst.args[1]) {
+                removed[i] = anyRemoved = true;
+                continue;
+            }
+            if (isConditional(inst.op) && state[inst.args[0]].kind == RegisterFact::Kind::Constant) {
+                bool taken = isTruthy(state[inst.args[0]].constant) == (inst.op == OpCode::JUMP_IF_TRUE);
+                if (taken) inst = Instruction(OpCode::JUMP, { inst.args[1] });
+                else removed[i] = anyRemoved = true;
+                changed = true;
+                continue;
+            }
+
+            std::optional<Value> result = evaluate(inst, effects, state, proto);
+            bool isLoad = inst.op == OpCode::LOAD_NULL || inst.op == OpCode::LOAD_TRUE || inst.op == OpCode::LOAD_FALSE ||
+                          inst.op == OpCode::LOAD_INT || inst.op == OpCode::LOAD_CONST;
+            if (result && !isLoad) {
+                inst = loadConstant(effects.def, *result, proto);
+                changed = true;
+            }
+            transfer(state, inst, effects, result, info);
+        }
+    }
+
+    if (anyRemoved) compact(proto, removed);
+    return changed || anyRemoved;
+}
+
+// ---------------------------------------------------------------------------
+// Mức 2: bỏ lệnh ghi vào thanh ghi không còn ai đọc
+//
+// Thanh ghi là gốc của GC, nên lệnh ghi "chết" vẫn có thể là lệnh thả tham
+// chiếu tới object (LOAD_NULL trước khi gc.collect(), weak ref...). Chỉ bỏ lệnh
+// ghi đè lên thanh ghi đang chắc chắn giữ một hằng không nằm trên heap.
+
+bool eliminateDeadStores(ParsedProto& proto, const ProtoInfo& info) {
+    auto& code = proto.code;
+    const size_t size = code.size();
+    if (size == 0) return false;
+    const size_t registers = info.captured.size();
+    ControlFlowGraph cfg = buildCfg(code);
+    if (cfg.blocks.size() * std::max<size_t>(registers, 1) > maxDataflowCells) return false;
+
+    std::vector<RegisterEffects> effects(size);
+    for (size_t i = 0; i < size; ++i) describe(code[i], proto, effects[i]);
+
+    std::vector<bool> overwritesConstant(size, false);
+    std::vector<std::optional<RegisterState>> entry = analyzeFacts(proto, info, cfg);
+    for (size_t b = 0; b < cfg.blocks.size(); ++b) {
+        if (!entry[b]) continue;
+        RegisterState& state = *entry[b];
+        for (size_t i = cfg.blocks[b].begin; i < cfg.blocks[b].end; ++i) {
+            const RegisterEffects& fx = effects[i];
+            overwritesConstant[i] = fx.def >= 0 && state[fx.def].kind == RegisterFact::Kind::Constant;
+            transfer(state, code[i], fx, evaluate(code[i], fx, state, proto), info);
+        }
+    }
+
+    std::vector<LiveSet> liveIn = solveLiveness(code, effects, cfg, registers);
+
+    std::vector<bool> removed(size, false);
+    bool anyRemoved = false;
+    for (const BasicBlock& block : cfg.blocks) {
+        LiveSet live = liveOut(liveIn, block, registers);
+        for (size_t i = block.end; i-- > block.begin;) {
+            const RegisterEffects& fx = effects[i];
+            if (fx.removable && overwritesConstant[i] && !info.captured[fx.def] && !live[fx.def]) {
+                removed[i] = anyRemoved = true;
+                continue;
+            }
+            stepBackward(live, code[i], fx);
+        }
+    }
+
+    if (anyRemoved) compact(proto, removed);
+    return anyRemoved;
+}
+
+// ---------------------------------------------------------------------------
+// Mức 1: đánh số lại thanh ghi
+//
+// Hai thanh ghi không bao giờ cùng sống thì dùng chung được một ô của frame.
+// Lệnh ghi giao thoa với mọi thanh ghi sống sau nó (trừ nguồn của MOVE, vốn giữ
+// cùng giá trị), rồi thanh ghi được tô màu tham lam theo thứ tự số. Giữ nguyên
+// số của thanh ghi sống ở đầu hàm (tham số, thanh ghi đọc trước khi ghi), dải
+// đối số của CALL/NEW_ARRAY/NEW_HASH (phải liền nhau) và receiver của
+// GET_SUPER. Thanh ghi bị closure con bắt cũng giữ số, và không thanh ghi nào
+// khác được dùng chung ô với nó vì upvalue đang mở trỏ thẳng vào ô đó.
+bool renumberRegisters(ParsedProto& proto, const ProtoInfo& info) {
+    auto& code = proto.code;
+    const size_t size = code.size();
+    const size_t registers = info.captured.size();
+    if (size == 0 || registers == 0 || static_cast<Int>(registers) != proto.numRegisters) return false;
+    ControlFlowGraph cfg = buildCfg(code);
+    if (cfg.blocks.size() * registers > maxDataflowCells || registers * registers > maxDataflowCells) return false;
+
+    std::vector<RegisterEffects> effects(size);
+    for (size_t i = 0; i < size; ++i) describe(code[i], proto, effects[i]);
+
+    std::vector<bool> pinned = info.captured;
+    std::vector<bool> used = info.captured;
+    for (size_t i = 0; i < size; ++i) {
+        const RegisterEffects& fx = effects[i];
+        if (fx.def >= 0) used[fx.def] = true;
+        for (size_t u = 0; u < fx.numUses; ++u) used[code[i].args[fx.uses[u]]] = true;
+        for (Int r = 0; r < fx.rangeCount; ++r) pinned[fx.rangeStart + r] = used[fx.rangeStart + r] = true;
+        if (fx.readsReceiver) pinned[0] = used[0] = true;
+    }
+
+    std::vector<LiveSet> liveIn = solveLiveness(code, effects, cfg, registers);
+    for (size_t r = 0; r < registers; ++r) {
+        if (liveIn[0][r]) pinned[r] = used[r] = true;
+    }
+
+    std::vector<LiveSet> interferes(registers, LiveSet(registers, false));
+    for (const BasicBlock& block : cfg.blocks) {
+        LiveSet live = liveOut(liveIn, block, registers);
+        for (size_t i = block.end; i-- > block.begin;) {
+            const RegisterEffects& fx = effects[i];
+            if (fx.def >= 0 && !fx.defInPlace) {
+                Int copied = code[i].op == OpCode::MOVE ? code[i].args[1] : -1;
+                for (size_t r = 0; r < registers; ++r) {
+                    if (!live[r] || static_cast<Int>(r) == fx.def || static_cast<Int>(r) == copied) continue;
+                    interferes[fx.def][r] = interferes[r][fx.def] = true;
+                }
+            }
+            stepBackward(live, code[i], fx);
+        }
+    }
+
+    std::vector<Int> color(registers, -1);
+    for (size_t r = 0; r < registers; ++r) {
+        if (pinned[r]) color[r] = static_cast<Int>(r);
+    }
+    Int newCount = 1;
+    for (size_t r = 0; r < registers; ++r) {
+        if (!used[r]) continue;
+        if (color[r] < 0) {
+            LiveSet taken = info.captured;
+            for (size_t other = 0; other < registers; ++other) {
+                if (interferes[r][other] && color[other] >= 0) taken[color[other]] = true;
+            }
+            size_t chosen = 0;
+            while (chosen < registers && taken[chosen]) ++chosen;
+            if (chosen >= registers) return false;
+            color[r] = static_cast<Int>(chosen);
+        }
+        newCount = std::max(newCount, color[r] + 1);
+    }
+    if (newCount >= proto.numRegisters) return false;
+
+    std::vector<bool> removed(size, false);
+    bool anyRemoved = false;
+    for (size_t i = 0; i < size; ++i) {
+        const RegisterEffects& fx = effects[i];
+        auto& args = code[i].args;
+        if (fx.def >= 0) args[fx.defPos] = color[fx.def];
+        for (size_t u = 0; u < fx.numUses; ++u) args[fx.uses[u]] = color[args[fx.uses[u]]];
+        if (code[i].op == OpCode::MOVE && args[0] == args[1]) removed[i] = anyRemoved = true;
+    }
+    proto.numRegisters = newCount;
+    if (anyRemoved) compact(proto, removed);
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Siêu lệnh (xem FusedPair)
+
+OpCode fusedCompareJump(OpCode compare, bool jumpIfTrue) {
+    switch (compare) {
+        case OpCode::LT: return jumpIfTrue ? OpCode::JUMP_IF_LT : OpCode::JUMP_IF_NOT_LT;
+        case OpCode::LE: return jumpIfTrue ? OpCode::JUMP_IF_LE : OpCode::JUMP_IF_NOT_LE;
+        case OpCode::EQ: return jumpIfTrue ? OpCode::JUMP_IF_EQ : OpCode::JUMP_IF_NOT_EQ;
+        default: return OpCode::TOTAL_OPCODES;
+    }
+}
+
+// Một lượt từ đầu tới cuối, mỗi lệnh nằm trong nhiều nhất một cặp. Lệnh thứ
+// hai bị xoá nên không được là đích nhảy (kể cả khối catch).
+void fuseSuperinstructions(ParsedProto& proto, std::vector<FusedPair>* fusions) {
+    auto& code = proto.code;
+    const size_t size = code.size();
+    std::vector<bool> targeted(size, false);
+    for (const Instruction& inst : code) {
+        Int arg = jumpTargetArg(inst.op);
+        if (arg >= 0) targeted[inst.args[arg]] = true;
+    }
+
+    std::vector<bool> removed(size, false);
+    size_t fusedCount = 0;
+    for (size_t i = 0; i + 1 < size; ++i) {
+        if (targeted[i + 1]) continue;
+        Instruction& first = code[i];
+        const Instruction& second = code[i + 1];
+        const auto& a = first.args;
+        const auto& b = second.args;
+
+        OpCode fused = OpCode::TOTAL_OPCODES;
+        std::vector<Int> args;
+        switch (first.op) {
+            case OpCode::LT: case OpCode::LE: case OpCode::EQ:
+                if (a.size() >= 3 && isConditional(second.op) && b.size() >= 2 && b[0] == a[0]) {
+                    fused = fusedCompareJump(first.op, second.op == OpCode::JUMP_IF_TRUE);
+                    args = { a[0], a[1], a[2], b[1] };
+                }
+                break;
+            case OpCode::LOAD_INT:
+                // chỉ gộp khi k là toán hạng phải: ADD không giao hoán với chuỗi
+                if (a.size() >= 2 && second.op == OpCode::ADD && b.size() >= 3 && b[2] == a[0]) {
+                    fused = OpCode::ADD_INT_IMM;
+                    args = { b[0], b[1], a[1], a[0] };
+                }
+                break;
+            case OpCode::GET_PROP:
+                if (a.size() >= 3 && second.op == OpCode::CALL && b.size() >= 4 && b[1] == a[0]) {
+                    fused = OpCode::GET_PROP_CALL;
+                    args = { b[0], a[0], a[1], a[2], b[2], b[3] };
+                }
+                break;
+            case OpCode::LOAD_CONST:
+                if (a.size() >= 2 && a[0] >= 0 && second.op == OpCode::RETURN && !b.empty() && b[0] == a[0]) {
+                    fused = OpCode::LOAD_CONST_RETURN;
+                    args = { a[0], a[1] };
+                }
+                break;
+            default:
+                break;
+        }
+        if (fused == OpCode::TOTAL_OPCODES) continue;
+
+        if (fusions) {
+            fusions->push_back(FusedPair{ proto.name, static_cast<Int>(i - fusedCount), first.op, second.op, fused });
+        }
+        first = Instruction(fused, std::move(args));
+        removed[i + 1] = true;
+        ++fusedCount;
+        ++i;
+    }
+    if (fusedCount > 0) compact(proto, removed);
+}
+
+// ---------------------------------------------------------------------------
+// Stack map (xem StackMap)
+
+StackMap computeStackMap(const ParsedProto& proto, const ParsedModule& module) {
+    StackMap map;
+    const auto& code = proto.code;
+    if (code.empty() || proto.numRegisters <= 0 || !hasValidJumps(proto)) return map;
+    ProtoInfo info;
+    if (!inspect(proto, module, info) || info.hasTry) return map;
+
+    const size_t size = code.size();
+    const size_t registers = info.captured.size();
+    const size_t words = (registers + 63) / 64;
+    ControlFlowGraph cfg = buildCfg(code);
+    if (cfg.blocks.size() * registers > maxDataflowCells || size * words > maxDataflowCells) return map;
+
+    std::vector<RegisterEffects> effects(size);
+    for (size_t i = 0; i < size; ++i) describe(code[i], proto, effects[i]);
+    std::vector<LiveSet> liveIn = solveLiveness(code, effects, cfg, registers);
+
+    map.wordsPerEntry = words;
+    map.bits.assign(size * words, 0);
+    auto mark = [&](size_t i, Int reg) {
+        map.bits[i * words + static_cast<size_t>(reg) / 64] |= Uint64(1) << (static_cast<size_t>(reg) % 64);
+    };
+    auto markAll = [&](size_t i, const LiveSet& live) {
+        for (size_t r = 0; r < registers; ++r) {
+            if (live[r]) mark(i, static_cast<Int>(r));
+        }
+    };
+    for (const BasicBlock& block : cfg.blocks) {
+        LiveSet live = liveOut(liveIn, block, registers);
+        for (size_t i = block.end; i-- > block.begin;) {
+            const RegisterEffects& fx = effects[i];
+            markAll(i, live);
+            stepBackward(live, code[i], fx);
+            markAll(i, live);
+            // frame dừng giữa lệnh (đang gọi hàm khác) vẫn có thể cần mọi thanh
+            // ghi mà lệnh đọc hoặc sắp ghi
+            if (fx.def >= 0) mark(i, fx.def);
+            if (fx.secondDef >= 0) mark(i, fx.secondDef);
+            for (size_t u = 0; u < fx.numUses; ++u) mark(i, code[i].args[fx.uses[u]]);
+            for (Int r = 0; r < fx.rangeCount; ++r) mark(i, fx.rangeStart + r);
+            if (fx.readsReceiver) mark(i, 0);
+            markAll(i, info.captured);
+        }
+    }
+    return map;
+}
+
+}
+
+OptimizerConfig OptimizerConfig::fromEnvironment() {
+    OptimizerConfig config;
+    if (const char* value = std::getenv("MEOW_OPT_LEVEL"); value && *value) {
+        try {
+            config.level = std::clamp<Int>(std::stoll(value), 0, maxLevel);
+        } catch (const std::exception&) {
+            std::cerr << "Cảnh báo: bỏ qua MEOW_OPT_LEVEL không hợp lệ: " << value << std::endl;
+        }
+    }
+    return config;
+}
+
+bool OptimizerConfig::parseFlag(const Str& arg) {
+    if (arg.rfind("-O", 0) != 0) return false;
+    Str value = arg.substr(2);
+    size_t used = 0;
+    long long parsed = 0;
+    try {
+        parsed = std::stoll(value, &used);
+    } catch (const std::exception&) {
+        used = 0;
+    }
+    if (value.empty() || used != value.size() || parsed < 0) throw std::invalid_argument("Giá trị không hợp lệ cho " + arg);
+    // như trình biên dịch C, mức cao hơn mức có sẵn được coi là mức cao nhất
+    level = std::min<Int>(parsed, maxLevel);
+    return true;
+}
+
+void BytecodeOptimizer::optimize(ParsedModule& module) const {
+    if (level <= 0) return;
+    for (auto& [name, proto] : module) optimize(proto, module);
+}
+
+void BytecodeOptimizer::optimize(ParsedProto& proto, const ParsedModule& module) const {
+    if (level <= 0 || proto.code.empty() || !hasValidJumps(proto)) return;
+
+    ProtoInfo info;
+    bool inspected = inspect(proto, module, info) && !info.hasSuperinstructions;
+    bool analyzable = level >= 2 && inspected;
+    for (int round = 0; round < maxRounds; ++round) {
+        bool changed = false;
+        if (analyzable) changed |= propagateConstants(proto, info);
+        changed |= threadJumps(proto);
+        changed |= simplifyControlFlow(proto);
+        // Khối catch nhận thanh ghi ở trạng thái tại lệnh ném lỗi, có thể là bất
+        // kỳ lệnh nào trong vùng try, nên hàm có try giữ nguyên mọi lệnh ghi.
+        if (analyzable && !info.hasTry) changed |= eliminateDeadStores(proto, info);
+        if (!changed) break;
+    }
+    // Khối catch đọc thanh ghi ở trạng thái của lệnh ném lỗi, nên không biết
+    // chắc khoảng sống trong hàm có try.
+    if (inspected && !info.hasTry) renumberRegisters(proto, info);
+    // Các pass trên không hiểu siêu lệnh nên gộp sau cùng.
+    fuseSuperinstructions(proto, fusions);
+}
+
+void buildStackMaps(ParsedModule& module) {
+    for (auto& [name, proto] : module) proto.stackMap = computeStackMap(proto, module);
+}
@@ -1,224 +1,311 @@
 #include "bytecode_parser.h"
+#include "bytecode_optimizer.h"
 #include "memory_manager.h"
 #include "pch.h"
 
-static Str trim(const Str& s) {
-    size_t a = s.find_first_not_of(" \t\r\n");
-    if (a == Str::npos) return "";
-    size_t b = s.find_last_not_of(" \t\r\n");
-    return s.substr(a, b - a + 1);
-}
+#include <charconv>
+
+namespace {
 
-static Str toUpper(const Str& s) {
-    Str res = s;
-    std::transform(res.begin(), res.end(), res.begin(), ::toupper);
-    return res;
+constexpr bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' || c == '\f';
 }
 
-static inline void skipComment(Str& line) {
-    bool in_string = false;
-    size_t comment_pos = Str::npos;
+std::string_view trim(std::string_view s) {
+    while (!s.empty() && isSpace(s.front())) s.remove_prefix(1);
+    while (!s.empty() && isSpace(s.back())) s.remove_suffix(1);
+    return s;
+}
 
-    for (size_t i = 0; i < line.length(); ++i) {
-        if (line[i] == '"') {
-            if (i == 0 || line[i-1] != '\\') {
-                in_string = !in_string;
-            }
-        }
-        
-        if (line[i] == '#' && !in_string) {
-            comment_pos = i;
+// Cắt bỏ chú thích '#' nằm ngoài chuỗi và khoảng trắng hai đầu.
+std::string_view skipComment(std::string_view line) {
+    bool inString = false;
+    for (size_t i = 0; i < line.size(); ++i) {
+        if (line[i] == '"' && (i == 0 || line[i - 1] != '\\')) {
+            inString = !inString;
+        } else if (line[i] == '#' && !inString) {
+            line = line.substr(0, i);
             break;
         }
     }
+    return trim(line);
+}
+
+constexpr char foldCase(char c) {
+    return (c >= 'a' && c <= 'z') ? static_cast<char>(c - 'a' + 'A') : c;
+}
 
-    if (comment_pos != Str::npos) {
-        line = line.substr(0, comment_pos);
+constexpr Uint32 mnemonicHash(std::string_view s) {
+    Uint32 hash = 2166136261u;
+    for (char c : s) {
+        hash ^= static_cast<Uint8>(foldCase(c));
+        hash *= 16777619u;
     }
-    line = trim(line);
+    return hash;
 }
 
+struct Mnemonic {
+    std::string_view name;
+    OpCode op;
+};
+
+constexpr Mnemonic mnemonics[] = {
+    {"LOAD_CONST", OpCode::LOAD_CONST}, {"LOAD_NULL", OpCode::LOAD_NULL}, {"LOAD_TRUE", OpCode::LOAD_TRUE},
+    {"LOAD_FALSE", OpCode::LOAD_FALSE}, {"LOAD_INT", OpCode::LOAD_INT}, {"MOVE", OpCode::MOVE},
+    {"ADD", OpCode::ADD}, {"SUB", OpCode::SUB}, {"MUL", OpCode::MUL}, {"DIV", OpCode::DIV},
+    {"MOD", OpCode::MOD}, {"POW", OpCode::POW}, {"EQ", OpCode::EQ}, {"NEQ", OpCode::NEQ},
+    {"GT", OpCode::GT}, {"GE", OpCode::GE}, {"LT", OpCode::LT}, {"LE", OpCode::LE},
+    {"NEG", OpCode::NEG}, {"NOT", OpCode::NOT}, {"GET_GLOBAL", OpCode::GET_GLOBAL},
+    {"SET_GLOBAL", OpCode::SET_GLOBAL}, {"GET_UPVALUE", OpCode::GET_UPVALUE}, {"SET_UPVALUE", OpCode::SET_UPVALUE},
+    {"CLOSURE", OpCode::CLOSURE}, {"CLOSE_UPVALUES", OpCode::CLOSE_UPVALUES}, {"JUMP", OpCode::JUMP},
+    {"JUMP_IF_FALSE", OpCode::JUMP_IF_FALSE}, {"JUMP_IF_TRUE", OpCode::JUMP_IF_TRUE}, {"CALL", OpCode::CALL}, {"RETURN", OpCode::RETURN},
+    {"HALT", OpCode::HALT}, {"NEW_ARRAY", OpCode::NEW_ARRAY}, {"NEW_HASH", OpCode::NEW_HASH},
+    {"GET_INDEX", OpCode::GET_INDEX}, {"SET_INDEX", OpCode::SET_INDEX}, {"GET_KEYS", OpCode::GET_KEYS}, {"GET_VALUES", OpCode::GET_VALUES}, {"NEW_CLASS", OpCode::NEW_CLASS},
+    {"NEW_INSTANCE", OpCode::NEW_INSTANCE}, {"GET_PROP", OpCode::GET_PROP}, {"SET_PROP", OpCode::SET_PROP},
+    {"SET_METHOD", OpCode::SET_METHOD}, {"INHERIT", OpCode::INHERIT}, {"GET_SUPER", OpCode::GET_SUPER}, {"BIT_AND", OpCode::BIT_AND},
+    {"BIT_OR", OpCode::BIT_OR}, {"BIT_XOR", OpCode::BIT_XOR}, {"BIT_NOT", OpCode::BIT_NOT},
+    {"LSHIFT", OpCode::LSHIFT}, {"RSHIFT", OpCode::RSHIFT}, {"THROW", OpCode::THROW},
+    {"SETUP_TRY", OpCode::SETUP_TRY}, {"POP_TRY", OpCode::POP_TRY}, {"IMPORT_MODULE", OpCode::IMPORT_MODULE},
+    {"EXPORT", OpCode::EXPORT}, {"GET_EXPORT", OpCode::GET_EXPORT}, {"GET_MODULE_EXPORT", OpCode::GET_MODULE_EXPORT}, {"IMPORT_ALL", OpCode::IMPORT_ALL},
+    {"JUMP_IF_LT", OpCode::JUMP_IF_LT}, {"JUMP_IF_LE", OpCode::JUMP_IF_LE}, {"JUMP_IF_EQ", OpCode::JUMP_IF_EQ},
+    {"JUMP_IF_NOT_LT", OpCode::JUMP_IF_NOT_LT}, {"JUMP_IF_NOT_LE", OpCode::JUMP_IF_NOT_LE}, {"JUMP_IF_NOT_EQ", OpCode::JUMP_IF_NOT_EQ},
+    {"ADD_INT_IMM", OpCode::ADD_INT_IMM}, {"GET_PROP_CALL", OpCode::GET_PROP_CALL}, {"LOAD_CONST_RETURN", OpCode::LOAD_CONST_RETURN}
+};
+static_assert(std::size(mnemonics) == static_cast<size_t>(OpCode::TOTAL_OPCODES));
+
+// Bảng băm địa chỉ mở dựng lúc biên dịch, lưu chỉ số + 1 trong `mnemonics`
+// (0 là ô trống). Tra cứu không phân biệt hoa thường và không cấp phát.
+constexpr size_t mnemonicSlots = 256;
+static_assert(std::size(mnemonics) * 2 <= mnemonicSlots);
+
+constexpr auto mnemonicTable = [] {
+    std::array<Uint8, mnemonicSlots> slots{};
+    for (size_t i = 0; i < std::size(mnemonics); ++i) {
+        size_t slot = mnemonicHash(mnemonics[i].name) & (mnemonicSlots - 1);
+        while (slots[slot] != 0) slot = (slot + 1) & (mnemonicSlots - 1);
+        slots[slot] = static_cast<Uint8>(i + 1);
+    }
+    return slots;
+}();
+
+bool equalsIgnoreCase(std::string_view token, std::string_view upper) {
+    if (token.size() != upper.size()) return false;
+    for (size_t i = 0; i < token.size(); ++i) {
+        if (foldCase(token[i]) != upper[i]) return false;
+    }
+    return true;
+}
+
+std::optional<OpCode> lookupOpCode(std::string_view token) {
+    size_t slot = mnemonicHash(token) & (mnemonicSlots - 1);
+    while (Uint8 entry = mnemonicTable[slot]) {
+        const Mnemonic& mnemonic = mnemonics[entry - 1];
+        if (equalsIgnoreCase(token, mnemonic.name)) return mnemonic.op;
+        slot = (slot + 1) & (mnemonicSlots - 1);
+    }
+    return std::nullopt;
+}
+
+// Token phải là một số nguyên trọn vẹn (được phép có dấu '+' ở đầu).
+bool parseInt(std::string_view token, Int& out) {
+    if (token.size() > 1 && token.front() == '+' && token[1] != '-') token.remove_prefix(1);
+    const char* last = token.data() + token.size();
+    auto [ptr, ec] = std::from_chars(token.data(), last, out);
+    return ec == std::errc() && ptr == last && !token.empty();
+}
+
+bool parseReal(std::string_view token, Real& out) {
+    if (token.size() > 1 && token.front() == '+' && token[1] != '-') token.remove_prefix(1);
+    const char* last = token.data() + token.size();
+    auto [ptr, ec] = std::from_chars(token.data(), last, out);
+    return ec == std::errc() && ptr == last && !token.empty();
+}
+
+Int requireInt(std::string_view token, std::string_view what) {
+    Int value = 0;
+    if (!parseInt(token, value)) {
+        throw std::runtime_error(Str(what) + " cần số nguyên, nhận được '" + Str(token) + "'.");
+    }
+    return value;
+}
+
+}
+
+std::string_view opCodeName(OpCode op) {
+    for (const Mnemonic& mnemonic : mnemonics) {
+        if (mnemonic.op == op) return mnemonic.name;
+    }
+    return "UNKNOWN_OPCODE";
+}
 
 Bool BytecodeParser::parseFile(const Str& filepath, MemoryManager& mm) {
-    this->memoryManager = &mm;
-    std::ifstream ifs(filepath);
+    if (!parseFile(filepath)) return false;
+    protos = instantiate(takeParsed(), mm);
+    return true;
+}
+
+Bool BytecodeParser::parseFile(const Str& filepath) {
+    std::ifstream ifs(filepath, std::ios::binary);
     if (!ifs) {
-        std::cerr << "Error: Cannot open file: " << filepath << std::endl;
+        *diagnostics << "Error: Cannot open file: " << filepath << std::endl;
         return false;
     }
-    std::ostringstream ss;
-    ss << ifs.rdbuf();
-    Bool res = parseSource(ss.str(), filepath);
-    this->memoryManager = nullptr;
-    return res;
+    Str source;
+    ifs.seekg(0, std::ios::end);
+    auto size = ifs.tellg();
+    if (size > 0) {
+        source.resize(static_cast<size_t>(size));
+        ifs.seekg(0, std::ios::beg);
+        ifs.read(source.data(), size);
+        source.resize(static_cast<size_t>(ifs.gcount()));
+    }
+    return parseSource(source, filepath);
 }
 
-std::vector<Str> BytecodeParser::split(const Str& s) {
-    std::istringstream iss(s);
-    std::vector<Str> out;
-    Str tok;
-    while (std::getline(iss, tok)) {
-        std::istringstream iss2(tok);
-        Str sub_tok;
-        while (iss2 >> sub_tok) {
-            out.push_back(sub_tok);
-        }
+// Tách dòng thành các token (trỏ thẳng vào nguồn) vào `tokens`, vector được
+// giữ lại giữa các dòng nên không cấp phát sau vài dòng đầu.
+void BytecodeParser::split(std::string_view s) {
+    tokens.clear();
+    size_t i = 0;
+    while (i < s.size()) {
+        while (i < s.size() && isSpace(s[i])) ++i;
+        size_t start = i;
+        while (i < s.size() && !isSpace(s[i])) ++i;
+        if (i > start) tokens.push_back(s.substr(start, i - start));
     }
-    return out;
 }
 
 Bool BytecodeParser::parseSource(const Str& source, const Str& sourceName) {
     protos.clear();
+    parsed.clear();
     currentProto = nullptr;
-    std::istringstream iss(source);
-    Str line;
+    std::string_view rest(source);
     Int lineno = 0;
-    while (std::getline(iss, line)) {
+    while (!rest.empty()) {
+        size_t newline = rest.find('\n');
+        std::string_view line = rest.substr(0, newline);
+        rest.remove_prefix(newline == std::string_view::npos ? rest.size() : newline + 1);
         ++lineno;
-        skipComment(line);
+        line = skipComment(line);
         if (line.empty()) continue;
         try {
             if (!parseLine(line, sourceName, lineno)) return false;
         } catch (const std::exception& e) {
-            std::cerr << "Semantic error in '" << sourceName << "' at line " << lineno << ": " << e.what() << std::endl;
+            *diagnostics << "Semantic error in '" << sourceName << "' at line " << lineno << ": " << e.what() << std::endl;
             return false;
         }
     }
     if (currentProto) {
-        std::cerr << "Error in '" << sourceName << "': file ended but missed '.endfunc'" << std::endl;
+        *diagnostics << "Error in '" << sourceName << "': file ended but missed '.endfunc'" << std::endl;
         return false;
     }
     try {
         resolveAllLabels();
-        linkProtos();
     } catch (const std::exception& e) {
-        std::cerr << "Lỗi liên kết/nhãn: " << e.what() << std::endl;
+        *diagnostics << "Lỗi liên kết/nhãn: " << e.what() << std::endl;
         return false;
     }
+    BytecodeOptimizer(optimizationLevel, fusionLog).optimize(parsed);
+    buildStackMaps(parsed);
     return true;
 }
 
-Bool BytecodeParser::parseLine(const Str& line, const Str& sourceName, Int lineNumber) {
-    if (!line.empty() && line.back() == ':') {
+Bool BytecodeParser::parseLine(std::string_view line, const Str& sourceName, Int lineNumber) {
+    if (line.back() == ':') {
         if (!currentProto) throw std::runtime_error("Nhãn phải nằm trong một khối .func.");
-        Str label = line.substr(0, line.size() - 1);
-        if (currentProto->labels.count(label)) throw std::runtime_error("Nhãn '" + label + "' đã được định nghĩa.");
-        currentProto->labels[label] = currentProto->code.size();
+        Str label(line.substr(0, line.size() - 1));
+        auto [it, inserted] = currentProto->labels.try_emplace(std::move(label), currentProto->code.size());
+        if (!inserted) throw std::runtime_error("Nhãn '" + it->first + "' đã được định nghĩa.");
         return true;
     }
 
-    auto parts = split(line);
-    if (parts.empty()) return true;
-
-    if (parts[0].size() > 0 && parts[0][0] == '.') {
-        return parseDirective(parts, sourceName, lineNumber);
+    if (line.front() == '.') {
+        return parseDirective(line, sourceName, lineNumber);
     }
     if (!currentProto) throw std::runtime_error("Lệnh phải nằm trong một khối .func.");
 
-    static const std::unordered_map<Str, OpCode> OPC = {
-        {"LOAD_CONST", OpCode::LOAD_CONST}, {"LOAD_NULL", OpCode::LOAD_NULL}, {"LOAD_TRUE", OpCode::LOAD_TRUE},
-        {"LOAD_FALSE", OpCode::LOAD_FALSE}, {"LOAD_INT", OpCode::LOAD_INT}, {"MOVE", OpCode::MOVE},
-        {"ADD", OpCode::ADD}, {"SUB", OpCode::SUB}, {"MUL", OpCode::MUL}, {"DIV", OpCode::DIV},
-        {"MOD", OpCode::MOD}, {"POW", OpCode::POW}, {"EQ", OpCode::EQ}, {"NEQ", OpCode::NEQ},
-        {"GT", OpCode::GT}, {"GE", OpCode::GE}, {"LT", OpCode::LT}, {"LE", OpCode::LE},
-        {"NEG", OpCode::NEG}, {"NOT", OpCode::NOT}, {"GET_GLOBAL", OpCode::GET_GLOBAL},
-        {"SET_GLOBAL", OpCode::SET_GLOBAL}, {"GET_UPVALUE", OpCode::GET_UPVALUE}, {"SET_UPVALUE", OpCode::SET_UPVALUE},
-        {"CLOSURE", OpCode::CLOSURE}, {"CLOSE_UPVALUES", OpCode::CLOSE_UPVALUES}, {"JUMP", OpCode::JUMP},
-        {"JUMP_IF_FALSE", OpCode::JUMP_IF_FALSE}, {"JUMP_IF_TRUE", OpCode::JUMP_IF_TRUE}, {"CALL", OpCode::CALL}, {"RETURN", OpCode::RETURN},
-        {"HALT", OpCode::HALT}, {"NEW_ARRAY", OpCode::NEW_ARRAY}, {"NEW_HASH", OpCode::NEW_HASH},
-        {"GET_INDEX", OpCode::GET_INDEX}, {"SET_INDEX", OpCode::SET_INDEX}, {"GET_KEYS", OpCode::GET_KEYS}, {"GET_VALUES", OpCode::GET_VALUES}, {"NEW_CLASS", OpCode::NEW_CLASS},
-        {"NEW_INSTANCE", OpCode::NEW_INSTANCE}, {"GET_PROP", OpCode::GET_PROP}, {"SET_PROP", OpCode::SET_PROP},
-        {"SET_METHOD", OpCode::SET_METHOD}, {"INHERIT", OpCode::INHERIT}, {"GET_SUPER", OpCode::GET_SUPER}, {"BIT_AND", OpCode::BIT_AND},
-        {"BIT_OR", OpCode::BIT_OR}, {"BIT_XOR", OpCode::BIT_XOR}, {"BIT_NOT", OpCode::BIT_NOT},
-        {"LSHIFT", OpCode::LSHIFT}, {"RSHIFT", OpCode::RSHIFT}, {"THROW", OpCode::THROW},
-        {"SETUP_TRY", OpCode::SETUP_TRY}, {"POP_TRY", OpCode::POP_TRY}, {"IMPORT_MODULE", OpCode::IMPORT_MODULE},
-        {"EXPORT", OpCode::EXPORT}, {"GET_EXPORT", OpCode::GET_EXPORT}, {"GET_MODULE_EXPORT", OpCode::GET_MODULE_EXPORT}, {"IMPORT_ALL", OpCode::IMPORT_ALL}
-    };
-    Str upper_cmd = toUpper(parts[0]);
-    auto it = OPC.find(upper_cmd);
-    if (it == OPC.end()) throw std::runtime_error("Invalid opcode: '" + parts[0] + "'");
-    OpCode op = it->second;
-    std::vector<Int> args;
+    split(line);
+    std::optional<OpCode> opcode = lookupOpCode(tokens[0]);
+    if (!opcode) throw std::runtime_error("Invalid opcode: '" + Str(tokens[0]) + "'");
+    OpCode op = *opcode;
     Int instIndex = currentProto->code.size();
+
+    // Với lệnh nhảy, đối số đích không phải số nguyên là tên nhãn, được nối sau.
+    size_t labelArg = 0;
+    size_t numArgs = tokens.size() - 1;
     if (op == OpCode::JUMP || op == OpCode::SETUP_TRY) {
-        if (parts.size() < 2) throw std::runtime_error("'" + parts[0] + "' command needs a label or IP index.");
-        try {
-            args.push_back(std::stoi(parts[1]));
-        } catch (...) {
-            currentProto->pendingJumps.emplace_back(instIndex, 0, parts[1]);
-            args.push_back(0);
-        }
+        if (tokens.size() < 2) throw std::runtime_error("'" + Str(tokens[0]) + "' command needs a label or IP index.");
+        labelArg = numArgs = 1;
     } else if (op == OpCode::JUMP_IF_FALSE || op == OpCode::JUMP_IF_TRUE) {
-        if (parts.size() < 3) throw std::runtime_error("Lệnh '" + parts[0] + "' need 2 arguments: register and label/IP.");
-        
-        args.push_back(std::stoi(parts[1]));
-        
-        try {
-            args.push_back(std::stoi(parts[2]));
-        } catch (...) {
-            currentProto->pendingJumps.emplace_back(instIndex, 1, parts[2]);
-            args.push_back(0);
-        }
-    } else {
-        for (size_t i = 1; i < parts.size(); ++i) {
-            try {
-                args.push_back(std::stoi(parts[i]));
-            } catch (...) {
-                throw std::runtime_error("Invalid argument for '" + parts[0] + "' command. Make sure all arguments are integers.");
-            }
+        if (tokens.size() < 3) throw std::runtime_error("Lệnh '" + Str(tokens[0]) + "' need 2 arguments: register and label/IP.");
+        labelArg = numArgs = 2;
+    } else if (op >= OpCode::JUMP_IF_LT && op <= OpCode::JUMP_IF_NOT_EQ) {
+        if (tokens.size() < 5) throw std::runtime_error("Lệnh '" + Str(tokens[0]) + "' cần 4 đối số: thanh ghi kết quả, hai toán hạng và nhãn/IP.");
+        labelArg = numArgs = 4;
+    }
+    std::vector<Int> args(numArgs);
+    for (size_t i = 1; i <= numArgs; ++i) {
+        if (parseInt(tokens[i], args[i - 1])) continue;
+        if (i == labelArg) {
+            currentProto->pendingJumps.emplace_back(instIndex, i - 1, Str(tokens[i]));
+            args[i - 1] = 0;
+            continue;
         }
+        throw std::runtime_error("Invalid argument for '" + Str(tokens[0]) + "' command. Make sure all arguments are integers.");
     }
-    currentProto->code.emplace_back(op, args);
+    currentProto->code.emplace_back(op, std::move(args));
     return true;
 }
 
-Bool BytecodeParser::parseDirective(const std::vector<Str>& parts, [[maybe_unused]] const Str& sourceName, [[maybe_unused]] Int lineNumber) {
-    const Str& cmd = parts[0];
+Bool BytecodeParser::parseDirective(std::string_view line, [[maybe_unused]] const Str& sourceName, [[maybe_unused]] Int lineNumber) {
+    split(line);
+    std::string_view cmd = tokens[0];
     if (cmd == ".func") {
         if (currentProto) throw std::runtime_error("Không thể bắt đầu .func mới trong một .func khác.");
-        if (parts.size() < 2) throw std::runtime_error(".func yêu cầu tên hàm.");
+        if (tokens.size() < 2) throw std::runtime_error(".func yêu cầu tên hàm.");
 
-        currentProto = memoryManager->newObject<ObjFunctionProto>(0, 0, parts[1]);
-        protos[parts[1]] = currentProto;
+        Str name(tokens[1]);
+        ParsedProto& proto = parsed[name];
+        proto = ParsedProto{};
+        proto.name = std::move(name);
+        currentProto = &proto;
     } else if (cmd == ".endfunc") {
         if (!currentProto) throw std::runtime_error("Cannot find any .endfunc corresponding to .func.");
         currentProto = nullptr;
     } else {
-        if (!currentProto) throw std::runtime_error("'" + cmd + "' directive must be inside a .func block.");
+        if (!currentProto) throw std::runtime_error("'" + Str(cmd) + "' directive must be inside a .func block.");
         if (cmd == ".registers") {
-            if (parts.size() < 2) throw std::runtime_error(".registers cần 1 tham số.");
-            currentProto->numRegisters = std::stoi(parts[1]);
+            if (tokens.size() < 2) throw std::runtime_error(".registers cần 1 tham số.");
+            currentProto->numRegisters = requireInt(tokens[1], ".registers");
         } else if (cmd == ".upvalues") {
-            if (parts.size() < 2) throw std::runtime_error(".upvalues needs 1 parameter.");
-            currentProto->numUpvalues = std::stoi(parts[1]);
+            if (tokens.size() < 2) throw std::runtime_error(".upvalues needs 1 parameter.");
+            currentProto->numUpvalues = requireInt(tokens[1], ".upvalues");
         } 
         else if (cmd == ".const") {
-            if (parts.size() < 2) throw std::runtime_error(".const is missing parameter.");
-            Str rest;
-            for (size_t i = 1; i < parts.size(); ++i) {
-                if (i > 1) rest += " ";
-                rest += parts[i];
-            }
-            currentProto->constantPool.push_back(parseConstValue(rest));
+            if (tokens.size() < 2) throw std::runtime_error(".const is missing parameter.");
+            // Lấy nguyên phần còn lại của dòng để giữ đúng khoảng trắng trong chuỗi.
+            std::string_view value = line.substr(static_cast<size_t>(tokens[1].data() - line.data()));
+            currentProto->constantPool.push_back(parseConstValue(value));
         } else if (cmd == ".upvalue") {
-            if (parts.size() < 4) throw std::runtime_error(".upvalue yêu cầu 3 đối số.");
-            Int uvIndex = std::stoi(parts[1]);
-            Str uvType = parts[2];
-            Int slot = std::stoi(parts[3]);
+            if (tokens.size() < 4) throw std::runtime_error(".upvalue yêu cầu 3 đối số.");
+            Int uvIndex = requireInt(tokens[1], ".upvalue");
+            std::string_view uvType = tokens[2];
+            Int slot = requireInt(tokens[3], ".upvalue");
             Bool isLocal = (uvType == "local");
-            if (uvType != "local" && uvType != "parent_upvalue") throw std::runtime_error("Loại upvalue không hợp lệ: '" + uvType + "'.");
+            if (uvType != "local" && uvType != "parent_upvalue") throw std::runtime_error("Loại upvalue không hợp lệ: '" + Str(uvType) + "'.");
+            if (uvIndex < 0) throw std::runtime_error(".upvalue cần chỉ số không âm.");
             if (currentProto->upvalueDescs.size() <= static_cast<size_t>(uvIndex)) {
                 currentProto->upvalueDescs.resize(uvIndex + 1);
             }
             currentProto->upvalueDescs[uvIndex] = UpvalueDesc(isLocal, slot);
         } else {
-            throw std::runtime_error("Chỉ thị không nhận dạng được: '" + cmd + "'");
+            throw std::runtime_error("Chỉ thị không nhận dạng được: '" + Str(cmd) + "'");
         }
     }
     return true;
 }
 
-Str unescapeString(const Str& s) {
+Str unescapeString(std::string_view s) {
     Str result;
     result.reserve(s.length());
     bool escaping = false;
@@ -246,43 +333,57 @@ Str unescapeString(const Str& s) {
     return result;
 }
 
-Value BytecodeParser::parseConstValue(const Str& token) {
-    Str s = trim(token);
+Value BytecodeParser::parseConstValue(std::string_view token) {
+    std::string_view s = trim(token);
     if (s.size() >= 2 && s.front() == '"' && s.back() == '"') {
-        Str inner = s.substr(1, s.size() - 2);
-        return Value(unescapeString(inner));
+        return Value(unescapeString(s.substr(1, s.size() - 2)));
     }
     if (!s.empty() && s.front() == '@') {
-        return Value("::function_proto::" + s);
+        return Value("::function_proto::" + Str(s));
     }
-    if (s.find('.') != Str::npos) {
-        try { return Value(std::stod(s)); } catch (...) {}
-    }
-    try { return Value(std::stoi(s)); } catch (...) {}
+    Int intValue = 0;
+    if (parseInt(s, intValue)) return Value(intValue);
+    Real realValue = 0.0;
+    if (parseReal(s, realValue)) return Value(realValue);
     if (s == "true") return Value(true);
     if (s == "false") return Value(false);
     if (s == "null") return Value(Null{});
-    throw std::runtime_error("Hằng số không hợp lệ: '" + s + "'");
+    throw std::runtime_error("Hằng số không hợp lệ: '" + Str(s) + "'");
 }
 
 void BytecodeParser::resolveAllLabels() {
-    for (auto& pair : protos) {
-        auto proto = pair.second;
-        for (const auto& jump : proto->pendingJumps) {
+    for (auto& [name, proto] : parsed) {
+        for (const auto& jump : proto.pendingJumps) {
             Int instIdx = std::get<0>(jump);
             Int argIdx = std::get<1>(jump);
-            Str labelName = std::get<2>(jump);
-            auto it = proto->labels.find(labelName);
-            if (it == proto->labels.end()) {
-                throw std::runtime_error("Không tìm thấy nhãn '" + labelName + "' trong hàm '" + proto->sourceName + "'");
+            const Str& labelName = std::get<2>(jump);
+            auto it = proto.labels.find(labelName);
+            if (it == proto.labels.end()) {
+                throw std::runtime_error("Không tìm thấy nhãn '" + labelName + "' trong hàm '" + proto.name + "'");
             }
-            proto->code[instIdx].args[argIdx] = it->second;
+            proto.code[instIdx].args[argIdx] = it->second;
         }
-        proto->pendingJumps.clear();
+        proto.pendingJumps.clear();
+    }
+}
+
+std::unordered_map<Str, Proto> BytecodeParser::instantiate(ParsedModule module, MemoryManager& mm) {
+    std::unordered_map<Str, Proto> protos;
+    protos.reserve(module.size());
+    for (auto& [name, parsedProto] : module) {
+        auto proto = mm.newObject<ObjFunctionProto>(parsedProto.numRegisters, parsedProto.numUpvalues, parsedProto.name);
+        proto->constantPool = std::move(parsedProto.constantPool);
+        proto->upvalueDescs = std::move(parsedProto.upvalueDescs);
+        proto->code = std::move(parsedProto.code);
+        proto->labels = std::move(parsedProto.labels);
+        proto->stackMap = std::move(parsedProto.stackMap);
+        protos[name] = proto;
     }
+    linkProtos(protos);
+    return protos;
 }
 
-void BytecodeParser::linkProtos() {
+void BytecodeParser::linkProtos(std::unordered_map<Str, Proto>& protos) {
     const Str& prefix = "::function_proto::";
     for (auto& pair : protos) {
         auto proto = pair.second;
@@ -0,0 +1,138 @@
+#include "module_prefetcher.h"
+
+ModulePrefetchConfig ModulePrefetchConfig::fromEnvironment() {
+    ModulePrefetchConfig config;
+    if (const char* value = std::getenv("MEOW_MODULE_PREFETCH_THREADS"); value && *value) {
+        try {
+            config.threads = static_cast<size_t>(std::stoul(value));
+        } catch (const std::exception&) {
+            std::cerr << "Cảnh báo: bỏ qua MEOW_MODULE_PREFETCH_THREADS không hợp lệ: " << value << std::endl;
+        }
+    }
+    return config;
+}
+
+bool ModulePrefetchConfig::parseFlag(const Str& arg) {
+    if (arg == "--no-module-prefetch") {
+        threads = 0;
+        return true;
+    }
+    const Str threadsFlag = "--module-prefetch-threads=";
+    if (arg.rfind(threadsFlag, 0) == 0) {
+        Str value = arg.substr(threadsFlag.size());
+        size_t used = 0;
+        unsigned long parsed = 0;
+        try {
+            parsed = std::stoul(value, &used);
+        } catch (const std::exception&) {
+            used = 0;
+        }
+        if (value.empty() || used != value.size()) throw std::invalid_argument("Giá trị không hợp lệ cho " + arg);
+        threads = static_cast<size_t>(parsed);
+        return true;
+    }
+    return false;
+}
+
+size_t ModulePrefetchConfig::defaultThreads() {
+    // Luồng thông dịch vẫn chạy song song, nên chừa lại một lõi cho nó; máy một
+    // lõi thì đọc trước chỉ tranh CPU với luồng thông dịch.
+    size_t cores = std::thread::hardware_concurrency();
+    if (cores <= 1) return 0;
+    return std::min<size_t>(cores - 1, 4);
+}
+
+ModulePrefetcher::ModulePrefetcher(size_t threadCount, Resolver resolver, BytecodeCache cache, Int optimizationLevel)
+    : resolver(std::move(resolver)), cache(std::move(cache)), optimizationLevel(optimizationLevel) {
+    threads.reserve(threadCount);
+    for (size_t i = 0; i < threadCount; ++i) {
+        threads.emplace_back(&ModulePrefetcher::workerLoop, this);
+    }
+}
+
+ModulePrefetcher::~ModulePrefetcher() {
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        stopping = true;
+    }
+    wakeUp.notify_all();
+    for (auto& thread : threads) thread.join();
+}
+
+void ModulePrefetcher::scheduleImports(const ParsedModule& module, const Str& importerPath) {
+    std::vector<Str> paths;
+    for (const auto& [name, proto] : module) {
+        for (const Instruction& inst : proto.code) {
+            if (inst.op != OpCode::IMPORT_MODULE || inst.args.size() < 2) continue;
+            Int pathIdx = inst.args[1];
+            if (pathIdx < 0 || pathIdx >= static_cast<Int>(proto.constantPool.size())) continue;
+            const Value& path = proto.constantPool[pathIdx];
+            if (!path.is<Str>()) continue;
+            Str resolved = resolver(path.get<Str>(), importerPath);
+            if (!resolved.empty()) paths.push_back(std::move(resolved));
+        }
+    }
+    if (paths.empty()) return;
+
+    size_t added = 0;
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        for (Str& path : paths) {
+            if (!entries.try_emplace(path).second) continue;
+            queue.push_back(std::move(path));
+            ++added;
+        }
+    }
+    if (added == 1) wakeUp.notify_one();
+    else if (added > 1) wakeUp.notify_all();
+}
+
+std::optional<ParsedModule> ModulePrefetcher::take(const Str& absolutePath) {
+    std::unique_lock<std::mutex> lock(mutex);
+    auto it = entries.find(absolutePath);
+    if (it == entries.end()) return std::nullopt;
+    Entry& entry = it->second;
+    // Chưa luồng nào nhận thì luồng gọi tự parse luôn còn hơn ngồi chờ.
+    if (entry.state == State::Queued) {
+        entry.state = State::Taken;
+        return std::nullopt;
+    }
+    finished.wait(lock, [&entry] { return entry.state != State::Parsing; });
+    entry.state = State::Taken;
+    return std::exchange(entry.result, std::nullopt);
+}
+
+void ModulePrefetcher::workerLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        wakeUp.wait(lock, [this] { return stopping || !queue.empty(); });
+        if (stopping) return;
+        Str path = std::move(queue.front());
+        queue.pop_front();
+        Entry& entry = entries[path];
+        if (entry.state != State::Queued) continue;
+        entry.state = State::Parsing;
+
+        lock.unlock();
+        std::optional<ParsedModule> result = parse(path);
+        lock.lock();
+
+        entry.result = std::move(result);
+        entry.state = State::Done;
+        finished.notify_all();
+    }
+}
+
+std::optional<ParsedModule> ModulePrefetcher::parse(const Str& absolutePath) {
+    // Module đã có trong bytecode cache thì luồng thông dịch nạp từ đó nhanh hơn.
+    auto stamp = cache.stamp(absolutePath, optimizationLevel);
+    if (stamp && cache.contains(*stamp)) return std::nullopt;
+
+    std::ostringstream diagnostics;
+    BytecodeParser parser(diagnostics);
+    parser.setOptimizationLevel(optimizationLevel);
+    if (!parser.parseFile(absolutePath)) return std::nullopt;
+    ParsedModule module = parser.takeParsed();
+    scheduleImports(module, absolutePath);
+    return module;
+}
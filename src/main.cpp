@@ -2,31 +2,121 @@
 
 int main(int argc, char* argv[]) {
     if (argc < 2) {
-        std::cerr << "Usage: " << argv[0] << " [--binary] <entry_file>" << std::endl;
+        std::cerr << "Usage: " << argv[0] << " [--binary] [-O0|-O1|-O2] [--no-bytecode-cache] [--bytecode-cache-dir=DIR] [--no-module-prefetch] [--module-prefetch-threads=N] [--gc-threads=N] [--gc-min-heap=SIZE] [--gc-max-heap=SIZE] [--gc-growth=FACTOR] [--gc-lazy-sweep=on|off] [--gc-background-sweep=on|off] [--gc-compact=on|off] [--gc-compact-threshold=F] [--gc-stack-maps=on|off] [--gc-huge-pages=on|off] [--gc-numa=on|off] [--gc-stats] [--gc-alloc-profile] [--gc-heap-snapshot=FILE] [--image=FILE] [--write-image=FILE] <entry_file>" << std::endl;
         return 1;
     }
 
     Str entryPath;
     Bool isBinary = false;
+    Str imagePath;
+    Str writeImagePath;
+    GCConfig gcConfig = GCConfig::fromEnvironment();
+    BytecodeCache bytecodeCache = BytecodeCache::fromEnvironment();
+    ModulePrefetchConfig modulePrefetch = ModulePrefetchConfig::fromEnvironment();
+    OptimizerConfig optimizer = OptimizerConfig::fromEnvironment();
 
     for (int i = 1; i < argc; ++i) {
         Str arg = argv[i];
         if (arg == "--binary") {
             isBinary = true;
+        } else if (entryPath.empty() && arg.rfind("-O", 0) == 0) {
+            try {
+                optimizer.parseFlag(arg);
+            } catch (const std::exception& e) {
+                std::cerr << "Lỗi: " << e.what() << std::endl;
+                return 1;
+            }
+        } else if (entryPath.empty() && (arg == "--no-bytecode-cache" || arg.rfind("--bytecode-cache-", 0) == 0)) {
+            try {
+                if (!bytecodeCache.parseFlag(arg)) {
+                    std::cerr << "Lỗi: Cờ không hợp lệ: " << arg << std::endl;
+                    return 1;
+                }
+            } catch (const std::exception& e) {
+                std::cerr << "Lỗi: " << e.what() << std::endl;
+                return 1;
+            }
+        } else if (entryPath.empty() && (arg == "--no-module-prefetch" || arg.rfind("--module-prefetch-", 0) == 0)) {
+            try {
+                if (!modulePrefetch.parseFlag(arg)) {
+                    std::cerr << "Lỗi: Cờ không hợp lệ: " << arg << std::endl;
+                    return 1;
+                }
+            } catch (const std::exception& e) {
+                std::cerr << "Lỗi: " << e.what() << std::endl;
+                return 1;
+            }
+        } else if (entryPath.empty() && arg.rfind("--gc-", 0) == 0) {
+            try {
+                if (!gcConfig.parseFlag(arg)) {
+                    std::cerr << "Lỗi: Cờ GC không hợp lệ: " << arg << std::endl;
+                    return 1;
+                }
+            } catch (const std::exception& e) {
+                std::cerr << "Lỗi: " << e.what() << std::endl;
+                return 1;
+            }
+        } else if (entryPath.empty() && (arg.rfind("--image=", 0) == 0 || arg.rfind("--write-image=", 0) == 0)) {
+            Str& target = arg.rfind("--image=", 0) == 0 ? imagePath : writeImagePath;
+            target = arg.substr(arg.find('=') + 1);
+            if (target.empty()) {
+                std::cerr << "Lỗi: Giá trị không hợp lệ cho " << arg << std::endl;
+                return 1;
+            }
         } else if (entryPath.empty()) {
             entryPath = arg;
         }
     }
 
-    if (entryPath.empty()) {
+    // --write-image không có entry: ghi môi trường mặc định (module native và stdlib nạp sẵn).
+    if (entryPath.empty() && writeImagePath.empty()) {
         std::cerr << "Lỗi: Bạn phải cung cấp tên file đầu vào." << std::endl;
         return 1;
     }
 
-    MeowVM vm(".", argc, argv);
-    
+    MeowVM vm(".", argc, argv, gcConfig);
+    vm.setBytecodeCache(std::move(bytecodeCache));
+    vm.setModulePrefetch(modulePrefetch);
+    vm.setOptimizer(optimizer);
+    if (gcConfig.allocationProfile) {
+        vm.setAllocationProfiling(true);
+    }
+
+    if (!imagePath.empty()) {
+        try {
+            vm.loadHeapImage(imagePath);
+        } catch (const std::exception& e) {
+            std::cerr << "Lỗi: " << e.what() << std::endl;
+            return 1;
+        }
+    }
+
+    if (!entryPath.empty()) {
+        vm.interpret(entryPath, isBinary);
+    }
 
-    vm.interpret(entryPath, isBinary);
+    if (gcConfig.printStats) {
+        vm.getGCStats().printSummary(std::cerr);
+    }
+    if (gcConfig.allocationProfile) {
+        AllocationProfiler::printSummary(std::cerr, vm.getAllocationSites());
+    }
+    if (!gcConfig.heapSnapshotPath.empty()) {
+        try {
+            vm.writeHeapSnapshot(gcConfig.heapSnapshotPath);
+        } catch (const std::exception& e) {
+            std::cerr << "Lỗi: " << e.what() << std::endl;
+            return 1;
+        }
+    }
+    if (!writeImagePath.empty()) {
+        try {
+            vm.writeHeapImage(writeImagePath);
+        } catch (const std::exception& e) {
+            std::cerr << "Lỗi: " << e.what() << std::endl;
+            return 1;
+        }
+    }
     
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,176 @@
+#include "gc_config.h"
+
+static bool parseSize(const std::string& text, size_t& out) {
+    if (text.empty()) return false;
+    size_t value = 0;
+    for (char c : text) {
+        if (!std::isdigit(static_cast<unsigned char>(c))) return false;
+        size_t digit = static_cast<size_t>(c - '0');
+        if (value > (std::numeric_limits<size_t>::max() - digit) / 10) return false;
+        value = value * 10 + digit;
+    }
+    out = value;
+    return true;
+}
+
+static bool parseThreadCount(const std::string& text, size_t& out) {
+    size_t value = 0;
+    if (!parseSize(text, value) || value > GCConfig::maxMarkThreads) return false;
+    out = value;
+    return true;
+}
+
+// Kích thước dạng 512, 64K, 16M, 2G (không phân biệt hoa thường).
+static bool parseByteSize(const std::string& text, size_t& out) {
+    if (text.empty()) return false;
+    size_t multiplier = 1;
+    std::string digits = text;
+    switch (std::tolower(static_cast<unsigned char>(text.back()))) {
+        case 'k': multiplier = size_t(1) << 10; digits.pop_back(); break;
+        case 'm': multiplier = size_t(1) << 20; digits.pop_back(); break;
+        case 'g': multiplier = size_t(1) << 30; digits.pop_back(); break;
+        default: break;
+    }
+    size_t value = 0;
+    if (!parseSize(digits, value) || value > std::numeric_limits<size_t>::max() / multiplier) return false;
+    out = value * multiplier;
+    return true;
+}
+
+static bool parseFactor(const std::string& text, double& out) {
+    char* end = nullptr;
+    errno = 0;
+    double value = std::strtod(text.c_str(), &end);
+    if (text.empty() || errno != 0 || end != text.c_str() + text.size() || value <= 1.0) return false;
+    out = value;
+    return true;
+}
+
+static bool parseFraction(const std::string& text, double& out) {
+    char* end = nullptr;
+    errno = 0;
+    double value = std::strtod(text.c_str(), &end);
+    if (text.empty() || errno != 0 || end != text.c_str() + text.size() || value <= 0.0 || value >= 1.0) return false;
+    out = value;
+    return true;
+}
+
+static bool parseSwitch(const std::string& text, bool& out) {
+    std::string lower;
+    for (char c : text) lower += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    if (lower == "1" || lower == "on" || lower == "true" || lower == "yes") {
+        out = true;
+        return true;
+    }
+    if (lower == "0" || lower == "off" || lower == "false" || lower == "no") {
+        out = false;
+        return true;
+    }
+    return false;
+}
+
+GCConfig GCConfig::fromEnvironment() {
+    GCConfig config;
+    if (const char* threads = std::getenv("MEOW_GC_THREADS")) {
+        parseThreadCount(threads, config.markThreads);
+    }
+    if (const char* minHeap = std::getenv("MEOW_GC_MIN_HEAP")) {
+        parseByteSize(minHeap, config.minHeapBytes);
+    }
+    if (const char* maxHeap = std::getenv("MEOW_GC_MAX_HEAP")) {
+        parseByteSize(maxHeap, config.maxHeapBytes);
+    }
+    if (const char* growth = std::getenv("MEOW_GC_GROWTH")) {
+        parseFactor(growth, config.growthFactor);
+    }
+    if (const char* lazy = std::getenv("MEOW_GC_LAZY_SWEEP")) {
+        parseSwitch(lazy, config.lazySweep);
+    }
+    if (const char* background = std::getenv("MEOW_GC_BACKGROUND_SWEEP")) {
+        parseSwitch(background, config.backgroundSweep);
+    }
+    if (const char* compact = std::getenv("MEOW_GC_COMPACT")) {
+        parseSwitch(compact, config.compaction);
+    }
+    if (const char* threshold = std::getenv("MEOW_GC_COMPACT_THRESHOLD")) {
+        parseFraction(threshold, config.compactThreshold);
+    }
+    if (const char* stackMaps = std::getenv("MEOW_GC_STACK_MAPS")) {
+        parseSwitch(stackMaps, config.stackMaps);
+    }
+    if (const char* huge = std::getenv("MEOW_GC_HUGE_PAGES")) {
+        parseSwitch(huge, config.hugePages);
+    }
+    if (const char* numa = std::getenv("MEOW_GC_NUMA")) {
+        parseSwitch(numa, config.numaLocal);
+    }
+    if (const char* stats = std::getenv("MEOW_GC_STATS")) {
+        parseSwitch(stats, config.printStats);
+    }
+    if (const char* profile = std::getenv("MEOW_GC_ALLOC_PROFILE")) {
+        parseSwitch(profile, config.allocationProfile);
+    }
+    if (const char* snapshot = std::getenv("MEOW_GC_HEAP_SNAPSHOT")) {
+        config.heapSnapshotPath = snapshot;
+    }
+    return config;
+}
+
+bool GCConfig::parseFlag(const std::string& arg) {
+    if (arg == "--gc-stats") {
+        printStats = true;
+        return true;
+    }
+    if (arg == "--gc-alloc-profile") {
+        allocationProfile = true;
+        return true;
+    }
+    size_t eq = arg.find('=');
+    if (eq == std::string::npos) return false;
+    std::string name = arg.substr(0, eq);
+    std::string value = arg.substr(eq + 1);
+
+    bool ok = true;
+    if (name == "--gc-threads") {
+        ok = parseThreadCount(value, markThreads);
+    } else if (name == "--gc-min-heap") {
+        ok = parseByteSize(value, minHeapBytes);
+    } else if (name == "--gc-max-heap") {
+        ok = parseByteSize(value, maxHeapBytes);
+    } else if (name == "--gc-growth") {
+        ok = parseFactor(value, growthFactor);
+    } else if (name == "--gc-lazy-sweep") {
+        ok = parseSwitch(value, lazySweep);
+    } else if (name == "--gc-background-sweep") {
+        ok = parseSwitch(value, backgroundSweep);
+    } else if (name == "--gc-compact") {
+        ok = parseSwitch(value, compaction);
+    } else if (name == "--gc-compact-threshold") {
+        ok = parseFraction(value, compactThreshold);
+    } else if (name == "--gc-stack-maps") {
+        ok = parseSwitch(value, stackMaps);
+    } else if (name == "--gc-huge-pages") {
+        ok = parseSwitch(value, hugePages);
+    } else if (name == "--gc-numa") {
+        ok = parseSwitch(value, numaLocal);
+    } else if (name == "--gc-stats") {
+        ok = parseSwitch(value, printStats);
+    } else if (name == "--gc-alloc-profile") {
+        ok = parseSwitch(value, allocationProfile);
+    } else if (name == "--gc-heap-snapshot") {
+        heapSnapshotPath = value;
+        ok = !value.empty();
+    } else {
+        return false;
+    }
+    if (!ok) {
+        throw std::invalid_argument("Giá trị không hợp lệ cho " + arg);
+    }
+    return true;
+}
+
+size_t GCConfig::resolvedMarkThreads() const {
+    if (markThreads != 0) return markThreads;
+    size_t hw = std::thread::hardware_concurrency();
+    return hw == 0 ? 1 : hw;
+}
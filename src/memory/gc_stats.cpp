@@ -0,0 +1,45 @@
+#include "gc_stats.h"
+
+void GCStats::printSummary(std::ostream& os) const {
+    os << "[gc] " << cycles << " lần thu gom, tổng dừng " << std::fixed << std::setprecision(3)
+       << totalPauseMillis << " ms, lâu nhất " << maxPauseMillis << " ms\n";
+    os << "[gc] đã thu hồi " << objectsReclaimed << " object, " << bytesReclaimed << " byte\n";
+    if (compactions > 0) os << "[gc] " << compactions << " lần compact\n";
+    if (memory.chunks > 0) {
+        os << "[gc] heap: " << memory.chunks << " chunk 2 MiB (" << memory.reservedBytes << " byte), RSS "
+           << memory.residentBytes << " byte, huge page " << memory.hugePageBytes << " byte ("
+           << memory.hugePageCoverage() * 100.0 << "%), RSS tiến trình " << memory.processResidentBytes << " byte\n";
+    }
+
+    if (cycles == 0) return;
+
+    os << "[gc] histogram thời gian dừng:\n";
+    for (size_t i = 0; i < pauseHistogram.size(); ++i) {
+        if (i < pauseBucketLimits.size()) {
+            os << "  <= " << std::setw(7) << pauseBucketLimits[i] << " ms: ";
+        } else {
+            os << "  >  " << std::setw(7) << pauseBucketLimits.back() << " ms: ";
+        }
+        os << pauseHistogram[i] << '\n';
+    }
+
+    const GCCycleStats& last = history.back();
+    os << "[gc] lần cuối (" << gcReasonName(last.reason) << "): mark " << last.markMillis
+       << " ms, sweep " << last.sweepMillis << " ms, object " << last.objectsBefore << " -> " << last.objectsAfter
+       << ", byte " << last.bytesBefore << " -> " << last.bytesAfter << '\n';
+    if (last.reason == GCReason::Region) {
+        os << "[gc] region: chuyển " << last.movedObjects << " object ra heap trong " << last.compactMillis
+           << " ms, " << last.rememberedObjects << " object ngoài region được ghi nhớ\n";
+    } else if (last.movedObjects > 0) {
+        os << "[gc] compact: di chuyển " << last.movedObjects << " object trong " << last.compactMillis << " ms\n";
+    }
+    if (last.largeObjects > 0) {
+        os << "[gc] large-object space: " << last.largeObjects << " object, " << last.largeBytes << " byte\n";
+    }
+    for (size_t i = 0; i < last.liveObjects.size(); ++i) {
+        if (last.liveObjects[i] == 0) continue;
+        os << "  " << std::left << std::setw(12) << objectTypeName(static_cast<ObjectType>(i)) << std::right
+           << last.liveObjects[i] << '\n';
+    }
+    os.unsetf(std::ios::floatfield);
+}
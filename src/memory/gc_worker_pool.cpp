@@ -0,0 +1,59 @@
+#include "gc_worker_pool.h"
+
+GCWorkerPool::GCWorkerPool(size_t threadCount) {
+    size_t extra = threadCount > 1 ? threadCount - 1 : 0;
+    threads.reserve(extra);
+    for (size_t i = 0; i < extra; ++i) {
+        threads.emplace_back(&GCWorkerPool::workerLoop, this, i + 1);
+    }
+}
+
+GCWorkerPool::~GCWorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wakeUp.notify_all();
+    for (auto& t : threads) t.join();
+}
+
+void GCWorkerPool::run(const Task& task) {
+    if (threads.empty()) {
+        task(0);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        currentTask = &task;
+        pending = threads.size();
+        ++generation;
+    }
+    wakeUp.notify_all();
+
+    task(0);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [this] { return pending == 0; });
+    currentTask = nullptr;
+}
+
+void GCWorkerPool::workerLoop(size_t workerId) {
+    size_t seenGeneration = 0;
+    while (true) {
+        const Task* task = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wakeUp.wait(lock, [&] { return stopping || generation != seenGeneration; });
+            if (stopping) return;
+            seenGeneration = generation;
+            task = currentTask;
+        }
+
+        (*task)(workerId);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--pending == 0) finished.notify_one();
+        }
+    }
+}
@@ -0,0 +1,102 @@
+#include "heap_page.h"
+
+static constexpr size_t headerBytes(size_t headerSize) {
+    return (headerSize + HeapPage::cellAlignment - 1) & ~(HeapPage::cellAlignment - 1);
+}
+
+HeapPage* HeapPage::create(void* memory, size_t cellSize) noexcept {
+    return new (memory) HeapPage(cellSize);
+}
+
+HeapPage::HeapPage(size_t cellSize) noexcept {
+    reset(cellSize);
+}
+
+void HeapPage::reset(size_t newCellSize) noexcept {
+    cellBytes = newCellSize;
+    cells = (pageSize - headerBytes(sizeof(HeapPage))) / cellBytes;
+    allocated = 0;
+    bumpIndex = 0;
+    freeList = nullptr;
+    needsSweep = false;
+    inRegion = false;
+    markedCells.store(0, std::memory_order_relaxed);
+    permanentCells = 0;
+    std::fill(std::begin(allocatedBits), std::end(allocatedBits), 0);
+}
+
+std::byte* HeapPage::firstCell() noexcept {
+    return reinterpret_cast<std::byte*>(this) + headerBytes(sizeof(HeapPage));
+}
+
+size_t HeapPage::indexOf(const void* cell) noexcept {
+    return static_cast<size_t>(static_cast<const std::byte*>(cell) - firstCell()) / cellBytes;
+}
+
+MeowObject* HeapPage::objectAt(size_t index) noexcept {
+    return reinterpret_cast<MeowObject*>(firstCell() + index * cellBytes);
+}
+
+void* HeapPage::allocateCell() noexcept {
+    if (freeList) {
+        void* cell = freeList;
+        freeList = *static_cast<void**>(cell);
+        return cell;
+    }
+    if (bumpIndex < cells) {
+        return firstCell() + (bumpIndex++) * cellBytes;
+    }
+    return nullptr;
+}
+
+void HeapPage::releaseCell(void* cell) noexcept {
+    *static_cast<void**>(cell) = freeList;
+    freeList = cell;
+}
+
+void HeapPage::markAllocated(MeowObject* obj) noexcept {
+    size_t index = indexOf(obj);
+    allocatedBits[index / 64] |= uint64_t(1) << (index % 64);
+    ++allocated;
+}
+
+void HeapPage::forgetObject(MeowObject* obj) noexcept {
+    size_t index = indexOf(obj);
+    allocatedBits[index / 64] &= ~(uint64_t(1) << (index % 64));
+    --allocated;
+    releaseCell(obj);
+}
+
+size_t HeapPage::sweep() {
+    size_t freed = 0;
+    for (size_t word = 0; word < bitmapWords; ++word) {
+        uint64_t bits = allocatedBits[word];
+        while (bits != 0) {
+            size_t bit = static_cast<size_t>(std::countr_zero(bits));
+            bits &= bits - 1;
+            MeowObject* obj = objectAt(word * 64 + bit);
+            if (obj->gcMarked.load(std::memory_order_relaxed)) {
+                obj->gcMarked.store(false, std::memory_order_relaxed);
+                continue;
+            }
+            if (obj->gcPermanent) continue;
+            obj->~MeowObject();
+            allocatedBits[word] &= ~(uint64_t(1) << bit);
+            --allocated;
+            releaseCell(obj);
+            ++freed;
+        }
+    }
+    needsSweep = false;
+    return freed;
+}
+
+void HeapPage::destroyAll() {
+    forEachObject([](MeowObject* obj) { obj->~MeowObject(); });
+    std::fill(std::begin(allocatedBits), std::end(allocatedBits), 0);
+    allocated = 0;
+    bumpIndex = 0;
+    freeList = nullptr;
+    needsSweep = false;
+    permanentCells = 0;
+}
@@ -0,0 +1,157 @@
+#include "heap_snapshot.h"
+#include "mark_sweep_gc.h"
+#include "meow_vm.h"
+
+namespace {
+    // Duyệt đồ thị không dùng mark bit của GC nên có thể chụp bất cứ lúc nào
+    // giữa hai lệnh mà không ảnh hưởng tới chu kỳ thu gom.
+    class SnapshotBuilder : public GCVisitor {
+    public:
+        std::vector<HeapSnapshot::Node>& graph;
+        std::unordered_map<const MeowObject*, size_t> indexOf;
+        std::vector<MeowObject*> pending;
+        size_t currentNode = 0;
+
+        explicit SnapshotBuilder(std::vector<HeapSnapshot::Node>& nodes) : graph(nodes) {
+            graph.emplace_back();
+        }
+
+        void visitValue(Value& value) override {
+            visitObject(valueObject(value));
+        }
+
+        void visitObject(MeowObject* obj) override {
+            if (obj == nullptr) return;
+            auto [it, inserted] = indexOf.try_emplace(obj, graph.size());
+            if (inserted) {
+                HeapSnapshot::Node node;
+                node.object = obj;
+                node.type = obj->objectType();
+                node.selfBytes = obj->byteSize();
+                graph.push_back(std::move(node));
+                pending.push_back(obj);
+            }
+            graph[currentNode].edges.push_back(it->second);
+        }
+
+        void run(MeowVM& vm) {
+            vm.traceRoots(*this);
+            while (!pending.empty()) {
+                MeowObject* obj = pending.back();
+                pending.pop_back();
+                currentNode = indexOf[obj];
+                obj->trace(*this);
+            }
+        }
+    };
+}
+
+HeapSnapshot HeapSnapshot::capture(MeowVM& vm) {
+    HeapSnapshot snapshot;
+    SnapshotBuilder builder(snapshot.graph);
+    builder.run(vm);
+
+    for (auto& node : snapshot.graph) {
+        std::sort(node.edges.begin(), node.edges.end());
+        node.edges.erase(std::unique(node.edges.begin(), node.edges.end()), node.edges.end());
+    }
+    snapshot.computeRetainedSizes();
+    return snapshot;
+}
+
+// Dominator theo thuật toán lặp của Cooper, Harvey và Kennedy trên thứ tự
+// reverse postorder, rồi cộng dồn kích thước từ lá lên gốc cây dominator.
+void HeapSnapshot::computeRetainedSizes() {
+    const size_t count = graph.size();
+    constexpr size_t undefined = std::numeric_limits<size_t>::max();
+
+    std::vector<size_t> postorder;
+    std::vector<size_t> postIndex(count, undefined);
+    postorder.reserve(count);
+    {
+        std::vector<bool> visited(count, false);
+        std::vector<std::pair<size_t, size_t>> stack;
+        stack.emplace_back(0, 0);
+        visited[0] = true;
+        while (!stack.empty()) {
+            auto& [node, next] = stack.back();
+            if (next < graph[node].edges.size()) {
+                size_t child = graph[node].edges[next++];
+                if (!visited[child]) {
+                    visited[child] = true;
+                    stack.emplace_back(child, 0);
+                }
+            } else {
+                postIndex[node] = postorder.size();
+                postorder.push_back(node);
+                stack.pop_back();
+            }
+        }
+    }
+
+    std::vector<std::vector<size_t>> predecessors(count);
+    for (size_t i = 0; i < count; ++i) {
+        for (size_t child : graph[i].edges) predecessors[child].push_back(i);
+    }
+
+    std::vector<size_t> idom(count, undefined);
+    idom[0] = 0;
+    auto intersect = [&](size_t a, size_t b) {
+        while (a != b) {
+            while (postIndex[a] < postIndex[b]) a = idom[a];
+            while (postIndex[b] < postIndex[a]) b = idom[b];
+        }
+        return a;
+    };
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t k = postorder.size(); k-- > 0;) {
+            size_t node = postorder[k];
+            if (node == 0) continue;
+            size_t newIdom = undefined;
+            for (size_t pred : predecessors[node]) {
+                if (idom[pred] == undefined) continue;
+                newIdom = newIdom == undefined ? pred : intersect(pred, newIdom);
+            }
+            if (newIdom != idom[node]) {
+                idom[node] = newIdom;
+                changed = true;
+            }
+        }
+    }
+
+    for (auto& node : graph) node.retainedBytes = node.selfBytes;
+    for (size_t node : postorder) {
+        if (node != 0) graph[idom[node]].retainedBytes += graph[node].retainedBytes;
+    }
+}
+
+void HeapSnapshot::writeJson(std::ostream& os) const {
+    os << "{\n  \"totalBytes\": " << totalBytes() << ",\n  \"roots\": [";
+    for (size_t i = 0; i < graph[0].edges.size(); ++i) {
+        if (i) os << ", ";
+        os << graph[0].edges[i];
+    }
+    os << "],\n  \"nodes\": [\n";
+    for (size_t i = 1; i < graph.size(); ++i) {
+        const Node& node = graph[i];
+        os << "    {\"id\": " << i << ", \"type\": \"" << objectTypeName(node.type) << "\", \"size\": " << node.selfBytes
+           << ", \"retained\": " << node.retainedBytes << ", \"edges\": [";
+        for (size_t e = 0; e < node.edges.size(); ++e) {
+            if (e) os << ", ";
+            os << node.edges[e];
+        }
+        os << "]}" << (i + 1 < graph.size() ? ",\n" : "\n");
+    }
+    os << "  ]\n}\n";
+}
+
+void HeapSnapshot::writeToFile(const std::string& path) const {
+    std::ofstream out(path, std::ios::binary);
+    if (!out) {
+        throw std::runtime_error("Không thể mở file để ghi heap snapshot: " + path);
+    }
+    writeJson(out);
+}
@@ -2,86 +2,984 @@
 #include "meow_vm.h"
 #include "value.h"
 
+static inline void prefetchObject(const void* ptr) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(ptr, 1, 3);
+#else
+    (void)ptr;
+#endif
+}
+
+// Gray stack của một luồng mark. `local` chỉ chủ sở hữu đụng tới; `shared`
+// là phần công khai để các luồng rảnh có thể ăn cắp việc.
+//
+// Object mới gặp không được kiểm tra mark bit ngay mà đi qua một hàng đợi
+// FIFO nhỏ: header của nó được prefetch lúc vào hàng, và tới khi ra khỏi
+// hàng (sau prefetchDistance object khác) thì đã nằm sẵn trong cache.
+class MarkWorker : public GCVisitor {
+public:
+    static constexpr size_t publishThreshold = 64;
+    static constexpr size_t prefetchDistance = 8;
+
+    std::vector<MeowObject*> local;
+    std::deque<MeowObject*> shared;
+    std::atomic<size_t> sharedCount{0};
+    std::mutex sharedLock;
+    size_t markedBytes = 0;
+    size_t largeObjects = 0;
+    size_t largeBytes = 0;
+    std::array<size_t, static_cast<size_t>(ObjectType::Count)> liveObjects{};
+    // Object có tham chiếu yếu gặp trong lúc mark, xử lý sau khi mark xong.
+    std::vector<ObjWeakRef*> weakRefs;
+    std::vector<ObjWeakMap*> weakMaps;
+
+    std::array<MeowObject*, prefetchDistance> prefetchQueue{};
+    size_t prefetchHead = 0;
+    size_t prefetchCount = 0;
+
+    void visitValue(Value& value) override {
+        visitObject(valueObject(value));
+    }
+
+    void visitObject(MeowObject* obj) override {
+        if (obj == nullptr) return;
+        prefetchObject(obj);
+        if (prefetchCount == prefetchDistance) {
+            shade(prefetchQueue[prefetchHead]);
+            prefetchQueue[prefetchHead] = obj;
+            prefetchHead = (prefetchHead + 1) % prefetchDistance;
+        } else {
+            prefetchQueue[(prefetchHead + prefetchCount) % prefetchDistance] = obj;
+            ++prefetchCount;
+        }
+    }
+
+    void flushPrefetchQueue() {
+        while (prefetchCount > 0) {
+            shade(prefetchQueue[prefetchHead]);
+            prefetchHead = (prefetchHead + 1) % prefetchDistance;
+            --prefetchCount;
+        }
+    }
+
+    bool pop(MeowObject*& out) {
+        if (local.empty()) flushPrefetchQueue();
+        if (!local.empty()) {
+            out = local.back();
+            local.pop_back();
+            if (!local.empty()) prefetchObject(local.back());
+            return true;
+        }
+        if (sharedCount.load(std::memory_order_relaxed) == 0) return false;
+        std::lock_guard<std::mutex> lock(sharedLock);
+        if (shared.empty()) return false;
+        out = shared.back();
+        shared.pop_back();
+        sharedCount.store(shared.size(), std::memory_order_relaxed);
+        return true;
+    }
+
+    void publishIfNeeded() {
+        if (local.size() < publishThreshold || sharedCount.load(std::memory_order_relaxed) != 0) return;
+        size_t half = local.size() / 2;
+        std::lock_guard<std::mutex> lock(sharedLock);
+        shared.insert(shared.end(), local.begin(), local.begin() + half);
+        local.erase(local.begin(), local.begin() + half);
+        sharedCount.store(shared.size(), std::memory_order_release);
+    }
+
+    bool stealFrom(MarkWorker& victim) {
+        if (victim.sharedCount.load(std::memory_order_acquire) == 0) return false;
+        std::lock_guard<std::mutex> lock(victim.sharedLock);
+        if (victim.shared.empty()) return false;
+        size_t take = (victim.shared.size() + 1) / 2;
+        local.insert(local.end(), victim.shared.begin(), victim.shared.begin() + take);
+        victim.shared.erase(victim.shared.begin(), victim.shared.begin() + take);
+        victim.sharedCount.store(victim.shared.size(), std::memory_order_relaxed);
+        return true;
+    }
+
+private:
+    void shade(MeowObject* obj) {
+        if (MarkSweepGC::tryMark(obj)) local.push_back(obj);
+    }
+};
+
+// Bảng tra theo tag giống valueObject (definitions.h), nhưng ghi lại con trỏ
+// object của alternative hiện tại.
+using ObjectReplacer = void (*)(Value&, MeowObject*) noexcept;
+
+template<size_t I>
+static void replaceObjectAt(Value& value, MeowObject* obj) noexcept {
+    using Alternative = std::variant_alternative_t<I, BaseValue>;
+    if constexpr (std::is_pointer_v<Alternative> &&
+                  std::is_base_of_v<MeowObject, std::remove_pointer_t<Alternative>>) {
+        *std::get_if<I>(static_cast<BaseValue*>(&value)) = static_cast<Alternative>(obj);
+    }
+}
+
+template<size_t... Is>
+static constexpr std::array<ObjectReplacer, sizeof...(Is)> makeObjectReplacers(std::index_sequence<Is...>) {
+    return { &replaceObjectAt<Is>... };
+}
+
+static constexpr auto objectReplacers = makeObjectReplacers(std::make_index_sequence<std::variant_size_v<BaseValue>>{});
+
+// Sau khi compact, ghi lại mọi tham chiếu tới object đã bị chuyển chỗ.
+class ForwardingVisitor : public GCVisitor {
+public:
+    const std::unordered_map<MeowObject*, MeowObject*>& forwarding;
+
+    explicit ForwardingVisitor(const std::unordered_map<MeowObject*, MeowObject*>& table) : forwarding(table) {}
+
+    void visitValue(Value& value) override {
+        MeowObject* obj = valueObject(value);
+        if (obj == nullptr) return;
+        auto it = forwarding.find(obj);
+        if (it != forwarding.end()) MarkSweepGC::replaceObject(value, it->second);
+    }
+
+    void visitObject(MeowObject*) override {}
+
+    void visitObjectSlot(MeowObject*& slot) override {
+        if (slot == nullptr) return;
+        auto it = forwarding.find(slot);
+        if (it != forwarding.end()) slot = it->second;
+    }
+};
+
+// Mark object của region đang đóng. Object ngoài region không được duyệt tiếp:
+// tham chiếu từ chúng vào region đều đã qua write barrier và nằm trong
+// remembered set, nên heap thường không bị mark.
+class RegionMarker : public GCVisitor {
+public:
+    std::vector<MeowObject*> gray;
+    std::vector<MeowObject*> survivors;
+    std::vector<ObjWeakRef*> weakRefs;
+    std::vector<ObjWeakMap*> weakMaps;
+
+    static bool inRegion(const MeowObject* obj) noexcept {
+        return HeapPage::pageOf(obj)->inRegion && !obj->gcPermanent;
+    }
+
+    static bool isLive(const MeowObject* obj) noexcept {
+        return !inRegion(obj) || obj->gcMarked.load(std::memory_order_relaxed);
+    }
+
+    void visitValue(Value& value) override {
+        visitObject(valueObject(value));
+    }
+
+    void visitObject(MeowObject* obj) override {
+        if (obj == nullptr || !inRegion(obj)) return;
+        if (MarkSweepGC::tryMark(obj)) gray.push_back(obj);
+    }
+
+    // Owner ngoài region: duyệt tham chiếu của nó nhưng không mark chính nó.
+    void traceOwner(MeowObject* owner) {
+        noteWeak(owner);
+        owner->trace(*this);
+    }
+
+    void drain() {
+        while (!gray.empty()) {
+            MeowObject* obj = gray.back();
+            gray.pop_back();
+            survivors.push_back(obj);
+            noteWeak(obj);
+            obj->trace(*this);
+        }
+    }
+
+    // Ephemeron như processWeakReferences của lần mark đầy đủ, chỉ xét object của region.
+    void processWeakReferences() {
+        bool marked = true;
+        while (marked) {
+            marked = false;
+            for (ObjWeakMap* map : weakMaps) {
+                for (auto& [_, entry] : map->entries) {
+                    if (!isLive(entry.keyObject)) continue;
+                    MeowObject* value = valueObject(entry.value);
+                    if (value && !isLive(value)) {
+                        visitObject(value);
+                        marked = true;
+                    }
+                }
+            }
+            drain();
+        }
+
+        for (ObjWeakRef* ref : weakRefs) {
+            MeowObject* target = valueObject(ref->target);
+            if (target && !isLive(target)) ref->target = Null{};
+        }
+        for (ObjWeakMap* map : weakMaps) {
+            std::erase_if(map->entries, [](const auto& item) { return !isLive(item.second.keyObject); });
+        }
+    }
+
+private:
+    void noteWeak(MeowObject* obj) {
+        if (obj->objectType() == ObjectType::WeakRef) {
+            weakRefs.push_back(static_cast<ObjWeakRef*>(obj));
+        } else if (obj->objectType() == ObjectType::WeakMap) {
+            weakMaps.push_back(static_cast<ObjWeakMap*>(obj));
+        }
+    }
+};
+
+MarkSweepGC::MarkSweepGC(const GCConfig& gcConfig)
+    : config(gcConfig), pageAllocator(gcConfig.hugePages, gcConfig.numaLocal) {
+    size_t threads = config.resolvedMarkThreads();
+    markWorkers.reserve(threads);
+    for (size_t i = 0; i < threads; ++i) {
+        markWorkers.push_back(std::make_unique<MarkWorker>());
+    }
+    workerPool = std::make_unique<GCWorkerPool>(threads);
+    if (config.backgroundSweep) {
+        sweeperThread = std::thread(&MarkSweepGC::backgroundSweepLoop, this);
+    }
+}
+
 MarkSweepGC::~MarkSweepGC() {
-    for (auto const& [obj, data] : metadata) {
+    if (sweeperThread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(pagePoolLock);
+            sweeperStopping = true;
+        }
+        sweeperWake.notify_one();
+        sweeperThread.join();
+    }
+    workerPool.reset();
+
+    for (auto& sizeClass : sizeClasses) {
+        for (auto* pages : { &sizeClass.pages, &sizeClass.regionPages }) {
+            for (HeapPage* page : *pages) {
+                page->destroyAll();
+                releasePage(page);
+            }
+        }
+    }
+    for (HeapPage* page : deadPages) {
+        page->destroyAll();
+        releasePage(page);
+    }
+    for (HeapPage* page : freePages) {
+        releasePage(page);
+    }
+}
+
+MarkSweepGC::SizeClass& MarkSweepGC::sizeClassFor(size_t size) {
+    size_t index = (size + HeapPage::cellAlignment - 1) / HeapPage::cellAlignment;
+    if (index == 0) index = 1;
+    if (index >= sizeClasses.size()) {
+        if (index * HeapPage::cellAlignment > HeapPage::pageSize / 4) {
+            throw std::length_error("Object quá lớn so với trang heap: " + std::to_string(size) + " byte.");
+        }
+        sizeClasses.resize(index + 1);
+    }
+    return sizeClasses[index];
+}
+
+HeapPage* MarkSweepGC::acquirePage(size_t cellSize) {
+    {
+        std::lock_guard<std::mutex> lock(pagePoolLock);
+        if (!freePages.empty()) {
+            HeapPage* page = freePages.back();
+            freePages.pop_back();
+            page->reset(cellSize);
+            return page;
+        }
+    }
+    return HeapPage::create(pageAllocator.allocate(), cellSize);
+}
+
+void MarkSweepGC::recyclePage(HeapPage* page) {
+    {
+        std::lock_guard<std::mutex> lock(pagePoolLock);
+        if (freePages.size() < maxFreePages) {
+            freePages.push_back(page);
+            return;
+        }
+    }
+    releasePage(page);
+}
+
+void MarkSweepGC::releasePage(HeapPage* page) noexcept {
+    page->~HeapPage();
+    pageAllocator.release(page);
+}
+
+void* MarkSweepGC::allocate(size_t size) {
+    SizeClass& sizeClass = sizeClassFor(size);
+    size_t cellSize = ((size + HeapPage::cellAlignment - 1) / HeapPage::cellAlignment) * HeapPage::cellAlignment;
+    if (regionActive) return allocateInRegion(sizeClass, cellSize);
+
+    if (sizeClass.current) {
+        if (void* cell = sizeClass.current->allocateCell()) return cell;
+    }
 
-        delete obj;
+    // Lazy sweep: chỉ sweep trang kế tiếp khi thật sự cần cell.
+    while (sizeClass.sweepCursor < sizeClass.pages.size()) {
+        HeapPage* page = sizeClass.pages[sizeClass.sweepCursor++];
+        if (page->needsSweep) page->sweep();
+        if (page->hasFreeCell()) {
+            sizeClass.current = page;
+            return page->allocateCell();
+        }
     }
+
+    HeapPage* page = acquirePage(cellSize);
+    sizeClass.pages.push_back(page);
+    sizeClass.sweepCursor = sizeClass.pages.size();
+    sizeClass.current = page;
+    return page->allocateCell();
+}
+
+void* MarkSweepGC::allocateInRegion(SizeClass& sizeClass, size_t cellSize) {
+    if (sizeClass.regionCurrent) {
+        if (void* cell = sizeClass.regionCurrent->allocateCell()) return cell;
+    }
+
+    while (sizeClass.regionCursor < sizeClass.regionPages.size()) {
+        HeapPage* page = sizeClass.regionPages[sizeClass.regionCursor++];
+        if (page->needsSweep) page->sweep();
+        if (page->hasFreeCell()) {
+            sizeClass.regionCurrent = page;
+            return page->allocateCell();
+        }
+    }
+
+    HeapPage* page = acquirePage(cellSize);
+    page->inRegion = true;
+    sizeClass.regionPages.push_back(page);
+    sizeClass.regionCursor = sizeClass.regionPages.size();
+    sizeClass.regionCurrent = page;
+    return page->allocateCell();
+}
+
+void MarkSweepGC::releaseCell(void* cell) noexcept {
+    HeapPage::pageOf(cell)->releaseCell(cell);
 }
 
 void MarkSweepGC::registerObject(MeowObject* obj) {
+    obj->gcRegistered = true;
+    HeapPage::pageOf(obj)->markAllocated(obj);
+}
+
+void MarkSweepGC::makePermanent(MeowObject* obj) {
+    obj->gcPermanent = true;
+    ++HeapPage::pageOf(obj)->permanentCells;
+    permanentBytes += obj->byteSize();
+    ++permanentCount;
+    if (obj->hasMutableReferences()) permanentRoots.push_back(obj);
+}
 
-    metadata.emplace(obj, GCMetadata{});
+void MarkSweepGC::growPermanent(size_t bytes) {
+    permanentBytes += bytes;
 }
 
-void MarkSweepGC::collect(MeowVM& vmInstance) {
+void MarkSweepGC::releasePermanent() {
+    // Trang chưa sweep coi object không được mark là rác, mà object vĩnh viễn
+    // thì không bao giờ được mark: phải sweep xong trước khi bỏ cờ.
+    finishSweeping();
+    for (auto& sizeClass : sizeClasses) {
+        for (auto* pages : { &sizeClass.pages, &sizeClass.regionPages }) {
+            for (HeapPage* page : *pages) {
+                if (page->permanentCells == 0) continue;
+                page->forEachObject([](MeowObject* obj) { obj->gcPermanent = false; });
+                page->permanentCells = 0;
+            }
+        }
+    }
+    markedBytes += permanentBytes;
+    permanentBytes = 0;
+    permanentCount = 0;
+    permanentRoots.clear();
+}
+
+std::shared_ptr<MeowObject*> MarkSweepGC::pin(MeowObject* obj) {
+    auto cell = std::make_shared<MeowObject*>(obj);
+    pins.push_back(cell);
+    return cell;
+}
+
+void MarkSweepGC::collect(MeowVM& vmInstance, bool atSafepoint) {
+    using Clock = std::chrono::steady_clock;
+    auto millisSince = [](Clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    };
+
     this->vm = &vmInstance;
+    cycleStats = GCCycleStats{};
+
+    auto sweepStart = Clock::now();
+    finishSweeping();
+    cycleStats.sweepMillis = millisSince(sweepStart);
+
+    mark(nullptr);
+    // Owner đã chết trong lúc region mở thì không còn tham chiếu nào để duyệt.
+    if (regionActive) std::erase_if(rememberedSet, [](MeowObject* obj) { return !isLive(obj); });
+
+    if (atSafepoint && !regionActive && config.compaction && shouldCompact()) {
+        auto compactStart = Clock::now();
+        cycleStats.movedObjects = compact();
+        cycleStats.compactMillis = millisSince(compactStart);
+    } else {
+        // Với lazy sweep, phần lớn việc sweep dồn sang bộ cấp phát và không nằm trong số này.
+        sweepStart = Clock::now();
+        scheduleSweep();
+        cycleStats.sweepMillis += millisSince(sweepStart);
+    }
+
+    this->vm = nullptr;
+}
 
-    // auto roots = vm->findRoots();
-    // for (Value* root : roots) {
-    //     visitValue(*root);
-    // }
+void MarkSweepGC::mark(Value* extraRoot) {
+    using Clock = std::chrono::steady_clock;
 
+    auto markStart = Clock::now();
+    markedBytes = 0;
+    rootCursor = 0;
+    for (auto& worker : markWorkers) {
+        worker->markedBytes = 0;
+        worker->largeObjects = 0;
+        worker->largeBytes = 0;
+        worker->liveObjects.fill(0);
+        worker->weakRefs.clear();
+        worker->weakMaps.clear();
+    }
+    for (auto& sizeClass : sizeClasses) {
+        for (auto* pages : { &sizeClass.pages, &sizeClass.regionPages }) {
+            for (HeapPage* page : *pages) {
+                cycleStats.objectsBefore += page->allocatedCount();
+                page->markedCells.store(0, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Root được chia vòng tròn cho các worker, sau đó mỗi worker tự duyệt
+    // gray stack của mình (không đệ quy, nên đồ thị sâu không làm tràn stack).
+    vm->clearDeadRegisters();
     vm->traceRoots(*this);
+    for (MeowObject* obj : permanentRoots) {
+        obj->traceMutable(*this);
+    }
+    // Chỉ còn GC giữ shared_ptr nghĩa là mọi GCPin đã bị huỷ.
+    std::erase_if(pins, [](const std::shared_ptr<MeowObject*>& cell) { return cell.use_count() == 1; });
+    for (auto& cell : pins) {
+        visitObject(*cell);
+    }
+    if (extraRoot) visitValue(*extraRoot);
 
-    for (auto it = metadata.begin(); it != metadata.end();) {
-        MeowObject* obj = it->first;
-        GCMetadata& data = it->second;
+    drainMarkWorkers();
+    processWeakReferences();
 
-        if (data.isMarked) {
-            data.isMarked = false;
-            ++it;
-        } else {
+    for (auto& worker : markWorkers) {
+        markedBytes += worker->markedBytes;
+        cycleStats.largeObjects += worker->largeObjects;
+        cycleStats.largeBytes += worker->largeBytes;
+        for (size_t i = 0; i < worker->liveObjects.size(); ++i) {
+            cycleStats.liveObjects[i] += worker->liveObjects[i];
+            cycleStats.objectsAfter += worker->liveObjects[i];
+        }
+    }
+    cycleStats.objectsBefore -= permanentCount;
+    cycleStats.markMillis = std::chrono::duration<double, std::milli>(Clock::now() - markStart).count();
+}
+
+void MarkSweepGC::replaceObject(Value& value, MeowObject* obj) noexcept {
+    objectReplacers[value.index()](value, obj);
+}
+
+bool MarkSweepGC::shouldCompact() const {
+    size_t totalCells = 0;
+    size_t liveCells = 0;
+    size_t pageCount = 0;
+    for (const auto& sizeClass : sizeClasses) {
+        for (HeapPage* page : sizeClass.pages) {
+            totalCells += page->cellCount();
+            liveCells += page->markedCells.load(std::memory_order_relaxed) + page->permanentCells;
+            ++pageCount;
+        }
+    }
+    if (pageCount < 2 || totalCells == 0) return false;
+    double fragmentation = 1.0 - static_cast<double>(liveCells) / static_cast<double>(totalCells);
+    return fragmentation >= config.compactThreshold;
+}
+
+// Compact kiểu evacuate theo từng size class: sweep hết, rồi dời object từ
+// trang thưa nhất sang cell trống của trang dày nhất, sau đó sửa mọi tham
+// chiếu qua bảng forwarding. Trang có object vĩnh viễn hoặc bị ghim không bị dời.
+size_t MarkSweepGC::compact() {
+    std::vector<HeapPage*> allPages;
+    for (auto& sizeClass : sizeClasses) {
+        allPages.insert(allPages.end(), sizeClass.pages.begin(), sizeClass.pages.end());
+    }
+    sweepPages(allPages);
+
+    std::vector<const HeapPage*> pinnedPages;
+    for (auto& cell : pins) {
+        if (*cell) pinnedPages.push_back(HeapPage::pageOf(*cell));
+    }
+
+    std::unordered_map<MeowObject*, MeowObject*> forwarding;
+    std::vector<MeowObject*> victims;
+
+    for (auto& sizeClass : sizeClasses) {
+        auto& pages = sizeClass.pages;
+        std::sort(pages.begin(), pages.end(), [](const HeapPage* a, const HeapPage* b) {
+            return a->allocatedCount() > b->allocatedCount();
+        });
+
+        size_t target = 0;
+        size_t source = pages.size();
+        while (source > 0 && target < source - 1) {
+            HeapPage* from = pages[source - 1];
+            if (from->permanentCells > 0 ||
+                std::find(pinnedPages.begin(), pinnedPages.end(), from) != pinnedPages.end()) {
+                --source;
+                continue;
+            }
+
+            victims.clear();
+            from->forEachObject([&](MeowObject* obj) { victims.push_back(obj); });
+
+            size_t moved = 0;
+            for (MeowObject* obj : victims) {
+                void* cell = nullptr;
+                while (target < source - 1 && (cell = pages[target]->allocateCell()) == nullptr) ++target;
+                if (cell == nullptr) break;
+
+                MeowObject* copy = obj->relocateTo(cell);
+                obj->~MeowObject();
+                from->forgetObject(obj);
+                copy->gcRegistered = true;
+                pages[target]->markAllocated(copy);
+                forwarding.emplace(obj, copy);
+                ++moved;
+            }
+            if (moved < victims.size()) break;
+            --source;
+        }
+
+        size_t kept = 0;
+        for (HeapPage* page : pages) {
+            if (page->isEmpty()) {
+                recyclePage(page);
+            } else {
+                pages[kept++] = page;
+            }
+        }
+        pages.resize(kept);
+        sizeClass.sweepCursor = 0;
+        sizeClass.current = nullptr;
+    }
+
+    fixupReferences(forwarding, nullptr);
+    return forwarding.size();
+}
+
+void MarkSweepGC::fixupReferences(const std::unordered_map<MeowObject*, MeowObject*>& forwarding, Value* extraRoot) {
+    if (forwarding.empty()) return;
+
+    ForwardingVisitor fixup(forwarding);
+    vm->traceRoots(fixup);
+    for (MeowObject* obj : permanentRoots) {
+        obj->traceMutable(fixup);
+    }
+    for (auto& cell : pins) {
+        fixup.visitObjectSlot(*cell);
+    }
+    if (extraRoot) fixup.visitValue(*extraRoot);
+    for (auto& sizeClass : sizeClasses) {
+        for (HeapPage* page : sizeClass.pages) {
+            page->forEachObject([&](MeowObject* obj) {
+                obj->trace(fixup);
+                obj->traceWeak(fixup);
+                if (obj->objectType() == ObjectType::WeakMap) static_cast<ObjWeakMap*>(obj)->rekey();
+            });
+        }
+    }
+}
+
+void MarkSweepGC::beginRegion() {
+    if (regionActive) throw std::runtime_error("Không hỗ trợ mở region lồng nhau.");
+    regionActive = true;
+}
+
+void MarkSweepGC::rememberStore(MeowObject* owner, const Value& value) {
+    MeowObject* target = valueObject(value);
+    if (owner == nullptr || target == nullptr || owner->gcRemembered) return;
+    if (!RegionMarker::inRegion(target) || RegionMarker::inRegion(owner)) return;
+    owner->gcRemembered = true;
+    rememberedSet.push_back(owner);
+}
+
+// Đóng region mà không mark heap thường: object của region chỉ có thể được
+// tham chiếu từ root, từ result, từ object khác của region hoặc từ owner trong
+// remembered set. Duyệt từ các nguồn đó, chuyển object còn sống sang trang
+// thường, sửa tham chiếu ở đúng các nguồn đó rồi trả cả trang về pool, nên chi
+// phí tỷ lệ với root, remembered set và phần sống của region chứ không với cỡ
+// heap. Trang có object vĩnh viễn (ví dụ module nạp trong region) được giữ lại
+// làm trang thường vì object vĩnh viễn không được di chuyển.
+size_t MarkSweepGC::endRegion(MeowVM& vmInstance, Value& result) {
+    using Clock = std::chrono::steady_clock;
+    auto millisSince = [](Clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    };
+    if (!regionActive) return 0;
+
+    this->vm = &vmInstance;
+    cycleStats = GCCycleStats{};
+
+    // Một lần collect đầy đủ trong lúc region mở có thể để lại mark bit trên
+    // trang region; sweep chúng trước (chỉ trang region, không đụng heap thường).
+    auto sweepStart = Clock::now();
+    for (auto& sizeClass : sizeClasses) {
+        for (HeapPage* page : sizeClass.regionPages) {
+            if (page->needsSweep) page->sweep();
+            page->markedCells.store(0, std::memory_order_relaxed);
+            cycleStats.objectsBefore += page->allocatedCount() - page->permanentCells;
+        }
+    }
+    cycleStats.sweepMillis = millisSince(sweepStart);
+
+    auto markStart = Clock::now();
+    RegionMarker marker;
+    vm->clearDeadRegisters();
+    vm->traceRoots(marker);
+    std::erase_if(pins, [](const std::shared_ptr<MeowObject*>& cell) { return cell.use_count() == 1; });
+    for (auto& cell : pins) {
+        marker.visitObject(*cell);
+    }
+    marker.visitValue(result);
+    // Object vĩnh viễn tạo trong region có thể đã nhận tham chiếu trước khi
+    // thành vĩnh viễn (lúc barrier còn coi nó là object của region).
+    for (auto& sizeClass : sizeClasses) {
+        for (HeapPage* page : sizeClass.regionPages) {
+            if (page->permanentCells == 0) continue;
+            page->forEachObject([&](MeowObject* obj) {
+                if (obj->gcPermanent && obj->hasMutableReferences() && !obj->gcRemembered) {
+                    obj->gcRemembered = true;
+                    rememberedSet.push_back(obj);
+                }
+            });
+        }
+    }
+    for (MeowObject* owner : rememberedSet) {
+        marker.traceOwner(owner);
+    }
+    marker.drain();
+    marker.processWeakReferences();
+    cycleStats.markMillis = millisSince(markStart);
+    regionActive = false;
+
+    auto evacuateStart = Clock::now();
+    std::unordered_map<MeowObject*, MeowObject*> forwarding;
+    std::vector<HeapPage*> released;
+    size_t freedBytes = 0;
+    for (auto& sizeClass : sizeClasses) {
+        std::vector<HeapPage*> regionPages;
+        regionPages.swap(sizeClass.regionPages);
+        sizeClass.regionCursor = 0;
+        sizeClass.regionCurrent = nullptr;
+
+        for (HeapPage* page : regionPages) {
+            if (page->permanentCells > 0) {
+                page->forEachObject([&](MeowObject* obj) {
+                    if (!obj->gcPermanent && !obj->gcMarked.load(std::memory_order_relaxed)) freedBytes += obj->byteSize();
+                });
+                page->sweep();
+                page->inRegion = false;
+                sizeClass.pages.push_back(page);
+                continue;
+            }
+            page->forEachObject([&](MeowObject* obj) {
+                if (obj->gcMarked.load(std::memory_order_relaxed)) {
+                    MeowObject* moved = obj->relocateTo(allocate(page->cellSize()));
+                    registerObject(moved);
+                    forwarding.emplace(obj, moved);
+                } else {
+                    freedBytes += obj->byteSize();
+                }
+                obj->~MeowObject();
+            });
+            released.push_back(page);
+        }
+    }
 
-            delete obj;
-            it = metadata.erase(it);
+    // Chỉ root, remembered set và chính các object sống của region có thể trỏ
+    // vào region, nên chỉ cần sửa tham chiếu ở đó.
+    for (MeowObject*& obj : marker.survivors) {
+        auto it = forwarding.find(obj);
+        if (it != forwarding.end()) obj = it->second;
+        ++cycleStats.liveObjects[static_cast<size_t>(obj->objectType())];
+    }
+    if (!forwarding.empty()) {
+        ForwardingVisitor fixup(forwarding);
+        vm->traceRoots(fixup);
+        for (auto& cell : pins) {
+            fixup.visitObjectSlot(*cell);
+        }
+        fixup.visitValue(result);
+        for (auto* objects : { &rememberedSet, &marker.survivors }) {
+            for (MeowObject* obj : *objects) {
+                obj->trace(fixup);
+                obj->traceWeak(fixup);
+                if (obj->objectType() == ObjectType::WeakMap) static_cast<ObjWeakMap*>(obj)->rekey();
+            }
         }
     }
-    
+
+    for (HeapPage* page : released) {
+        page->reset(page->cellSize());
+        recyclePage(page);
+    }
+    for (MeowObject* owner : rememberedSet) {
+        owner->gcRemembered = false;
+    }
+
+    cycleStats.objectsAfter = marker.survivors.size();
+    cycleStats.movedObjects = forwarding.size();
+    cycleStats.rememberedObjects = rememberedSet.size();
+    cycleStats.compactMillis = millisSince(evacuateStart);
+    rememberedSet.clear();
     this->vm = nullptr;
+    return freedBytes;
 }
 
-void MarkSweepGC::visitValue(Value& value) {
-    if (value.is<Instance>())      
-        mark(value.get<Instance>());
-    else if (value.is<Function>()) 
-        mark(value.get<Function>());
-    else if (value.is<Class>())    
-        mark(value.get<Class>());
-    else if (value.is<Module>())   
-        mark(value.get<Module>());
-    else if (value.is<BoundMethod>())    
-        mark(value.get<BoundMethod>());
-    else if (value.is<Proto>())    
-        mark(value.get<Proto>());
-    else if (value.is<Upvalue>()) 
-        mark(value.get<Upvalue>());
-    else if (value.is<Array>()) {
-        mark(value.get<Array>());
-    } else if (value.is<Object>()) {
-        mark(value.get<Object>());
+bool MarkSweepGC::tryMark(MeowObject* obj) noexcept {
+    if (obj == nullptr || obj->gcPermanent) {
+        return false;
+    }
+    if (!obj->gcRegistered) {
+#ifndef NDEBUG
+        std::cerr << "[gc] " << objectTypeName(obj->objectType())
+                  << " chưa được đăng ký với GC (tạo ngoài MemoryManager::newObject?)" << std::endl;
+        std::abort();
+#endif
+        return false;
     }
+    if (obj->gcMarked.load(std::memory_order_relaxed)) {
+        return false;
+    }
+    if (obj->gcMarked.exchange(true, std::memory_order_acq_rel)) {
+        return false;
+    }
+    HeapPage::pageOf(obj)->markedCells.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void MarkSweepGC::visitValue(Value& value) {
+    visitObject(valueObject(value));
 }
 
 void MarkSweepGC::visitObject(MeowObject* obj) {
-    mark(obj);
+    if (obj == nullptr) return;
+    markWorkers[rootCursor++ % markWorkers.size()]->visitObject(obj);
+}
+
+void MarkSweepGC::drainMarkWorkers() {
+    std::atomic<size_t> idleWorkers{0};
+    workerPool->run([&](size_t workerId) {
+        drainMarkWorker(workerId, idleWorkers);
+    });
+}
+
+bool MarkSweepGC::isLive(const MeowObject* obj) noexcept {
+    return obj->gcPermanent || obj->gcMarked.load(std::memory_order_relaxed);
+}
+
+// Ephemeron: value của entry chỉ được mark khi key đã sống. Mark thêm value có
+// thể làm sống thêm key của entry khác (hoặc lộ ra weak map mới), nên lặp tới
+// điểm bất động rồi mới xoá entry có key chết và đặt lại WeakRef trỏ vào object chết.
+void MarkSweepGC::processWeakReferences() {
+    while (true) {
+        bool marked = false;
+        for (auto& worker : markWorkers) {
+            for (ObjWeakMap* map : worker->weakMaps) {
+                for (auto& [_, entry] : map->entries) {
+                    if (!isLive(entry.keyObject)) continue;
+                    MeowObject* value = valueObject(entry.value);
+                    if (value && !isLive(value)) {
+                        visitObject(value);
+                        marked = true;
+                    }
+                }
+            }
+        }
+        if (!marked) break;
+        drainMarkWorkers();
+    }
+
+    for (auto& worker : markWorkers) {
+        for (ObjWeakRef* ref : worker->weakRefs) {
+            MeowObject* target = valueObject(ref->target);
+            if (target && !isLive(target)) ref->target = Null{};
+        }
+        for (ObjWeakMap* map : worker->weakMaps) {
+            std::erase_if(map->entries, [](const auto& item) { return !isLive(item.second.keyObject); });
+        }
+    }
+}
+
+void MarkSweepGC::drainMarkWorker(size_t workerId, std::atomic<size_t>& idleWorkers) {
+    MarkWorker& self = *markWorkers[workerId];
+    size_t workerCount = markWorkers.size();
+
+    while (true) {
+        MeowObject* obj = nullptr;
+        while (self.pop(obj)) {
+            self.markedBytes += obj->byteSize();
+            ObjectType type = obj->objectType();
+            ++self.liveObjects[static_cast<size_t>(type)];
+            if (type == ObjectType::Array) {
+                if (size_t bytes = static_cast<ObjArray*>(obj)->largeBytes()) {
+                    ++self.largeObjects;
+                    self.largeBytes += bytes;
+                }
+            } else if (type == ObjectType::WeakRef) {
+                self.weakRefs.push_back(static_cast<ObjWeakRef*>(obj));
+            } else if (type == ObjectType::WeakMap) {
+                self.weakMaps.push_back(static_cast<ObjWeakMap*>(obj));
+            }
+            obj->trace(self);
+            if (workerCount > 1) self.publishIfNeeded();
+        }
+
+        bool stolen = false;
+        for (size_t k = 1; k < workerCount && !stolen; ++k) {
+            stolen = self.stealFrom(*markWorkers[(workerId + k) % workerCount]);
+        }
+        if (stolen) continue;
+
+        // Một worker chỉ rảnh khi gray stack của nó rỗng, và không ai đẩy việc
+        // vào stack của worker khác, nên khi tất cả cùng rảnh thì mark xong.
+        idleWorkers.fetch_add(1, std::memory_order_acq_rel);
+        while (true) {
+            if (idleWorkers.load(std::memory_order_acquire) == workerCount) return;
+
+            bool workAvailable = false;
+            for (size_t k = 0; k < workerCount && !workAvailable; ++k) {
+                workAvailable = markWorkers[k]->sharedCount.load(std::memory_order_acquire) != 0;
+            }
+            if (workAvailable) {
+                idleWorkers.fetch_sub(1, std::memory_order_acq_rel);
+                break;
+            }
+            std::this_thread::yield();
+        }
+    }
 }
 
-void MarkSweepGC::mark(MeowObject* obj) {
-    if (obj == nullptr) {
-        return;
+void MarkSweepGC::sweepPages(const std::vector<HeapPage*>& pending) {
+    if (workerPool->size() > 1 && pending.size() > 1) {
+        std::atomic<size_t> nextPage{0};
+        workerPool->run([&](size_t) {
+            for (size_t i = nextPage.fetch_add(1); i < pending.size(); i = nextPage.fetch_add(1)) {
+                pending[i]->sweep();
+            }
+        });
+    } else {
+        for (HeapPage* page : pending) {
+            page->sweep();
+        }
     }
+}
 
-    auto it = metadata.find(obj);
-    if (it == metadata.end()) {
-        return;
+void MarkSweepGC::finishSweeping() {
+    std::vector<HeapPage*> pending;
+    for (auto& sizeClass : sizeClasses) {
+        for (size_t i = sizeClass.sweepCursor; i < sizeClass.pages.size(); ++i) {
+            if (sizeClass.pages[i]->needsSweep) pending.push_back(sizeClass.pages[i]);
+        }
+        for (size_t i = sizeClass.regionCursor; i < sizeClass.regionPages.size(); ++i) {
+            if (sizeClass.regionPages[i]->needsSweep) pending.push_back(sizeClass.regionPages[i]);
+        }
     }
+    sweepPages(pending);
+}
+
+void MarkSweepGC::scheduleSweep() {
+    std::vector<HeapPage*> pending;
+    std::vector<HeapPage*> dead;
 
-    if (it->second.isMarked) {
-        return;
+    for (auto& sizeClass : sizeClasses) {
+        auto& pages = sizeClass.pages;
+        size_t kept = 0;
+        for (HeapPage* page : pages) {
+            if (config.backgroundSweep && page->permanentCells == 0 &&
+                page->markedCells.load(std::memory_order_relaxed) == 0) {
+                dead.push_back(page);
+                continue;
+            }
+            page->needsSweep = true;
+            pending.push_back(page);
+            pages[kept++] = page;
+        }
+        pages.resize(kept);
+        sizeClass.sweepCursor = 0;
+        sizeClass.current = nullptr;
+
+        // Trang của region đang mở không bao giờ bị trả về pool ở đây; khi
+        // đóng region chúng được xử lý riêng.
+        for (HeapPage* page : sizeClass.regionPages) {
+            page->needsSweep = true;
+            pending.push_back(page);
+        }
+        sizeClass.regionCursor = 0;
+        sizeClass.regionCurrent = nullptr;
     }
 
-    it->second.isMarked = true;
+    if (!dead.empty()) {
+        {
+            std::lock_guard<std::mutex> lock(pagePoolLock);
+            deadPages.insert(deadPages.end(), dead.begin(), dead.end());
+        }
+        sweeperWake.notify_one();
+    }
+
+    if (config.lazySweep) return;
+
+    sweepPages(pending);
+    for (auto& sizeClass : sizeClasses) {
+        auto& pages = sizeClass.pages;
+        size_t kept = 0;
+        for (HeapPage* page : pages) {
+            if (page->isEmpty()) {
+                recyclePage(page);
+            } else {
+                pages[kept++] = page;
+            }
+        }
+        pages.resize(kept);
+    }
+}
 
-    obj->trace(*this);
-}
\ No newline at end of file
+void MarkSweepGC::backgroundSweepLoop() {
+    std::unique_lock<std::mutex> lock(pagePoolLock);
+    while (true) {
+        sweeperWake.wait(lock, [this] { return sweeperStopping || !deadPages.empty(); });
+        if (deadPages.empty() && sweeperStopping) return;
+
+        std::vector<HeapPage*> batch;
+        batch.swap(deadPages);
+        lock.unlock();
+
+        for (HeapPage* page : batch) {
+            page->destroyAll();
+        }
+
+        lock.lock();
+        for (HeapPage* page : batch) {
+            if (freePages.size() < maxFreePages) {
+                freePages.push_back(page);
+            } else {
+                lock.unlock();
+                releasePage(page);
+                lock.lock();
+            }
+        }
+    }
+}
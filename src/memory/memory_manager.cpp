@@ -1,4 +1,8 @@
 #include "memory_manager.h"
 
-MemoryManager::MemoryManager(std::unique_ptr<GarbageCollector> gcImplement)
-    : gc(std::move(gcImplement)), gcThreshold(1024), objectAllocated(0) {}
\ No newline at end of file
+MemoryManager::MemoryManager(std::unique_ptr<GarbageCollector> gcImplement, const GCConfig& gcConfig)
+    : gc(std::move(gcImplement)), vm(nullptr), config(gcConfig), nextCollection(gcConfig.minHeapBytes) {
+    if (config.maxHeapBytes != 0) {
+        nextCollection = std::min(nextCollection, config.maxHeapBytes);
+    }
+}
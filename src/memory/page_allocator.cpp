@@ -0,0 +1,237 @@
+#include "page_allocator.h"
+
+#if defined(_WIN32)
+#include <malloc.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
+
+#if defined(MEOW_COMPRESSED_REFS)
+#if !defined(__unix__) && !defined(__APPLE__)
+#error "MEOW_COMPRESSED_REFS cần mmap để dự trữ vùng heap"
+#endif
+
+static_assert(compressed_heap::base % PageAllocator::chunkSize == 0);
+static_assert(HeapPage::cellAlignment == compressed_heap::granule);
+
+// Vùng địa chỉ dự trữ cho toàn bộ heap khi dùng tham chiếu nén. Dự trữ một lần
+// với PROT_NONE (không tốn RAM), chunk được mở quyền khi cấp và trả bộ nhớ lại
+// hệ điều hành khi giải phóng, còn địa chỉ thì giữ lại để dùng lại.
+namespace {
+
+class ReservedHeapRange {
+public:
+    std::byte* acquire() {
+        std::lock_guard<std::mutex> guard(mutex);
+        reserve();
+        std::byte* chunk = nullptr;
+        if (!freeChunks.empty()) {
+            chunk = freeChunks.back();
+            freeChunks.pop_back();
+        } else {
+            if (next + PageAllocator::chunkSize > end) throw std::bad_alloc();
+            chunk = next;
+            next += PageAllocator::chunkSize;
+        }
+        if (mprotect(chunk, PageAllocator::chunkSize, PROT_READ | PROT_WRITE) != 0) {
+            freeChunks.push_back(chunk);
+            throw std::bad_alloc();
+        }
+        return chunk;
+    }
+
+    void release(std::byte* chunk) noexcept {
+        madvise(chunk, PageAllocator::chunkSize, MADV_DONTNEED);
+        mprotect(chunk, PageAllocator::chunkSize, PROT_NONE);
+        std::lock_guard<std::mutex> guard(mutex);
+        freeChunks.push_back(chunk);
+    }
+
+private:
+    std::mutex mutex;
+    std::byte* next = nullptr;
+    std::byte* end = nullptr;
+    std::vector<std::byte*> freeChunks;
+
+    void reserve() {
+        if (next) return;
+        void* hint = reinterpret_cast<void*>(compressed_heap::base);
+        void* range = mmap(hint, compressed_heap::reservedBytes, PROT_NONE,
+                           MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (range == MAP_FAILED) throw std::runtime_error("Không dự trữ được vùng heap cho tham chiếu nén");
+        if (range != hint) {
+            munmap(range, compressed_heap::reservedBytes);
+            throw std::runtime_error("Vùng heap cho tham chiếu nén đã bị chiếm, thử MEOW_COMPRESSED_HEAP_BASE khác");
+        }
+        // chunk đầu tiên chứa offset 0, tức null, nên bỏ qua
+        next = static_cast<std::byte*>(range) + PageAllocator::chunkSize;
+        end = static_cast<std::byte*>(range) + compressed_heap::reservedBytes;
+    }
+};
+
+ReservedHeapRange& reservedHeapRange() {
+    // không huỷ khi thoát: GC có thể còn trả chunk sau khi static này bị huỷ
+    static auto* range = new ReservedHeapRange();
+    return *range;
+}
+
+}
+#endif
+
+PageAllocator::PageAllocator(bool hugePages, bool numaLocal) : hugePages(hugePages), numaLocal(numaLocal) {}
+
+PageAllocator::~PageAllocator() {
+    for (auto& [chunk, usedPages] : chunks) {
+        unmapChunk(reinterpret_cast<std::byte*>(chunk));
+    }
+}
+
+void* PageAllocator::allocate() {
+    std::lock_guard<std::mutex> guard(lock);
+    if (freePages.empty()) {
+        std::byte* chunk = mapChunk();
+        adviseChunk(chunk);
+        chunks.emplace(reinterpret_cast<uintptr_t>(chunk), 0);
+        ++emptyChunks;
+        for (size_t i = pagesPerChunk; i-- > 0;) {
+            freePages.push_back(chunk + i * HeapPage::pageSize);
+        }
+    }
+    std::byte* page = freePages.back();
+    freePages.pop_back();
+    if (chunks[chunkOf(page)]++ == 0) --emptyChunks;
+    return page;
+}
+
+void PageAllocator::release(void* page) noexcept {
+    std::lock_guard<std::mutex> guard(lock);
+    uintptr_t chunk = chunkOf(page);
+    freePages.push_back(static_cast<std::byte*>(page));
+    if (--chunks[chunk] != 0) return;
+    if (++emptyChunks <= maxEmptyChunks) return;
+
+    // Chunk đã rỗng hoàn toàn: bỏ các trang của nó khỏi danh sách trống và trả cho hệ điều hành.
+    std::erase_if(freePages, [chunk](std::byte* p) { return chunkOf(p) == chunk; });
+    chunks.erase(chunk);
+    --emptyChunks;
+    unmapChunk(reinterpret_cast<std::byte*>(chunk));
+}
+
+std::byte* PageAllocator::mapChunk() {
+#if defined(MEOW_COMPRESSED_REFS)
+    return reservedHeapRange().acquire();
+#elif defined(_WIN32)
+    void* memory = _aligned_malloc(chunkSize, chunkSize);
+    if (!memory) throw std::bad_alloc();
+    return static_cast<std::byte*>(memory);
+#else
+    // Map dư một chunk rồi cắt hai đầu để được vùng căn lề 2 MiB.
+    void* raw = mmap(nullptr, 2 * chunkSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED) throw std::bad_alloc();
+    auto start = reinterpret_cast<uintptr_t>(raw);
+    uintptr_t aligned = (start + chunkSize - 1) & ~(uintptr_t(chunkSize) - 1);
+    if (aligned > start) munmap(raw, aligned - start);
+    size_t tail = start + 2 * chunkSize - (aligned + chunkSize);
+    if (tail > 0) munmap(reinterpret_cast<void*>(aligned + chunkSize), tail);
+    return reinterpret_cast<std::byte*>(aligned);
+#endif
+}
+
+void PageAllocator::unmapChunk(std::byte* chunk) noexcept {
+#if defined(MEOW_COMPRESSED_REFS)
+    reservedHeapRange().release(chunk);
+#elif defined(_WIN32)
+    _aligned_free(chunk);
+#else
+    munmap(chunk, chunkSize);
+#endif
+}
+
+void PageAllocator::adviseChunk([[maybe_unused]] std::byte* chunk) noexcept {
+#if defined(MADV_HUGEPAGE)
+    if (hugePages) madvise(chunk, chunkSize, MADV_HUGEPAGE);
+#endif
+#if defined(__linux__) && defined(SYS_mbind) && defined(SYS_getcpu)
+    // Ưu tiên (không bắt buộc) node của luồng hiện tại, để khi node đó hết bộ
+    // nhớ kernel vẫn cấp từ node khác thay vì OOM. Phải gọi trước khi chạm trang.
+    if (numaLocal) {
+        unsigned cpu = 0;
+        unsigned node = 0;
+        if (syscall(SYS_getcpu, &cpu, &node, nullptr) == 0) {
+            constexpr int mpolPreferred = 1;
+            constexpr size_t maskWords = 16;
+            unsigned long mask[maskWords] = {};
+            constexpr size_t wordBits = sizeof(unsigned long) * 8;
+            if (node < maskWords * wordBits) {
+                mask[node / wordBits] |= 1UL << (node % wordBits);
+                syscall(SYS_mbind, chunk, chunkSize, mpolPreferred, mask, maskWords * wordBits, 0);
+            }
+        }
+    }
+#endif
+}
+
+HeapMemoryUsage PageAllocator::usage() const {
+    HeapMemoryUsage result;
+    std::vector<uintptr_t> starts;
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        starts.reserve(chunks.size());
+        for (auto& [chunk, usedPages] : chunks) starts.push_back(chunk);
+    }
+    std::sort(starts.begin(), starts.end());
+    result.chunks = starts.size();
+    result.reservedBytes = starts.size() * chunkSize;
+
+#if defined(__linux__)
+    size_t systemPage = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    if (std::ifstream statm("/proc/self/statm"); statm) {
+        size_t totalPages = 0;
+        size_t residentPages = 0;
+        if (statm >> totalPages >> residentPages) result.processResidentBytes = residentPages * systemPage;
+    }
+
+    // Mỗi mapping trong smaps có Rss và AnonHugePages riêng. Mapping có thể gộp
+    // chunk heap với vùng nhớ khác, khi đó chỉ tính phần tương ứng với chunk.
+    std::ifstream smaps("/proc/self/smaps");
+    std::string line;
+    double overlapRatio = 0.0;
+    while (std::getline(smaps, line)) {
+        if (line.empty()) continue;
+        size_t dash = line.find('-');
+        size_t space = line.find(' ');
+        if (dash != std::string::npos && space != std::string::npos && dash < space &&
+            std::isxdigit(static_cast<unsigned char>(line[0]))) {
+            uintptr_t begin = std::stoull(line.substr(0, dash), nullptr, 16);
+            uintptr_t end = std::stoull(line.substr(dash + 1, space - dash - 1), nullptr, 16);
+            size_t overlap = 0;
+            auto it = std::upper_bound(starts.begin(), starts.end(), begin);
+            if (it != starts.begin()) --it;
+            for (; it != starts.end() && *it < end; ++it) {
+                uintptr_t lo = std::max(begin, *it);
+                uintptr_t hi = std::min(end, *it + chunkSize);
+                if (hi > lo) overlap += hi - lo;
+            }
+            overlapRatio = end > begin ? static_cast<double>(overlap) / static_cast<double>(end - begin) : 0.0;
+            continue;
+        }
+        if (overlapRatio == 0.0) continue;
+
+        bool isRss = line.rfind("Rss:", 0) == 0;
+        bool isHuge = line.rfind("AnonHugePages:", 0) == 0;
+        if (!isRss && !isHuge) continue;
+        size_t kilobytes = 0;
+        std::istringstream fields(line.substr(line.find(':') + 1));
+        fields >> kilobytes;
+        size_t bytes = static_cast<size_t>(static_cast<double>(kilobytes * 1024) * overlapRatio);
+        if (isRss) result.residentBytes += bytes;
+        else result.hugePageBytes += bytes;
+    }
+#endif
+    return result;
+}
@@ -0,0 +1,47 @@
+#include "allocation_profiler.h"
+#include "meow_vm.h"
+
+void AllocationProfiler::onAllocate(const MeowObject* obj, size_t bytes) {
+    auto [proto, ip] = vm.currentSite();
+    SiteKey key{ proto, ip, obj->objectType() };
+
+    auto [it, inserted] = sites.try_emplace(key);
+    AllocationSite& site = it->second;
+    if (inserted) {
+        site.function = proto ? proto->sourceName : "<runtime>";
+        site.ip = ip;
+        site.type = key.type;
+    }
+    ++site.count;
+    site.bytes += bytes;
+}
+
+std::vector<AllocationSite> AllocationProfiler::summary() const {
+    std::vector<AllocationSite> result;
+    result.reserve(sites.size());
+    for (const auto& [key, site] : sites) {
+        result.push_back(site);
+    }
+    std::sort(result.begin(), result.end(), [](const AllocationSite& a, const AllocationSite& b) {
+        return a.bytes != b.bytes ? a.bytes > b.bytes : a.count > b.count;
+    });
+    return result;
+}
+
+void AllocationProfiler::printSummary(std::ostream& os, const std::vector<AllocationSite>& all, size_t limit) {
+    size_t totalBytes = 0, totalCount = 0;
+    for (const auto& site : all) {
+        totalBytes += site.bytes;
+        totalCount += site.count;
+    }
+
+    os << "[alloc] " << totalCount << " object, " << totalBytes << " byte tại " << all.size() << " vị trí\n";
+    os << std::setw(12) << "bytes" << std::setw(10) << "count" << "  type         site\n";
+    for (size_t i = 0; i < all.size() && i < limit; ++i) {
+        const AllocationSite& site = all[i];
+        os << std::setw(12) << site.bytes << std::setw(10) << site.count << "  " << std::left << std::setw(12)
+           << objectTypeName(site.type) << std::right << ' ' << site.function;
+        if (site.ip >= 0) os << " @" << site.ip;
+        os << '\n';
+    }
+}
@@ -10,6 +10,23 @@ template<class... Ts>
 overloaded(Ts...) -> overloaded<Ts...>;
 
 void MeowVM::defineNativeFunctions() {
+    defineNativeModule();
+
+    std::vector<Str> list = {"array", "object", "string"};
+
+    for (const auto& moduleName : list) {
+        try {
+            _getOrLoadModule(moduleName, "native", true); 
+        } catch (const VMError& e) {
+            // std::cerr << "Warning: Could not preload standard module '" 
+                    //   << moduleName << "'. " << e.what() << std::endl;
+        }
+    }
+}
+
+// Module "native" chứa các hàm dựng sẵn (print, len...), được chép vào global
+// của mọi module script.
+void MeowVM::defineNativeModule() {
     auto nativePrint = [this](Arguments args) -> Value {
         Str outputString;
         for (size_t i = 0; i < args.size(); ++i) {
@@ -131,17 +148,30 @@ void MeowVM::defineNativeFunctions() {
         }
 
         auto resultArrayData = this->memoryManager->newObject<ObjArray>();
-        
-        if (step > 0) {
-            for (Int i = start; i < stop; i += step) {
-                resultArrayData->elements.push_back(Value(i));
-            }
-        } else {
-            for (Int i = start; i > stop; i += step) {
-                resultArrayData->elements.push_back(Value(i));
-            }
+
+        // Đếm trên Uint64: stop - start (và phần tử sau phần tử cuối) có thể
+        // vượt miền Int khi hai cận nằm ở hai đầu miền giá trị.
+        Uint64 distance = 0;
+        Uint64 stride = 0;
+        if (step > 0 && start < stop) {
+            distance = static_cast<Uint64>(stop) - static_cast<Uint64>(start);
+            stride = static_cast<Uint64>(step);
+        } else if (step < 0 && start > stop) {
+            distance = static_cast<Uint64>(start) - static_cast<Uint64>(stop);
+            stride = Uint64(0) - static_cast<Uint64>(step);
+        }
+        Uint64 count = distance == 0 ? 0 : (distance - 1) / stride + 1;
+        if (count > resultArrayData->elements.max_size()) {
+            throwVMError("range() tạo quá nhiều phần tử.");
+        }
+        resultArrayData->elements.reserve(static_cast<size_t>(count));
+
+        Uint64 current = static_cast<Uint64>(start);
+        for (Uint64 i = 0; i < count; ++i, current += static_cast<Uint64>(step)) {
+            resultArrayData->elements.push_back(Value(static_cast<Int>(current)));
         }
 
+        this->memoryManager->trackGrowth(resultArrayData->elements.capacity() * sizeof(Value));
         return Value(Array(resultArrayData));
     };
 
@@ -163,16 +193,6 @@ void MeowVM::defineNativeFunctions() {
 
     auto nativeModule = memoryManager->newObject<ObjModule>("native", "native");
     nativeModule->globals = natives;
+    memoryManager->makePermanent(nativeModule);
     moduleCache["native"] = nativeModule;
-
-    std::vector<Str> list = {"array", "object", "string"};
-
-    for (const auto& moduleName : list) {
-        try {
-            _getOrLoadModule(moduleName, "native", true); 
-        } catch (const VMError& e) {
-            // std::cerr << "Warning: Could not preload standard module '" 
-                    //   << moduleName << "'. " << e.what() << std::endl;
-        }
-    }
 }
@@ -29,6 +29,7 @@ void MeowVM::closeUpvalues(Int slotIndex) {
     while (!openUpvalues.empty() && openUpvalues.back()->slotIndex >= slotIndex) {
         auto up = openUpvalues.back();
         up->close(stackSlots[up->slotIndex]);
+        memoryManager->writeBarrier(up, up->closed);
         openUpvalues.pop_back();
     }
 }
@@ -144,9 +145,21 @@ Value MeowVM::call(const Value& callee, Arguments args) {
             continue;
         }
 
+        // Safepoint trong callback: chỉ thu gom khi native gọi callback đã mở lại
+        // GC (GCCallbackScope), và không di chuyển object vì native bên dưới còn
+        // giữ con trỏ thô. Lỗi hết heap đi thẳng ra run() như ở safepoint ngoài.
+        if (memoryManager->isCollectionPending()) {
+            collectingAtSafepoint = true;
+            memoryManager->collectPending(false);
+            collectingAtSafepoint = false;
+        }
+
         try {
             currentInst = &proto->code[currentFrame->ip++];
-            (this->*jumpTable[static_cast<Int32>(currentInst->op)])();
+            {
+                GCScopeGuard gcGuard(memoryManager.get());
+                (this->*jumpTable[static_cast<Int32>(currentInst->op)])();
+            }
         } catch (const VMError& e) {
             _handleRuntimeException(e);
         } catch (const std::exception& e) {
@@ -159,4 +172,18 @@ Value MeowVM::call(const Value& callee, Arguments args) {
 
     stackSlots.resize(argStartAbs);
     return result;
+}
+
+Value MeowVM::callInRegion(const Value& callee, Arguments args) {
+    memoryManager->beginRegion();
+    Value result;
+    try {
+        GCCallbackScope gcScope(*memoryManager);
+        result = call(callee, args);
+    } catch (...) {
+        memoryManager->endRegion(result);
+        throw;
+    }
+    memoryManager->endRegion(result);
+    return result;
 }
\ No newline at end of file
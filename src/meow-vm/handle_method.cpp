@@ -42,10 +42,10 @@ std::optional<Value> MeowVM::getMagicMethod(const Value& obj, const Str& name) {
 
             if (v.is<NativeFn>()) {
                 NativeFn orig = v.get<NativeFn>();
-                NativeFnAdvanced wrapper = [orig, inst](MeowEngine* engine, Arguments args)->Value {
+                NativeFnAdvanced wrapper = [orig, pinned = GCPin<ObjInstance>(*memoryManager, inst)](MeowEngine* engine, Arguments args)->Value {
                     std::vector<Value> newArgs;
                     newArgs.reserve(1 + args.size());
-                    newArgs.push_back(Value(inst));
+                    newArgs.push_back(Value(pinned.get()));
                     newArgs.insert(newArgs.end(), args.begin(), args.end());
                     return std::visit([&](auto&& fn) -> Value {
                         using T = std::decay_t<decltype(fn)>;
@@ -82,10 +82,10 @@ std::optional<Value> MeowVM::getMagicMethod(const Value& obj, const Str& name) {
                 }
                 if (mv.is<NativeFn>()) {
                     NativeFn orig = mv.get<NativeFn>();
-                    NativeFnAdvanced wrapper = [orig, inst](MeowEngine* engine, Arguments args)->Value {
+                    NativeFnAdvanced wrapper = [orig, pinned = GCPin<ObjInstance>(*memoryManager, inst)](MeowEngine* engine, Arguments args)->Value {
                         std::vector<Value> newArgs;
                         newArgs.reserve(1 + args.size());
-                        newArgs.push_back(Value(inst));
+                        newArgs.push_back(Value(pinned.get()));
                         newArgs.insert(newArgs.end(), args.begin(), args.end());
                         return std::visit([&](auto&& fn) -> Value {
                             using T = std::decay_t<decltype(fn)>;
@@ -112,6 +112,7 @@ std::optional<Value> MeowVM::getMagicMethod(const Value& obj, const Str& name) {
         if (!objPtr) return std::nullopt;
         auto fit = objPtr->fields.find(name);
         if (fit != objPtr->fields.end()) return Value(fit->second);
+        if (!deferredLibraries.empty()) loadDeferredLibraries();
         auto pgit = builtinGetters.find("Object");
         if (pgit != builtinGetters.end()) {
             auto it = pgit->second.find(name);
@@ -126,10 +127,10 @@ std::optional<Value> MeowVM::getMagicMethod(const Value& obj, const Str& name) {
                 const Value& mv = it->second;
                 if (mv.is<NativeFn>()) {
                     NativeFn orig = mv.get<NativeFn>();
-                    NativeFnAdvanced wrapper = [orig, objPtr](MeowEngine* engine, Arguments args)->Value {
+                    NativeFnAdvanced wrapper = [orig, pinned = GCPin<ObjObject>(*memoryManager, objPtr)](MeowEngine* engine, Arguments args)->Value {
                         std::vector<Value> newArgs;
                         newArgs.reserve(1 + args.size());
-                        newArgs.push_back(Value(objPtr));
+                        newArgs.push_back(Value(pinned.get()));
                         newArgs.insert(newArgs.end(), args.begin(), args.end());
                         return std::visit([&](auto&& fn) -> Value {
                             using T = std::decay_t<decltype(fn)>;
@@ -153,6 +154,7 @@ std::optional<Value> MeowVM::getMagicMethod(const Value& obj, const Str& name) {
         Array arr = obj.get<Array>();
         if (!arr) return std::nullopt;
 
+        if (!deferredLibraries.empty()) loadDeferredLibraries();
         auto pgit = builtinGetters.find("Array");
         if (pgit != builtinGetters.end()) {
             auto it = pgit->second.find(name);
@@ -167,10 +169,10 @@ std::optional<Value> MeowVM::getMagicMethod(const Value& obj, const Str& name) {
                 const Value& mv = it->second;
                 if (mv.is<NativeFn>()) {
                     NativeFn orig = mv.get<NativeFn>();
-                    NativeFnAdvanced wrapper = [orig, arr](MeowEngine* engine, Arguments args)->Value {
+                    NativeFnAdvanced wrapper = [orig, pinned = GCPin<ObjArray>(*memoryManager, arr)](MeowEngine* engine, Arguments args)->Value {
                         std::vector<Value> newArgs;
                         newArgs.reserve(1 + args.size());
-                        newArgs.push_back(Value(arr));
+                        newArgs.push_back(Value(pinned.get()));
                         newArgs.insert(newArgs.end(), args.begin(), args.end());
                         return std::visit([&](auto&& fn) -> Value {
                             using T = std::decay_t<decltype(fn)>;
@@ -191,6 +193,7 @@ std::optional<Value> MeowVM::getMagicMethod(const Value& obj, const Str& name) {
 
 
     if (isString(obj)) {
+        if (!deferredLibraries.empty()) loadDeferredLibraries();
         auto pgit = builtinGetters.find("String");
         if (pgit != builtinGetters.end()) {
             auto it = pgit->second.find(name);
@@ -234,6 +237,7 @@ std::optional<Value> MeowVM::getMagicMethod(const Value& obj, const Str& name) {
         else if (isDouble(obj)) typeName = "Real";
         else typeName = "Bool";
 
+        if (!deferredLibraries.empty()) loadDeferredLibraries();
         auto pgit = builtinGetters.find(typeName);
         if (pgit != builtinGetters.end()) {
             auto it = pgit->second.find(name);
@@ -286,8 +290,10 @@ std::optional<Value> MeowVM::getMagicMethod(const Value& obj, const Str& name) {
 
 void MeowVM::registerMethod(const Str& typeName, const Str& methodName, const Value& method) {
     builtinMethods[typeName][methodName] = method;
+    if (!method.is<NativeFn>()) builtinsNeedTracing = true;
 }
 
 void MeowVM::registerGetter(const Str& typeName, const Str& propName, const Value& getter) {
     builtinGetters[typeName][propName] = getter;
+    if (!getter.is<NativeFn>()) builtinsNeedTracing = true;
 }
\ No newline at end of file
@@ -0,0 +1,764 @@
+#include "heap_image.h"
+#include "binary_format.h"
+#include "binary_parser.h"
+#include "binary_writer.h"
+#include "meow_vm.h"
+
+#include <cstring>
+
+namespace {
+
+constexpr char imageMagic[4] = { 'M', 'W', 'I', '1' };
+
+enum class ModuleKind : Uint8 { Native, Library, Script };
+enum class SymbolKind : Uint8 { Global, Export, Method, Getter };
+enum class ValueTag : Uint8 { Null, Int, Real, False, True, String, Object, Module, Proto, Symbol };
+
+constexpr Uint8 flagBinary = 1;
+constexpr Uint8 flagExecuted = 2;
+constexpr Uint8 flagHasMain = 4;
+
+class ByteSink {
+public:
+    std::string bytes;
+
+    void u8(Uint8 value) {
+        bytes.push_back(static_cast<char>(value));
+    }
+
+    void varint(Uint64 value) {
+        while (value >= 0x80) {
+            bytes.push_back(static_cast<char>((value & 0x7F) | 0x80));
+            value >>= 7;
+        }
+        bytes.push_back(static_cast<char>(value));
+    }
+
+    void real(Real value) {
+        char raw[sizeof(Real)];
+        std::memcpy(raw, &value, sizeof(Real));
+        bytes.append(raw, sizeof(Real));
+    }
+
+    void string(std::string_view s) {
+        varint(s.size());
+        bytes.append(s);
+    }
+};
+
+class ByteSource {
+public:
+    ByteSource(const char* begin, const char* end) : cursor(begin), end(end) {}
+
+    Uint8 u8() {
+        require(1);
+        return static_cast<Uint8>(*cursor++);
+    }
+
+    Uint64 varint() {
+        Uint64 value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            Uint8 byte = u8();
+            value |= static_cast<Uint64>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) return value;
+        }
+        throw std::runtime_error("Varint quá dài trong heap image.");
+    }
+
+    // Số phần tử sắp đọc, mỗi phần tử ít nhất một byte.
+    size_t count() {
+        Uint64 value = varint();
+        if (value > static_cast<Uint64>(end - cursor)) throw std::runtime_error("Heap image bị cắt cụt.");
+        return static_cast<size_t>(value);
+    }
+
+    Real real() {
+        require(sizeof(Real));
+        Real value;
+        std::memcpy(&value, cursor, sizeof(Real));
+        cursor += sizeof(Real);
+        return value;
+    }
+
+    Str string() {
+        size_t size = count();
+        Str s(cursor, size);
+        cursor += size;
+        return s;
+    }
+
+    bool atEnd() const noexcept { return cursor == end; }
+
+private:
+    const char* cursor;
+    const char* end;
+
+    void require(size_t bytes) const {
+        if (static_cast<size_t>(end - cursor) < bytes) throw std::runtime_error("Heap image bị cắt cụt.");
+    }
+};
+
+// Nhận dạng một hàm native trong tiến trình hiện tại: hàm C thuần theo địa
+// chỉ, còn lambda theo kiểu (mỗi lambda có kiểu riêng). Hai hàm khác nhau có
+// cùng kiểu lambda thì không phân biệt được.
+template<typename R, typename... Args>
+std::pair<Str, bool> functionIdentity(const std::function<R(Args...)>& fn) {
+    if (auto* pointer = fn.template target<R(*)(Args...)>()) {
+        std::ostringstream os;
+        os << "fn:" << reinterpret_cast<const void*>(*pointer);
+        return { os.str(), false };
+    }
+    return { Str("type:") + fn.target_type().name(), true };
+}
+
+std::pair<Str, bool> nativeIdentity(const NativeFn& fn) {
+    return std::visit([](const auto& f) { return functionIdentity(f); }, fn);
+}
+
+Value nullable(MeowObject* obj, Value value) {
+    return obj ? std::move(value) : Value(Null{});
+}
+
+}
+
+class HeapImage::Writer {
+public:
+    explicit Writer(MeowVM& vm) : vm(vm) {}
+
+    std::string encode() {
+        collectModules();
+        collectSymbols();
+        collectProtos();
+        for (size_t i = 0; i < modules.size(); ++i) {
+            if (kinds[i] != ModuleKind::Script) continue;
+            for (auto& [name, value] : modules[i]->globals) discover(value);
+            for (auto& [name, value] : modules[i]->exports) discover(value);
+        }
+        for (size_t i = 0; i < objects.size(); ++i) discoverChildren(objects[i]);
+
+        ByteSink out;
+        out.bytes.append(imageMagic, sizeof(imageMagic));
+        writeModules(out);
+
+        out.varint(usedSymbols.size());
+        for (const Symbol& symbol : usedSymbols) {
+            out.u8(static_cast<Uint8>(symbol.kind));
+            if (symbol.kind == SymbolKind::Global || symbol.kind == SymbolKind::Export) out.varint(symbol.module);
+            else out.string(symbol.owner);
+            out.string(symbol.name);
+        }
+
+        out.varint(objects.size());
+        for (MeowObject* obj : objects) {
+            out.u8(static_cast<Uint8>(obj->objectType()));
+            if (obj->objectType() == ObjectType::Closure) writeValue(out, Value(Proto(static_cast<ObjClosure*>(obj)->proto)));
+        }
+        for (MeowObject* obj : objects) writeBody(out, obj);
+
+        for (size_t i = 0; i < modules.size(); ++i) {
+            if (kinds[i] != ModuleKind::Script) continue;
+            writeFields(out, modules[i]->globals);
+            writeFields(out, modules[i]->exports);
+        }
+
+        // Module entry không vào cache để có thể chạy lại nó khi boot.
+        std::vector<std::pair<Str, size_t>> keys;
+        for (const auto& [key, module] : vm.moduleCache) {
+            size_t index = moduleIndex.at(module);
+            if (kinds[index] == ModuleKind::Script && module != vm.entryModule) keys.emplace_back(key, index);
+        }
+        std::sort(keys.begin(), keys.end());
+        out.varint(keys.size());
+        for (const auto& [key, index] : keys) {
+            out.string(key);
+            out.varint(index);
+        }
+        return std::move(out.bytes);
+    }
+
+private:
+    struct Symbol {
+        SymbolKind kind;
+        size_t module = 0;
+        Str owner;
+        Str name;
+    };
+
+    // Ký hiệu trùng nhận dạng với một ký hiệu khác mà không chắc là cùng hàm.
+    static constexpr size_t ambiguous = std::numeric_limits<size_t>::max();
+
+    MeowVM& vm;
+
+    std::vector<Module> modules;
+    std::vector<ModuleKind> kinds;
+    std::unordered_map<const ObjModule*, size_t> moduleIndex;
+    std::vector<std::unordered_map<Str, Proto>> moduleProtos;
+    std::unordered_map<const ObjFunctionProto*, size_t> protoOwner;
+
+    std::vector<Symbol> symbols;
+    std::unordered_map<Str, size_t> nativeSymbols;
+    std::unordered_map<const MeowObject*, size_t> objectSymbols;
+    std::vector<Symbol> usedSymbols;
+    std::unordered_map<size_t, size_t> usedSymbolIndex;
+
+    std::vector<MeowObject*> objects;
+    std::unordered_map<const MeowObject*, size_t> objectIndex;
+
+    // Có giá trị nào của image trỏ vào thư viện native (hàm, object, module hay
+    // method dựng sẵn) không; nếu không, thư viện được nạp trễ khi boot.
+    bool librariesNeeded = false;
+
+    void addModule(Module module, ModuleKind kind) {
+        if (!module || moduleIndex.count(module)) return;
+        moduleIndex[module] = modules.size();
+        modules.push_back(module);
+        kinds.push_back(kind);
+    }
+
+    void collectModules() {
+        if (auto it = vm.moduleCache.find("native"); it != vm.moduleCache.end()) addModule(it->second, ModuleKind::Native);
+        for (const auto& [modulePath, libPath] : vm.nativeLibraries) {
+            if (auto it = vm.moduleCache.find(modulePath); it != vm.moduleCache.end()) addModule(it->second, ModuleKind::Library);
+        }
+
+        std::vector<Module> scripts;
+        for (const auto& [key, module] : vm.moduleCache) {
+            if (moduleIndex.count(module)) continue;
+            if (!module->hasMain || !module->mainProto) {
+                throw std::runtime_error("Module '" + module->name + "' không phải module script hay thư viện đã biết.");
+            }
+            scripts.push_back(module);
+        }
+        std::sort(scripts.begin(), scripts.end(), [](Module a, Module b) { return a->path < b->path; });
+        for (Module module : scripts) addModule(module, ModuleKind::Script);
+    }
+
+    void addSymbol(Symbol symbol, const Value& value) {
+        size_t index = symbols.size();
+        symbols.push_back(std::move(symbol));
+        if (const NativeFn* fn = value.get_if<NativeFn>()) {
+            auto [key, stateful] = nativeIdentity(*fn);
+            auto [it, inserted] = nativeSymbols.emplace(key, index);
+            // Cùng một hàm C dưới hai tên vẫn là một hàm; lambda cùng kiểu thì có thể giữ trạng thái khác nhau.
+            if (!inserted && stateful) it->second = ambiguous;
+        } else if (MeowObject* obj = valueObject(value)) {
+            objectSymbols.emplace(obj, index);
+        }
+    }
+
+    void collectSymbols() {
+        for (size_t i = 0; i < modules.size(); ++i) {
+            if (kinds[i] == ModuleKind::Script) continue;
+            for (const auto& [name, value] : modules[i]->globals) addSymbol({ SymbolKind::Global, i, "", name }, value);
+            for (const auto& [name, value] : modules[i]->exports) addSymbol({ SymbolKind::Export, i, "", name }, value);
+        }
+        for (const auto& [type, methods] : vm.builtinMethods) {
+            for (const auto& [name, value] : methods) addSymbol({ SymbolKind::Method, 0, type, name }, value);
+        }
+        for (const auto& [type, getters] : vm.builtinGetters) {
+            for (const auto& [name, value] : getters) addSymbol({ SymbolKind::Getter, 0, type, name }, value);
+        }
+    }
+
+    // Proto của module script: mọi proto đi tới được từ @main qua bảng hằng.
+    // BinaryWriter đọc thẳng code nên proto nạp lười phải được giải mã trước.
+    void collectProtos() {
+        moduleProtos.resize(modules.size());
+        for (size_t i = 0; i < modules.size(); ++i) {
+            if (kinds[i] != ModuleKind::Script) continue;
+            std::vector<Proto> pending = { Proto(modules[i]->mainProto) };
+            while (!pending.empty()) {
+                Proto proto = pending.back();
+                pending.pop_back();
+                if (protoOwner.count(proto)) continue;
+                proto->materialize();
+                auto [it, inserted] = moduleProtos[i].emplace(proto->sourceName, proto);
+                if (!inserted) {
+                    throw std::runtime_error("Module '" + modules[i]->path + "' có hai proto cùng tên '" + proto->sourceName + "'.");
+                }
+                protoOwner[proto] = i;
+                for (const Value& constant : proto->constantPool) {
+                    if (const Proto* child = constant.get_if<Proto>()) pending.push_back(*child);
+                }
+            }
+        }
+    }
+
+    std::optional<size_t> symbolOf(const Value& value) const {
+        size_t index = ambiguous;
+        if (const NativeFn* fn = value.get_if<NativeFn>()) {
+            auto it = nativeSymbols.find(nativeIdentity(*fn).first);
+            if (it == nativeSymbols.end()) throw std::runtime_error("Hàm native không thuộc module native nào, không ghi được vào heap image.");
+            if (it->second == ambiguous) throw std::runtime_error("Hàm native không phân biệt được với hàm khác cùng kiểu, không ghi được vào heap image.");
+            index = it->second;
+        } else if (MeowObject* obj = valueObject(value)) {
+            auto it = objectSymbols.find(obj);
+            if (it == objectSymbols.end()) return std::nullopt;
+            index = it->second;
+        } else {
+            return std::nullopt;
+        }
+        return index;
+    }
+
+    size_t useSymbol(size_t index) {
+        auto [it, inserted] = usedSymbolIndex.emplace(index, usedSymbols.size());
+        if (inserted) {
+            const Symbol& symbol = symbols[index];
+            bool global = symbol.kind == SymbolKind::Global || symbol.kind == SymbolKind::Export;
+            if (!global || kinds[symbol.module] == ModuleKind::Library) librariesNeeded = true;
+            usedSymbols.push_back(symbol);
+        }
+        return it->second;
+    }
+
+    void discover(const Value& value) {
+        if (auto symbol = symbolOf(value)) {
+            useSymbol(*symbol);
+            return;
+        }
+        MeowObject* obj = valueObject(value);
+        if (!obj || objectIndex.count(obj)) return;
+        switch (obj->objectType()) {
+            case ObjectType::Module: {
+                auto it = moduleIndex.find(static_cast<ObjModule*>(obj));
+                if (it == moduleIndex.end()) throw std::runtime_error("Giá trị trỏ tới module chưa nạp qua import.");
+                if (kinds[it->second] == ModuleKind::Library) librariesNeeded = true;
+                return;
+            }
+            case ObjectType::Proto:
+                if (!protoOwner.count(static_cast<ObjFunctionProto*>(obj))) throw std::runtime_error("Giá trị trỏ tới proto không thuộc module script nào.");
+                return;
+            case ObjectType::Upvalue:
+            case ObjectType::Closure:
+            case ObjectType::Class:
+            case ObjectType::Instance:
+            case ObjectType::BoundMethod:
+            case ObjectType::Array:
+            case ObjectType::Object:
+                objectIndex[obj] = objects.size();
+                objects.push_back(obj);
+                return;
+            default:
+                throw std::runtime_error(Str("Object kiểu ") + objectTypeName(obj->objectType()) + " không ghi được vào heap image.");
+        }
+    }
+
+    // Upvalue còn mở (chương trình dừng bằng HALT) được ghi như đã đóng với giá trị hiện tại của ô stack.
+    Value upvalueValue(const ObjUpvalue* upvalue) const {
+        if (upvalue->state == ObjUpvalue::State::CLOSED) return upvalue->closed;
+        if (upvalue->slotIndex >= 0 && static_cast<size_t>(upvalue->slotIndex) < vm.stackSlots.size()) return vm.stackSlots[upvalue->slotIndex];
+        return Value(Null{});
+    }
+
+    template<typename F>
+    void forEachChild(MeowObject* obj, F&& f) {
+        switch (obj->objectType()) {
+            case ObjectType::Upvalue:
+                f(upvalueValue(static_cast<ObjUpvalue*>(obj)));
+                break;
+            case ObjectType::Closure: {
+                auto* closure = static_cast<ObjClosure*>(obj);
+                for (const auto& upvalue : closure->upvalues) f(nullable(Upvalue(upvalue), Value(Upvalue(upvalue))));
+                break;
+            }
+            case ObjectType::Class: {
+                auto* klass = static_cast<ObjClass*>(obj);
+                Class super = klass->superclass ? Class(*klass->superclass) : nullptr;
+                f(nullable(super, Value(super)));
+                break;
+            }
+            case ObjectType::Instance: {
+                auto* instance = static_cast<ObjInstance*>(obj);
+                f(nullable(Class(instance->klass), Value(Class(instance->klass))));
+                break;
+            }
+            case ObjectType::BoundMethod: {
+                auto* bound = static_cast<ObjBoundMethod*>(obj);
+                f(nullable(Instance(bound->receiver), Value(Instance(bound->receiver))));
+                f(nullable(Function(bound->callable), Value(Function(bound->callable))));
+                break;
+            }
+            case ObjectType::Array:
+                for (const Value& element : static_cast<ObjArray*>(obj)->elements) f(element);
+                break;
+            default:
+                break;
+        }
+    }
+
+    const std::unordered_map<Str, Value>* fieldsOf(MeowObject* obj) const {
+        switch (obj->objectType()) {
+            case ObjectType::Class: return &static_cast<ObjClass*>(obj)->methods;
+            case ObjectType::Instance: return &static_cast<ObjInstance*>(obj)->fields;
+            case ObjectType::Object: return &static_cast<ObjObject*>(obj)->fields;
+            default: return nullptr;
+        }
+    }
+
+    void discoverChildren(MeowObject* obj) {
+        if (obj->objectType() == ObjectType::Closure) discover(Value(Proto(static_cast<ObjClosure*>(obj)->proto)));
+        forEachChild(obj, [this](const Value& value) { discover(value); });
+        if (auto* fields = fieldsOf(obj)) {
+            for (const auto& [name, value] : *fields) discover(value);
+        }
+    }
+
+    void writeModules(ByteSink& out) {
+        out.varint(modules.size());
+        for (size_t i = 0; i < modules.size(); ++i) {
+            out.u8(static_cast<Uint8>(kinds[i]));
+            if (kinds[i] == ModuleKind::Library) {
+                for (const auto& [modulePath, libPath] : vm.nativeLibraries) {
+                    auto it = vm.moduleCache.find(modulePath);
+                    if (it == vm.moduleCache.end() || it->second != modules[i]) continue;
+                    out.string(modulePath);
+                    out.string(libPath);
+                    out.u8(librariesNeeded ? 1 : 0);
+                    break;
+                }
+            } else if (kinds[i] == ModuleKind::Script) {
+                Module module = modules[i];
+                out.string(module->name);
+                out.string(module->path);
+                Uint8 flags = 0;
+                if (module->isBinary) flags |= flagBinary;
+                if (module->isExecuted) flags |= flagExecuted;
+                if (module->hasMain) flags |= flagHasMain;
+                out.u8(flags);
+                out.string(BinaryWriter::encode(moduleProtos[i]));
+            }
+        }
+    }
+
+    void writeValue(ByteSink& out, const Value& value) {
+        if (auto symbol = symbolOf(value)) {
+            out.u8(static_cast<Uint8>(ValueTag::Symbol));
+            out.varint(usedSymbolIndex.at(*symbol));
+            return;
+        }
+        if (value.is<Null>()) {
+            out.u8(static_cast<Uint8>(ValueTag::Null));
+        } else if (const Int* i = value.get_if<Int>()) {
+            out.u8(static_cast<Uint8>(ValueTag::Int));
+            out.varint(meowb::zigzagEncode(*i));
+        } else if (const Real* r = value.get_if<Real>()) {
+            out.u8(static_cast<Uint8>(ValueTag::Real));
+            out.real(*r);
+        } else if (const Bool* b = value.get_if<Bool>()) {
+            out.u8(static_cast<Uint8>(*b ? ValueTag::True : ValueTag::False));
+        } else if (const Str* s = value.get_if<Str>()) {
+            out.u8(static_cast<Uint8>(ValueTag::String));
+            out.string(*s);
+        } else if (const Module* module = value.get_if<Module>()) {
+            out.u8(static_cast<Uint8>(ValueTag::Module));
+            out.varint(moduleIndex.at(*module));
+        } else if (const Proto* proto = value.get_if<Proto>()) {
+            out.u8(static_cast<Uint8>(ValueTag::Proto));
+            out.varint(protoOwner.at(*proto));
+            out.string((*proto)->sourceName);
+        } else {
+            out.u8(static_cast<Uint8>(ValueTag::Object));
+            out.varint(objectIndex.at(valueObject(value)));
+        }
+    }
+
+    void writeFields(ByteSink& out, const std::unordered_map<Str, Value>& fields) {
+        out.varint(fields.size());
+        for (const auto& [name, value] : fields) {
+            out.string(name);
+            writeValue(out, value);
+        }
+    }
+
+    void writeBody(ByteSink& out, MeowObject* obj) {
+        switch (obj->objectType()) {
+            case ObjectType::Closure:
+                out.varint(static_cast<ObjClosure*>(obj)->upvalues.size());
+                break;
+            case ObjectType::Class:
+                out.string(static_cast<ObjClass*>(obj)->name);
+                break;
+            case ObjectType::Array:
+                out.varint(static_cast<ObjArray*>(obj)->elements.size());
+                break;
+            default:
+                break;
+        }
+        forEachChild(obj, [&](const Value& value) { writeValue(out, value); });
+        if (auto* fields = fieldsOf(obj)) writeFields(out, *fields);
+    }
+};
+
+class HeapImage::Reader {
+public:
+    Reader(MeowVM& vm, ByteSource& in) : vm(vm), mm(*vm.memoryManager), in(in) {}
+
+    void load() {
+        readModules();
+
+        size_t symbolCount = in.count();
+        symbols.reserve(symbolCount);
+        for (size_t i = 0; i < symbolCount; ++i) symbols.push_back(readSymbol());
+
+        // Cấp phát mọi object trước, để tham chiếu (kể cả vòng) trỏ được tới object phía sau.
+        size_t objectCount = in.count();
+        objects.reserve(objectCount);
+        for (size_t i = 0; i < objectCount; ++i) objects.push_back(allocate(static_cast<ObjectType>(in.u8())));
+        for (auto& [value, bytes] : objects) {
+            MeowObject* obj = valueObject(value);
+            readBody(obj);
+            size_t grown = obj->byteSize();
+            if (grown > bytes) mm.trackGrowth(grown - bytes);
+        }
+
+        for (size_t i = 0; i < modules.size(); ++i) {
+            if (kinds[i] != ModuleKind::Script) continue;
+            readFields(modules[i]->globals);
+            readFields(modules[i]->exports);
+        }
+
+        size_t keyCount = in.count();
+        for (size_t i = 0; i < keyCount; ++i) {
+            Str key = in.string();
+            Module module = modules[index(modules.size())];
+            if (!module) throw std::runtime_error("Khoá cache trỏ tới thư viện được nạp trễ trong heap image.");
+            vm.moduleCache[key] = module;
+        }
+        if (!in.atEnd()) throw std::runtime_error("Dữ liệu thừa ở cuối heap image.");
+    }
+
+private:
+    MeowVM& vm;
+    MemoryManager& mm;
+    ByteSource& in;
+
+    std::vector<Module> modules;
+    std::vector<ModuleKind> kinds;
+    std::vector<std::unordered_map<Str, Proto>> moduleProtos;
+    std::vector<Value> symbols;
+    // object cùng kích thước lúc cấp phát (phần lớn thêm sau đó được báo qua trackGrowth)
+    std::vector<std::pair<Value, size_t>> objects;
+
+    size_t index(size_t bound) {
+        Uint64 value = in.varint();
+        if (value >= bound) throw std::runtime_error("Chỉ số nằm ngoài bảng trong heap image.");
+        return static_cast<size_t>(value);
+    }
+
+    void readModules() {
+        size_t count = in.count();
+        moduleProtos.resize(count);
+        for (size_t i = 0; i < count; ++i) {
+            auto kind = static_cast<ModuleKind>(in.u8());
+            Module module = nullptr;
+            switch (kind) {
+                case ModuleKind::Native:
+                    vm.defineNativeModule();
+                    module = vm.moduleCache.at("native");
+                    break;
+                case ModuleKind::Library: {
+                    Str modulePath = in.string();
+                    Str libPath = in.string();
+                    if (in.u8()) module = vm.loadNativeLibrary(modulePath, libPath);
+                    else vm.deferredLibraries.emplace_back(modulePath, libPath);
+                    break;
+                }
+                case ModuleKind::Script:
+                    module = readScriptModule(moduleProtos[i]);
+                    break;
+                default:
+                    throw std::runtime_error("Loại module không hợp lệ trong heap image.");
+            }
+            modules.push_back(module);
+            kinds.push_back(kind);
+        }
+    }
+
+    Module readScriptModule(std::unordered_map<Str, Proto>& protos) {
+        Str name = in.string();
+        Str path = in.string();
+        Uint8 flags = in.u8();
+        BinaryParser parser;
+        if (!parser.parseBuffer(in.string(), 0, mm)) throw std::runtime_error("Không giải mã được proto của module '" + path + "' trong heap image.");
+        protos = std::move(parser.protos);
+
+        auto module = mm.newObject<ObjModule>(name, path, (flags & flagBinary) != 0);
+        module->isExecuted = (flags & flagExecuted) != 0;
+        if (flags & flagHasMain) {
+            auto it = protos.find("@main");
+            if (it == protos.end()) throw std::runtime_error("Module '" + path + "' trong heap image thiếu @main.");
+            module->mainProto = it->second;
+            module->hasMain = true;
+        }
+        for (const auto& [protoName, proto] : protos) mm.makePermanent(proto);
+        mm.makePermanent(module);
+        return module;
+    }
+
+    Value readSymbol() {
+        auto kind = static_cast<SymbolKind>(in.u8());
+        const std::unordered_map<Str, Value>* table = nullptr;
+        Str owner;
+        switch (kind) {
+            case SymbolKind::Global:
+            case SymbolKind::Export: {
+                Module module = modules[index(modules.size())];
+                if (!module) throw std::runtime_error("Ký hiệu thuộc thư viện được nạp trễ trong heap image.");
+                owner = module->name;
+                table = kind == SymbolKind::Global ? &module->globals : &module->exports;
+                break;
+            }
+            case SymbolKind::Method:
+            case SymbolKind::Getter: {
+                owner = in.string();
+                auto& builtins = kind == SymbolKind::Method ? vm.builtinMethods : vm.builtinGetters;
+                if (auto it = builtins.find(owner); it != builtins.end()) table = &it->second;
+                break;
+            }
+            default:
+                throw std::runtime_error("Loại ký hiệu không hợp lệ trong heap image.");
+        }
+        Str name = in.string();
+        if (table) {
+            if (auto it = table->find(name); it != table->end()) return it->second;
+        }
+        throw std::runtime_error("Không còn '" + name + "' trong '" + owner + "', heap image đã cũ so với thư viện native.");
+    }
+
+    std::pair<Value, size_t> allocate(ObjectType type) {
+        MeowObject* obj = nullptr;
+        Value value;
+        switch (type) {
+            case ObjectType::Upvalue: { auto o = mm.newObject<ObjUpvalue>(); obj = o; value = Value(o); break; }
+            case ObjectType::Closure: {
+                Proto proto = expect<Proto>(readValue());
+                if (!proto) throw std::runtime_error("Closure không có proto trong heap image.");
+                auto o = mm.newObject<ObjClosure>(proto);
+                obj = o;
+                value = Value(o);
+                break;
+            }
+            case ObjectType::Class: { auto o = mm.newObject<ObjClass>(); obj = o; value = Value(o); break; }
+            case ObjectType::Instance: { auto o = mm.newObject<ObjInstance>(); obj = o; value = Value(o); break; }
+            case ObjectType::BoundMethod: { auto o = mm.newObject<ObjBoundMethod>(); obj = o; value = Value(o); break; }
+            case ObjectType::Array: { auto o = mm.newObject<ObjArray>(); obj = o; value = Value(Array(o)); break; }
+            case ObjectType::Object: { auto o = mm.newObject<ObjObject>(); obj = o; value = Value(Object(o)); break; }
+            default:
+                throw std::runtime_error("Kiểu object không hợp lệ trong heap image.");
+        }
+        return { std::move(value), obj->byteSize() };
+    }
+
+    // Con trỏ kiểu T trong value (nullptr nếu value là null).
+    template<typename T>
+    T expect(const Value& value) {
+        if (value.is<Null>()) return nullptr;
+        if (!value.is<T>()) throw std::runtime_error("Tham chiếu sai kiểu trong heap image.");
+        return value.get<T>();
+    }
+
+    Value readValue() {
+        switch (static_cast<ValueTag>(in.u8())) {
+            case ValueTag::Null: return Value(Null{});
+            case ValueTag::Int: return Value(meowb::zigzagDecode(in.varint()));
+            case ValueTag::Real: return Value(in.real());
+            case ValueTag::False: return Value(false);
+            case ValueTag::True: return Value(true);
+            case ValueTag::String: return Value(in.string());
+            case ValueTag::Object: return objects.at(index(objects.size())).first;
+            case ValueTag::Module: {
+                Module module = modules[index(modules.size())];
+                if (!module) throw std::runtime_error("Giá trị trỏ tới thư viện được nạp trễ trong heap image.");
+                return Value(module);
+            }
+            case ValueTag::Proto: {
+                const auto& protos = moduleProtos[index(modules.size())];
+                auto it = protos.find(in.string());
+                if (it == protos.end()) throw std::runtime_error("Proto không có trong module của heap image.");
+                return Value(it->second);
+            }
+            case ValueTag::Symbol: return symbols.at(index(symbols.size()));
+        }
+        throw std::runtime_error("Tag giá trị không hợp lệ trong heap image.");
+    }
+
+    void readFields(std::unordered_map<Str, Value>& fields) {
+        size_t count = in.count();
+        fields.reserve(fields.size() + count);
+        for (size_t i = 0; i < count; ++i) {
+            Str name = in.string();
+            fields[name] = readValue();
+        }
+    }
+
+    void readBody(MeowObject* obj) {
+        switch (obj->objectType()) {
+            case ObjectType::Upvalue:
+                static_cast<ObjUpvalue*>(obj)->close(readValue());
+                break;
+            case ObjectType::Closure: {
+                auto* closure = static_cast<ObjClosure*>(obj);
+                if (in.count() != closure->upvalues.size()) throw std::runtime_error("Số upvalue của closure không khớp với proto trong heap image.");
+                for (auto& upvalue : closure->upvalues) upvalue = expect<Upvalue>(readValue());
+                break;
+            }
+            case ObjectType::Class: {
+                auto* klass = static_cast<ObjClass*>(obj);
+                klass->name = in.string();
+                if (Class super = expect<Class>(readValue())) klass->superclass = super;
+                readFields(klass->methods);
+                break;
+            }
+            case ObjectType::Instance: {
+                auto* instance = static_cast<ObjInstance*>(obj);
+                instance->klass = expect<Class>(readValue());
+                readFields(instance->fields);
+                break;
+            }
+            case ObjectType::BoundMethod: {
+                auto* bound = static_cast<ObjBoundMethod*>(obj);
+                bound->receiver = expect<Instance>(readValue());
+                bound->callable = expect<Function>(readValue());
+                break;
+            }
+            case ObjectType::Array: {
+                auto& elements = static_cast<ObjArray*>(obj)->elements;
+                size_t count = in.count();
+                elements.reserve(count);
+                for (size_t i = 0; i < count; ++i) elements.push_back(readValue());
+                break;
+            }
+            case ObjectType::Object:
+                readFields(static_cast<ObjObject*>(obj)->fields);
+                break;
+            default:
+                break;
+        }
+    }
+};
+
+void HeapImage::write(MeowVM& vm, const Str& path) {
+    vm.loadDeferredLibraries();
+    std::string bytes = Writer(vm).encode();
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        throw std::runtime_error("Không thể mở file để ghi heap image: " + path);
+    }
+    out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    if (!out) throw std::runtime_error("Không ghi được heap image: " + path);
+}
+
+void HeapImage::load(MeowVM& vm, const Str& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) throw std::runtime_error("Không thể mở heap image: " + path);
+    std::string bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (bytes.size() < sizeof(imageMagic) || std::memcmp(bytes.data(), imageMagic, sizeof(imageMagic)) != 0) {
+        throw std::runtime_error("File không phải heap image: " + path);
+    }
+
+    // Object vừa dựng chưa nằm trong root nào cho tới khi được gắn vào module.
+    GCScopeGuard gcGuard(vm.memoryManager.get());
+    ByteSource in(bytes.data() + sizeof(imageMagic), bytes.data() + bytes.size());
+    Reader(vm, in).load();
+}
@@ -113,6 +113,7 @@ Str MeowVM::_toString(const Value& v) {
         if (v.is<Proto>()) {
         Proto proto = v.get<Proto>();
         if (!proto) return "<null proto>";
+        proto->materialize();
         std::ostringstream os;
 
         os << "<function proto '" << proto->sourceName << "'>\n";
@@ -396,6 +397,15 @@ Str MeowVM::opToString(OpCode op) const {
         case OpCode::GET_EXPORT: return "GET_EXPORT";
         case OpCode::GET_MODULE_EXPORT: return "GET_MODULE_EXPORT";
         case OpCode::IMPORT_ALL: return "IMPORT_ALL";
+        case OpCode::JUMP_IF_LT: return "JUMP_IF_LT";
+        case OpCode::JUMP_IF_LE: return "JUMP_IF_LE";
+        case OpCode::JUMP_IF_EQ: return "JUMP_IF_EQ";
+        case OpCode::JUMP_IF_NOT_LT: return "JUMP_IF_NOT_LT";
+        case OpCode::JUMP_IF_NOT_LE: return "JUMP_IF_NOT_LE";
+        case OpCode::JUMP_IF_NOT_EQ: return "JUMP_IF_NOT_EQ";
+        case OpCode::ADD_INT_IMM: return "ADD_INT_IMM";
+        case OpCode::GET_PROP_CALL: return "GET_PROP_CALL";
+        case OpCode::LOAD_CONST_RETURN: return "LOAD_CONST_RETURN";
         case OpCode::TOTAL_OPCODES: return "TOTAL_OPCODES";
         default: return "UNKNOWN_OPCODE";
     }
@@ -588,4 +598,12 @@ void MeowVM::throwVMError(const Str& msg) {
         }
     }
     throw VMError(os.str());
+}
+
+void MeowVM::setField(MeowObject* owner, std::unordered_map<Str, Value>& fields, const Str& key, const Value& value) {
+    auto [it, inserted] = fields.insert_or_assign(key, value);
+    memoryManager->writeBarrier(owner, value);
+    if (inserted) {
+        memoryManager->trackGrowth(fieldNodeBytes(key, value));
+    }
 }
\ No newline at end of file
@@ -61,10 +61,7 @@ static std::string expandOriginToken(const std::string& raw, const std::filesyst
 }
 
 // --- detect stdlib root: đọc file meow-root cạnh binary (1 lần, cached) ---
-static std::filesystem::path detectStdlibRoot_cached() {
-    static std::optional<std::filesystem::path> cached;
-    if (cached.has_value()) return *cached;
-
+static std::filesystem::path detectStdlibRoot() {
     std::filesystem::path result;
     try {
         std::filesystem::path exeDir = getExecutableDir(); // thư mục chứa binary
@@ -84,9 +81,7 @@ static std::filesystem::path detectStdlibRoot_cached() {
 
                 if (!line.empty()) {
                     std::string expanded = expandOriginToken(line, exeDir);
-                    result = std::filesystem::absolute(std::filesystem::path(expanded));
-                    cached = result;
-                    return result;
+                    return std::filesystem::absolute(std::filesystem::path(expanded));
                 }
             }
         }
@@ -99,15 +94,19 @@ static std::filesystem::path detectStdlibRoot_cached() {
         }
 
         // 3) nếu không tìm thấy stdlib trực tiếp ở root, có thể thử root/lib
-        cached = std::filesystem::absolute(result);
-        return *cached;
+        return std::filesystem::absolute(result);
     } catch (...) {
         // fallback to current path nếu có gì sai
-        cached = std::filesystem::current_path();
-        return *cached;
+        return std::filesystem::current_path();
     }
 }
 
+// Khởi tạo static cục bộ an toàn khi nhiều luồng cùng gọi (luồng đọc trước module).
+static std::filesystem::path detectStdlibRoot_cached() {
+    static const std::filesystem::path root = detectStdlibRoot();
+    return root;
+}
+
 
 static std::string platformLastError() {
 #if defined(_WIN32)
@@ -126,138 +125,172 @@ static std::string platformLastError() {
 #endif
 }
 
-Module MeowVM::_getOrLoadModule(const Str& modulePath, const Str& importerPath, Bool isBinary) {
-    if (auto it = moduleCache.find(modulePath); it != moduleCache.end()) {
-        return it->second;
-    }
-
 #if defined(_WIN32)
-    Str libExtension = ".dll";
+static constexpr const char* libExtension = ".dll";
 #elif defined(__APPLE__)
-    Str libExtension = ".dylib";
+static constexpr const char* libExtension = ".dylib";
 #else
-    Str libExtension = ".so";
+static constexpr const char* libExtension = ".so";
 #endif
 
-    auto resolveLibraryPath = [&](const Str& modPath, const Str& importer) -> Str {
-        try {
-            std::filesystem::path candidate(modPath);
-            std::string ext = candidate.extension().string();
-
-            if (!ext.empty()) {
-                std::string extLower = ext;
-                for (char &c : extLower) c = (char)std::tolower((unsigned char)c);
-                if (extLower == ".meow" || extLower == ".meowb") {
-                    return "";
-                }
-            }
-
-            if (candidate.extension().empty()) {
-                candidate.replace_extension(libExtension);
+// Đường dẫn tuyệt đối của thư viện native mà modPath trỏ tới, hoặc chuỗi rỗng
+// nếu modPath là module .meow/.meowb hay không tìm thấy thư viện.
+static Str resolveLibraryPath(const Str& modPath, const Str& importer, const Str& entryPointDir) {
+    try {
+        std::filesystem::path candidate(modPath);
+        std::string ext = candidate.extension().string();
+
+        if (!ext.empty()) {
+            std::string extLower = ext;
+            for (char &c : extLower) c = (char)std::tolower((unsigned char)c);
+            if (extLower == ".meow" || extLower == ".meowb") {
+                return "";
             }
+        }
 
-            if (candidate.is_absolute() && std::filesystem::exists(candidate)) {
-                return std::filesystem::absolute(candidate).lexically_normal().string();
-            }
+        if (candidate.extension().empty()) {
+            candidate.replace_extension(libExtension);
+        }
 
-            std::filesystem::path stdlibRoot = detectStdlibRoot_cached();
-            std::filesystem::path stdlibPath = stdlibRoot / candidate;
-            if (std::filesystem::exists(stdlibPath)) {
-                return std::filesystem::absolute(stdlibPath).lexically_normal().string();
-            }
+        if (candidate.is_absolute() && std::filesystem::exists(candidate)) {
+            return std::filesystem::absolute(candidate).lexically_normal().string();
+        }
 
-            // thử dưới stdlibRoot/lib/candidate
-            stdlibPath = stdlibRoot / "lib" / candidate;
-            if (std::filesystem::exists(stdlibPath)) {
-                return std::filesystem::absolute(stdlibPath).lexically_normal().string();
-            }
+        std::filesystem::path stdlibRoot = detectStdlibRoot_cached();
+        std::filesystem::path stdlibPath = stdlibRoot / candidate;
+        if (std::filesystem::exists(stdlibPath)) {
+            return std::filesystem::absolute(stdlibPath).lexically_normal().string();
+        }
 
-            // thử dưới stdlibRoot/stdlib/candidate
-            stdlibPath = stdlibRoot / "stdlib" / candidate;
-            if (std::filesystem::exists(stdlibPath)) {
-                return std::filesystem::absolute(stdlibPath).lexically_normal().string();
-            }
+        // thử dưới stdlibRoot/lib/candidate
+        stdlibPath = stdlibRoot / "lib" / candidate;
+        if (std::filesystem::exists(stdlibPath)) {
+            return std::filesystem::absolute(stdlibPath).lexically_normal().string();
+        }
 
-            // --- bổ sung: nhiều dự án đặt stdlib trong bin/stdlib hoặc stdlib trong bin ---
-            stdlibPath = stdlibRoot / "bin" / "stdlib" / candidate;
-            if (std::filesystem::exists(stdlibPath)) {
-                return std::filesystem::absolute(stdlibPath).lexically_normal().string();
-            }
+        // thử dưới stdlibRoot/stdlib/candidate
+        stdlibPath = stdlibRoot / "stdlib" / candidate;
+        if (std::filesystem::exists(stdlibPath)) {
+            return std::filesystem::absolute(stdlibPath).lexically_normal().string();
+        }
 
-            stdlibPath = stdlibRoot / "bin" / candidate;
-            if (std::filesystem::exists(stdlibPath)) {
-                return std::filesystem::absolute(stdlibPath).lexically_normal().string();
-            }
+        // --- bổ sung: nhiều dự án đặt stdlib trong bin/stdlib hoặc stdlib trong bin ---
+        stdlibPath = stdlibRoot / "bin" / "stdlib" / candidate;
+        if (std::filesystem::exists(stdlibPath)) {
+            return std::filesystem::absolute(stdlibPath).lexically_normal().string();
+        }
 
-            // optional: nếu meow-root thực sự trỏ lên một level, vẫn thử parent/bin/stdlib
-            stdlibPath = std::filesystem::absolute(stdlibRoot / ".." / "bin" / "stdlib" / candidate);
-            if (std::filesystem::exists(stdlibPath)) {
-                return std::filesystem::absolute(stdlibPath).lexically_normal().string();
-            }
+        stdlibPath = stdlibRoot / "bin" / candidate;
+        if (std::filesystem::exists(stdlibPath)) {
+            return std::filesystem::absolute(stdlibPath).lexically_normal().string();
+        }
 
+        // optional: nếu meow-root thực sự trỏ lên một level, vẫn thử parent/bin/stdlib
+        stdlibPath = std::filesystem::absolute(stdlibRoot / ".." / "bin" / "stdlib" / candidate);
+        if (std::filesystem::exists(stdlibPath)) {
+            return std::filesystem::absolute(stdlibPath).lexically_normal().string();
+        }
 
 
-            std::filesystem::path baseDir = (importer == entryPointDir)
-                ? std::filesystem::path(entryPointDir)
-                : std::filesystem::path(importer).parent_path();
 
-            std::filesystem::path relativePath = std::filesystem::absolute(baseDir / candidate);
-            if (std::filesystem::exists(relativePath)) {
-                return relativePath.lexically_normal().string();
-            }
+        std::filesystem::path baseDir = (importer == entryPointDir)
+            ? std::filesystem::path(entryPointDir)
+            : std::filesystem::path(importer).parent_path();
 
-            return "";
-        } catch (const std::exception& ex) {
-            return "";
+        std::filesystem::path relativePath = std::filesystem::absolute(baseDir / candidate);
+        if (std::filesystem::exists(relativePath)) {
+            return relativePath.lexically_normal().string();
         }
-    };
 
-    Str libPath = resolveLibraryPath(modulePath, importerPath);
+        return "";
+    } catch (const std::exception& ex) {
+        return "";
+    }
+}
 
-    if (!libPath.empty()) {
-        void* handle = nullptr;
+// Đường dẫn tuyệt đối của module .meow/.meowb, tính từ thư mục của module import nó.
+static Str resolveScriptPath(const Str& modulePath, const Str& importerPath, const Str& entryPointDir) {
+    std::filesystem::path baseDir = (importerPath == entryPointDir)
+        ? std::filesystem::path(entryPointDir)
+        : std::filesystem::path(importerPath).parent_path();
+    std::filesystem::path resolvedPath = std::filesystem::absolute(baseDir / modulePath);
+    return resolvedPath.lexically_normal().string();
+}
+
+// dlopen thư viện đã biết đường dẫn tuyệt đối rồi gọi CreateMeowModule của nó.
+// Dùng chung cho import và cho heap image (đường dẫn đã được giải từ trước).
+Module MeowVM::loadNativeLibrary(const Str& modulePath, const Str& libPath) {
+    void* handle = nullptr;
 #if defined(_WIN32)
-        handle = (void*)LoadLibraryA(libPath.c_str());
+    handle = (void*)LoadLibraryA(libPath.c_str());
 #else
-        dlerror();
-        handle = dlopen(libPath.c_str(), RTLD_LAZY);
+    dlerror();
+    handle = dlopen(libPath.c_str(), RTLD_LAZY);
 #endif
-        if (!handle) {
-            std::string detail = platformLastError();
-            throw VMError("Không thể tải thư viện native: " + libPath + (detail.empty() ? "" : (" - " + detail)));
-        }
+    if (!handle) {
+        std::string detail = platformLastError();
+        throw VMError("Không thể tải thư viện native: " + libPath + (detail.empty() ? "" : (" - " + detail)));
+    }
 
-        using NativeFunction = Module(*)(MeowEngine*);
-        NativeFunction factory = nullptr;
+    using NativeFunction = Module(*)(MeowEngine*);
+    NativeFunction factory = nullptr;
 #if defined(_WIN32)
 
-        auto procAddress = GetProcAddress((HMODULE)handle, "CreateMeowModule");
+    auto procAddress = GetProcAddress((HMODULE)handle, "CreateMeowModule");
 
-        if (procAddress == nullptr) {
-            std::string detail = platformLastError();
-            throw VMError("Không tìm thấy cổng giao tiếp 'CreateMeowModule' trong " + libPath + (detail.empty() ? "" : (" - " + detail)));
-        }
+    if (procAddress == nullptr) {
+        std::string detail = platformLastError();
+        throw VMError("Không tìm thấy cổng giao tiếp 'CreateMeowModule' trong " + libPath + (detail.empty() ? "" : (" - " + detail)));
+    }
 
-        factory = reinterpret_cast<NativeFunction>(procAddress);
+    factory = reinterpret_cast<NativeFunction>(procAddress);
 
 #else
-        dlerror();
-        factory = (NativeFunction)dlsym(handle, "CreateMeowModule");
+    dlerror();
+    factory = (NativeFunction)dlsym(handle, "CreateMeowModule");
 #endif
 
-        Module nativeModule = factory(this);
+    Module nativeModule = factory(this);
+    memoryManager->makePermanent(nativeModule);
+
+    moduleCache[modulePath] = nativeModule;
+    moduleCache[libPath] = nativeModule;
+    nativeLibraries.emplace_back(modulePath, libPath);
 
-        moduleCache[modulePath] = nativeModule;
-        moduleCache[libPath] = nativeModule;
+    return nativeModule;
+}
 
-        return nativeModule;
+// Nạp theo đúng thứ tự ban đầu, vì thư viện nạp sau có thể ghi đè method dựng sẵn của thư viện trước.
+void MeowVM::loadDeferredLibraries() {
+    GCScopeGuard gcGuard(memoryManager.get());
+    auto libraries = std::move(deferredLibraries);
+    deferredLibraries.clear();
+    for (const auto& [modulePath, libPath] : libraries) {
+        loadNativeLibrary(modulePath, libPath);
     }
+}
 
-    std::filesystem::path baseDir = (importerPath == entryPointDir)
-        ? std::filesystem::path(entryPointDir)
-        : std::filesystem::path(importerPath).parent_path();
-    std::filesystem::path resolvedPath = std::filesystem::absolute(baseDir / modulePath);
-    Str absolutePath = resolvedPath.lexically_normal().string();
+Module MeowVM::_getOrLoadModule(const Str& modulePath, const Str& importerPath, Bool isBinary) {
+    if (auto it = moduleCache.find(modulePath); it != moduleCache.end()) {
+        return it->second;
+    }
+    auto isDeferred = [&modulePath](const std::pair<Str, Str>& library) { return library.first == modulePath; };
+    if (std::any_of(deferredLibraries.begin(), deferredLibraries.end(), isDeferred)) {
+        loadDeferredLibraries();
+        return moduleCache.at(modulePath);
+    }
+
+    // Proto/module đang dựng dở chưa nằm trong root nào, không được để GC chạy giữa chừng.
+    GCScopeGuard gcGuard(memoryManager.get());
+
+    Str libPath = resolveLibraryPath(modulePath, importerPath, entryPointDir);
+
+    if (!libPath.empty()) {
+        if (!deferredLibraries.empty()) loadDeferredLibraries();
+        return loadNativeLibrary(modulePath, libPath);
+    }
+
+    Str absolutePath = resolveScriptPath(modulePath, importerPath, entryPointDir);
 
     if (auto it = moduleCache.find(absolutePath); it != moduleCache.end()) {
         return it->second;
@@ -269,9 +302,20 @@ Module MeowVM::_getOrLoadModule(const Str& modulePath, const Str& importerPath,
             throw VMError("Binary parsing failed for file: " + absolutePath);
         protos = binaryParser.protos;
     } else {
-        if (!textParser.parseFile(absolutePath, *memoryManager))
-            throw VMError("Text parsing failed for file: " + absolutePath);
-        protos = textParser.protos;
+        auto stamp = bytecodeCache.stamp(absolutePath, optimizerConfig.level);
+        if (!stamp || !bytecodeCache.load(*stamp, *memoryManager, protos)) {
+            std::optional<ParsedModule> parsed;
+            if (modulePrefetcher) parsed = modulePrefetcher->take(absolutePath);
+            if (!parsed) {
+                textParser.setOptimizationLevel(optimizerConfig.level);
+                if (!textParser.parseFile(absolutePath))
+                    throw VMError("Text parsing failed for file: " + absolutePath);
+                parsed = textParser.takeParsed();
+                prefetchImports(*parsed, absolutePath);
+            }
+            protos = BytecodeParser::instantiate(std::move(*parsed), *memoryManager);
+            if (stamp) bytecodeCache.store(*stamp, protos);
+        }
     }
 
     const Str mainName = "@main";
@@ -292,6 +336,28 @@ Module MeowVM::_getOrLoadModule(const Str& modulePath, const Str& importerPath,
         }
     }
 
+    // Code đã nạp sống suốt chương trình: proto và module vào vùng vĩnh viễn,
+    // GC chỉ còn duyệt global/export của module.
+    for (const auto& [name, proto] : protos) {
+        memoryManager->makePermanent(proto);
+    }
+    memoryManager->makePermanent(newModule);
+
     moduleCache[absolutePath] = newModule;
     return newModule;
 }
+
+
+void MeowVM::prefetchImports(const ParsedModule& module, const Str& importerPath) {
+    if (modulePrefetchConfig.threads == 0) return;
+    if (!modulePrefetcher) {
+        // Resolver chạy trên luồng nền nên chỉ chép những gì nó cần, không giữ `this`.
+        auto resolver = [entryPointDir = entryPointDir](const Str& modulePath, const Str& importer) -> Str {
+            if (!resolveLibraryPath(modulePath, importer, entryPointDir).empty()) return "";
+            return resolveScriptPath(modulePath, importer, entryPointDir);
+        };
+        modulePrefetcher = std::make_unique<ModulePrefetcher>(modulePrefetchConfig.threads, std::move(resolver), bytecodeCache,
+                                                              optimizerConfig.level);
+    }
+    modulePrefetcher->scheduleImports(module, importerPath);
+}
\ No newline at end of file
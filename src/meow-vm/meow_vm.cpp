@@ -1,18 +1,20 @@
 #include "meow_vm.h"
 #include "mark_sweep_gc.h"
 #include "meow_object.h"
+#include "heap_snapshot.h"
+#include "heap_image.h"
 
-MeowVM::MeowVM(const Str& entryPointDir_) : entryPointDir(entryPointDir_) {
-    memoryManager = std::make_unique<MemoryManager>(std::make_unique<MarkSweepGC>());
+MeowVM::MeowVM(const Str& entryPointDir_, const GCConfig& gcConfig) : entryPointDir(entryPointDir_) {
+    memoryManager = std::make_unique<MemoryManager>(std::make_unique<MarkSweepGC>(gcConfig), gcConfig);
     memoryManager->setVM(this);
-    defineNativeFunctions();
+    useStackMaps = gcConfig.stackMaps;
     initializeJumpTable();
 }
 
-MeowVM::MeowVM(const Str& entryPointDir_, int argc, char* argv[]) : entryPointDir(entryPointDir_) {
-    memoryManager = std::make_unique<MemoryManager>(std::make_unique<MarkSweepGC>());
+MeowVM::MeowVM(const Str& entryPointDir_, int argc, char* argv[], const GCConfig& gcConfig) : entryPointDir(entryPointDir_) {
+    memoryManager = std::make_unique<MemoryManager>(std::make_unique<MarkSweepGC>(gcConfig), gcConfig);
     memoryManager->setVM(this);
-    defineNativeFunctions();
+    useStackMaps = gcConfig.stackMaps;
     initializeJumpTable();
 
     commandLineArgs.reserve(argc);
@@ -21,16 +23,34 @@ MeowVM::MeowVM(const Str& entryPointDir_, int argc, char* argv[]) : entryPointDi
     }
 }
 
-void MeowVM::interpret(const Str& entryPath, Bool isBinary) {
+void MeowVM::resetEnvironment() {
     callStack.clear();
     stackSlots.clear();
     openUpvalues.clear();
     moduleCache.clear();
+    nativeLibraries.clear();
+    deferredLibraries.clear();
+    entryModule = nullptr;
+    modulePrefetcher.reset();
     exceptionHandlers.clear();
-    defineNativeFunctions();
+    // Code và module của chương trình trước không còn được cache giữ: trả vùng
+    // vĩnh viễn về heap thường để chúng được thu hồi thay vì tích lại sau mỗi
+    // lần interpret. Thứ còn được tham chiếu (builtin, pin) vẫn sống.
+    memoryManager->releasePermanent();
+}
+
+void MeowVM::interpret(const Str& entryPath, Bool isBinary) {
+    // Môi trường chỉ được dựng khi cần: lần chạy đầu sau loadHeapImage dùng
+    // luôn môi trường từ image, các lần chạy sau đó bắt đầu lại từ đầu.
+    if (!environmentReady) {
+        resetEnvironment();
+        defineNativeFunctions();
+    }
+    environmentReady = false;
 
     try {
         auto entryMod = _getOrLoadModule(entryPath, entryPointDir, isBinary);
+        entryModule = entryMod;
 
         if (!entryMod->isExecuted) {
             if (!entryMod->hasMain) throw VMError("Entry module thiếu @main.");
@@ -52,24 +72,93 @@ void MeowVM::interpret(const Str& entryPath, Bool isBinary) {
     }
 }
 
+void MeowVM::writeHeapSnapshot(const Str& path) {
+    HeapSnapshot::capture(*this).writeToFile(path);
+}
+
+void MeowVM::writeHeapImage(const Str& path) {
+    // Chưa chạy gì: ghi môi trường mặc định, và dùng luôn nó cho lần interpret kế tiếp.
+    if (moduleCache.empty()) {
+        defineNativeFunctions();
+        environmentReady = true;
+    }
+    HeapImage::write(*this, path);
+}
+
+void MeowVM::loadHeapImage(const Str& path) {
+    resetEnvironment();
+    HeapImage::load(*this, path);
+    environmentReady = true;
+}
+
+void MeowVM::setAllocationProfiling(bool enabled) {
+    if (enabled && !allocationProfiler) {
+        allocationProfiler = std::make_unique<AllocationProfiler>(*this);
+    }
+    memoryManager->setAllocationObserver(enabled ? allocationProfiler.get() : nullptr);
+}
+
+std::vector<AllocationSite> MeowVM::getAllocationSites() const {
+    if (!allocationProfiler) return {};
+    return allocationProfiler->summary();
+}
+
+std::pair<const ObjFunctionProto*, Int> MeowVM::currentSite() const {
+    if (callStack.empty()) return { nullptr, -1 };
+    const CallFrame& frame = callStack.back();
+    if (!frame.closure) return { nullptr, -1 };
+    return { frame.closure->proto, frame.ip - 1 };
+}
+
+// Frame trên cùng ở safepoint sắp chạy lệnh ip; mọi frame khác (và frame trên
+// cùng khi GC chạy giữa một lệnh, như khi gc.region đóng region)
+// đang dừng giữa lệnh ip - 1. Ô có upvalue đang mở không bao giờ bị xoá: closure
+// con đọc nó mà không qua stack map của hàm cha.
+void MeowVM::clearDeadRegisters() {
+    if (!useStackMaps) return;
+    const Int stackSize = static_cast<Int>(stackSlots.size());
+    for (size_t f = 0; f < callStack.size(); ++f) {
+        const CallFrame& frame = callStack[f];
+        if (!frame.closure || !frame.closure->proto) continue;
+        const ObjFunctionProto& proto = *frame.closure->proto;
+        const StackMap& map = proto.stackMap;
+        bool top = f + 1 == callStack.size();
+        Int ip = top && collectingAtSafepoint ? frame.ip : frame.ip - 1;
+        if (map.empty() || ip < 0 || static_cast<size_t>(ip) >= map.entries()) continue;
+
+        Int begin = frame.slotStart;
+        Int end = std::min(begin + proto.numRegisters, stackSize);
+        if (!top) end = std::min(end, callStack[f + 1].slotStart);
+        auto upvalue = std::lower_bound(openUpvalues.begin(), openUpvalues.end(), begin,
+                                        [](const Upvalue& up, Int slot) { return up->slotIndex < slot; });
+        for (Int slot = begin; slot < end; ++slot) {
+            while (upvalue != openUpvalues.end() && (*upvalue)->slotIndex < slot) ++upvalue;
+            if (upvalue != openUpvalues.end() && (*upvalue)->slotIndex == slot) continue;
+            if (!map.isLive(static_cast<size_t>(ip), slot - begin)) stackSlots[slot] = Value(Null{});
+        }
+    }
+}
+
 void MeowVM::traceRoots(GCVisitor& visitor) {
     for (Value& val : stackSlots) {
         visitor.visitValue(val);
     }
 
     for (auto& pair : moduleCache) {
-        visitor.visitObject(pair.second);
+        visitor.visitSlot(pair.second);
     }
 
-    for (ObjUpvalue* upvalue : openUpvalues) {
-        visitor.visitObject(upvalue);
+    for (Upvalue& upvalue : openUpvalues) {
+        visitor.visitSlot(upvalue);
     }
 
     for (CallFrame& frame : callStack) {
-        visitor.visitObject(frame.closure);
-        visitor.visitObject(frame.module);
+        visitor.visitSlot(frame.closure);
+        visitor.visitSlot(frame.module);
     }
 
+    if (!builtinsNeedTracing) return;
+
     for (auto& type_pair : builtinMethods) {
         for (auto& method_pair : type_pair.second) {
             visitor.visitValue(method_pair.second);
@@ -125,6 +214,13 @@ void MeowVM::run() {
             continue;
         }
         try {
+            // Giữa hai lệnh mọi giá trị sống đều nằm trong root nên đây là safepoint của GC.
+            if (memoryManager->isCollectionPending()) {
+                collectingAtSafepoint = true;
+                memoryManager->collectPending();
+                collectingAtSafepoint = false;
+            }
+
             currentInst = &proto->code[currentFrame->ip++];
             Int32 opcode = static_cast<Int32>(currentInst->op);
 
@@ -262,4 +358,15 @@ void MeowVM::initializeJumpTable() {
     jumpTable[static_cast<Int32>(OpCode::SETUP_TRY)] = &MeowVM::opSetupTry;
     jumpTable[static_cast<Int32>(OpCode::POP_TRY)] = &MeowVM::opPopTry;
     jumpTable[static_cast<Int32>(OpCode::THROW)] = &MeowVM::opThrow;
+
+
+    jumpTable[static_cast<Int32>(OpCode::JUMP_IF_LT)] = &MeowVM::opCompareJump;
+    jumpTable[static_cast<Int32>(OpCode::JUMP_IF_LE)] = &MeowVM::opCompareJump;
+    jumpTable[static_cast<Int32>(OpCode::JUMP_IF_EQ)] = &MeowVM::opCompareJump;
+    jumpTable[static_cast<Int32>(OpCode::JUMP_IF_NOT_LT)] = &MeowVM::opCompareJump;
+    jumpTable[static_cast<Int32>(OpCode::JUMP_IF_NOT_LE)] = &MeowVM::opCompareJump;
+    jumpTable[static_cast<Int32>(OpCode::JUMP_IF_NOT_EQ)] = &MeowVM::opCompareJump;
+    jumpTable[static_cast<Int32>(OpCode::ADD_INT_IMM)] = &MeowVM::opAddIntImm;
+    jumpTable[static_cast<Int32>(OpCode::GET_PROP_CALL)] = &MeowVM::opGetPropCall;
+    jumpTable[static_cast<Int32>(OpCode::LOAD_CONST_RETURN)] = &MeowVM::opLoadConstReturn;
 }
\ No newline at end of file
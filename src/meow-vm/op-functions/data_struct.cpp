@@ -6,11 +6,9 @@ void MeowVM::opNewArray() {
     if (currentBase + startIdx + count > static_cast<Int>(stackSlots.size()))
         throwVMError("NEW_ARRAY: register range OOB");
 
-    Array arr = new ObjArray();
-    arr->elements.reserve(count);
-    for (Int i = 0; i < count; ++i) {
-        arr->elements.push_back(stackSlots[currentBase + startIdx + i]);
-    }
+    ValueArray elements(stackSlots.begin() + currentBase + startIdx,
+                        stackSlots.begin() + currentBase + startIdx + count);
+    Array arr = memoryManager->newObject<ObjArray>(std::move(elements));
     stackSlots[currentBase + dst] = Value(arr);
 }
 
@@ -20,12 +18,14 @@ void MeowVM::opNewHash() {
     if (currentBase + startIdx + count*2 > static_cast<Int>(stackSlots.size()))
         throwVMError("NEW_HASH: register range OOB");
 
-    Object hm = new ObjObject();
+    std::unordered_map<Str, Value> fields;
+    fields.reserve(count);
     for (Int i = 0; i < count; ++i) {
         Value& key = stackSlots[currentBase + startIdx + i * 2];
         Value& val = stackSlots[currentBase + startIdx + i * 2 + 1];
-        hm->fields[_toString(key)] = val;
+        fields.insert_or_assign(_toString(key), val);
     }
+    Object hm = memoryManager->newObject<ObjObject>(std::move(fields));
     stackSlots[currentBase + dst] = Value(hm);
 }
 
@@ -136,9 +136,13 @@ void MeowVM::opSetIndex() {
             if (idx < 0) throwVMError("Invalid index");
             if (idx >= static_cast<Int>(arr->elements.size())) {
                 if (idx > 10000000) throwVMError("Index too large");
+                size_t oldCapacity = arr->elements.capacity();
                 arr->elements.resize(static_cast<size_t>(idx + 1));
+                memoryManager->trackGrowth((arr->elements.capacity() - oldCapacity) * sizeof(Value));
             }
+            memoryManager->trackGrowth(valueHeapBytes(val));
             arr->elements[static_cast<size_t>(idx)] = val;
+            memoryManager->writeBarrier(arr, val);
             return;
         }
         if (isString(src)) {
@@ -157,7 +161,7 @@ void MeowVM::opSetIndex() {
         if (isMap(src)) {
             Object m = src.get<Object>();
             Str k = _toString(key);
-            m->fields[k] = val;
+            setField(m, m->fields, k, val);
             return;
         }
         throwVMError("Numeric index not supported on type '" + _toString(src) + "'");
@@ -173,18 +177,18 @@ void MeowVM::opSetIndex() {
 
     if (isInstance(src)) {
         Instance inst = src.get<Instance>();
-        inst->fields[keyName] = val;
+        setField(inst, inst->fields, keyName, val);
         return;
     }
     if (isMap(src)) {
         Object m = src.get<Object>();
-        m->fields[keyName] = val;
+        setField(m, m->fields, keyName, val);
         return;
     }
     if (isClass(src)) {
         Class cls = src.get<Class>();
         if (!isClosure(val) && !val.is<BoundMethod>()) throwVMError("Method must be closure");
-        cls->methods[keyName] = val;
+        setField(cls, cls->methods, keyName, val);
         return;
     }
 
@@ -235,7 +239,7 @@ void MeowVM::opGetKeys() {
         }
     }
 
-
+    memoryManager->trackGrowth(valueVectorBytes(keysArr->elements));
     stackSlots[currentBase + dst] = Value(keysArr);
 }
 
@@ -282,5 +286,6 @@ void MeowVM::opGetValues() {
             valueArr->elements.push_back(Value(Str(1, c)));
         }
     }
+    memoryManager->trackGrowth(valueVectorBytes(valueArr->elements));
     stackSlots[currentBase + dst] = Value(valueArr);
 }
\ No newline at end of file
@@ -56,7 +56,7 @@ void MeowVM::opSetGlobal() {
         throwVMError("Global variable name must be a string");
     }
     auto name = proto->constantPool[constIdx].get<Str>();
-    currentFrame->module->globals[name] = stackSlots[currentBase + src];
+    setField(currentFrame->module, currentFrame->module->globals, name, stackSlots[currentBase + src]);
 }
 
 void MeowVM::opGetUpvalue() {
@@ -84,5 +84,6 @@ void MeowVM::opSetUpvalue() {
         stackSlots[uv->slotIndex] = stackSlots[currentBase + src];
     } else {
         uv->closed = stackSlots[currentBase + src];
+        memoryManager->writeBarrier(uv, uv->closed);
     }
 }
@@ -42,7 +42,7 @@ void MeowVM::opExport() {
     if (!isString(proto->constantPool[nameIdx])) 
         throwVMError("EXPORT name must be a string");
     Str exportName = proto->constantPool[nameIdx].get<Str>();
-    currentFrame->module->exports[exportName] = stackSlots[currentBase + srcReg];
+    setField(currentFrame->module, currentFrame->module->exports, exportName, stackSlots[currentBase + srcReg]);
 }
 
 void MeowVM::opGetExport() {
@@ -109,6 +109,6 @@ void MeowVM::opImportAll() {
     auto currentModule = currentFrame->module;
 
     for (const auto& pair : importedModule->exports) {
-        currentModule->globals[pair.first] = pair.second;
+        setField(currentModule, currentModule->globals, pair.first, pair.second);
     }
 }
\ No newline at end of file
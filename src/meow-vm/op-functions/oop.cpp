@@ -21,8 +21,11 @@ void MeowVM::opNewInstance() {
 }
 
 void MeowVM::opGetProp() {
+    getProperty(currentInst->args[0], currentInst->args[1], currentInst->args[2]);
+}
+
+void MeowVM::getProperty(Int dst, Int objReg, Int nameIdx) {
     auto proto = currentFrame->closure->proto;
-    Int dst = currentInst->args[0], objReg = currentInst->args[1], nameIdx = currentInst->args[2];
 
     if (currentBase + objReg >= static_cast<Int>(stackSlots.size()) ||
         currentBase + dst >= static_cast<Int>(stackSlots.size()))
@@ -73,18 +76,18 @@ void MeowVM::opSetProp() {
 
     if (isInstance(obj)) {
         Instance inst = obj.get<Instance>();
-        inst->fields[name] = val;
+        setField(inst, inst->fields, name, val);
         return;
     }
     if (isMap(obj)) {
         Object m = obj.get<Object>();
-        m->fields[name] = val;
+        setField(m, m->fields, name, val);
         return;
     }
     if (isClass(obj)) {
         Class cls = obj.get<Class>();
         if (!isClosure(val) && !val.is<BoundMethod>()) throwVMError("Method must be closure");
-        cls->methods[name] = val;
+        setField(cls, cls->methods, name, val);
         return;
     }
 
@@ -105,7 +108,7 @@ void MeowVM::opSetMethod() {
     Str name = proto->constantPool[nameIdx].get<Str>();
     if(!isClosure(stackSlots[currentBase + methodReg])) 
         throwVMError("Method value must be a closure");
-    klassVal.get<Class>()->methods[name] = stackSlots[currentBase + methodReg];
+    setField(klassVal.get<Class>(), klassVal.get<Class>()->methods, name, stackSlots[currentBase + methodReg]);
 }
 
 void MeowVM::opInherit() {
@@ -114,11 +117,13 @@ void MeowVM::opInherit() {
     Value& superClassVal = stackSlots[currentBase + superClassReg];
     if(!isClass(subClassVal) || !isClass(superClassVal)) throwVMError("Cả hai toán hạng cho kế thừa phải là class.");
     subClassVal.get<Class>()->superclass = superClassVal.get<Class>();
+    memoryManager->writeBarrier(subClassVal.get<Class>(), superClassVal);
     auto& subMethods = subClassVal.get<Class>()->methods;
     auto& superMethods = superClassVal.get<Class>()->methods;
     for(const auto& pair : superMethods) {
         if(subMethods.find(pair.first) == subMethods.end()) {
             subMethods[pair.first] = pair.second;
+            memoryManager->writeBarrier(subClassVal.get<Class>(), pair.second);
         }
     }
 }
@@ -0,0 +1,105 @@
+#include "meow_vm.h"
+#include "operator_dispatcher.h"
+#include "pch.h"
+
+// Siêu lệnh do BytecodeOptimizer gộp từ hai lệnh liền nhau. Mỗi lệnh làm đúng
+// những gì cặp gốc làm, theo đúng thứ tự, chỉ khác là một lần dispatch.
+
+// JUMP_IF_[NOT_]LT/LE/EQ dst r1 r2 target: dst = r1 op r2, rồi nhảy nếu kết
+// quả đúng (sai với NOT_).
+void MeowVM::opCompareJump() {
+    Int dst = currentInst->args[0],
+        r1 = currentInst->args[1],
+        r2 = currentInst->args[2],
+        target = currentInst->args[3];
+
+    OpCode compareOp = OpCode::LT;
+    Bool jumpIf = true;
+    switch (currentInst->op) {
+        case OpCode::JUMP_IF_LT: compareOp = OpCode::LT; break;
+        case OpCode::JUMP_IF_LE: compareOp = OpCode::LE; break;
+        case OpCode::JUMP_IF_EQ: compareOp = OpCode::EQ; break;
+        case OpCode::JUMP_IF_NOT_LT: compareOp = OpCode::LT; jumpIf = false; break;
+        case OpCode::JUMP_IF_NOT_LE: compareOp = OpCode::LE; jumpIf = false; break;
+        case OpCode::JUMP_IF_NOT_EQ: compareOp = OpCode::EQ; jumpIf = false; break;
+        default: throwVMError("Unsupported OpCode!");
+    }
+
+    const Value& left = stackSlots[currentBase + r1];
+    const Value& right = stackSlots[currentBase + r2];
+
+    Bool taken = false;
+    if (left.is<Int>() && right.is<Int>()) {
+        // giống hệt các hàm Int/Int trong OperatorDispatcher
+        Int a = left.get<Int>(), b = right.get<Int>();
+        Bool result = compareOp == OpCode::LT ? a < b : compareOp == OpCode::LE ? a <= b : a == b;
+        stackSlots[currentBase + dst] = Value(result);
+        taken = result == jumpIf;
+    } else {
+        Value result;
+        if (auto func = opDispatcher.find(compareOp, left, right)) {
+            result = (*func)(left, right);
+        } else {
+            std::ostringstream os;
+            os << "!!! 🐛 LỖI: Không hỗ trợ toán tử: " << opToString(compareOp) << " cho " << valueTypeName(getValueType(left)) << " và " << valueTypeName(getValueType(right));
+            throwVMError(os.str());
+        }
+        stackSlots[currentBase + dst] = result;
+        taken = _isTruthy(result) == jumpIf;
+    }
+
+    if (taken) {
+        auto proto = currentFrame->closure->proto;
+        if (target < 0 || target >= static_cast<Int>(proto->code.size()))
+            throwVMError(opToString(currentInst->op) + " target OOB");
+        currentFrame->ip = target;
+    }
+}
+
+// ADD_INT_IMM dst src imm immReg: immReg = imm; dst = src + imm.
+void MeowVM::opAddIntImm() {
+    Int dst = currentInst->args[0],
+        src = currentInst->args[1],
+        imm = currentInst->args[2],
+        immReg = currentInst->args[3];
+
+    stackSlots[currentBase + immReg] = Value(imm);
+    const Value& left = stackSlots[currentBase + src];
+    if (left.is<Int>()) {
+        stackSlots[currentBase + dst] = Value(left.get<Int>() + imm);
+        return;
+    }
+
+    const Value& right = stackSlots[currentBase + immReg];
+    Value result;
+    if (auto func = opDispatcher.find(OpCode::ADD, left, right)) {
+        result = (*func)(left, right);
+    } else {
+        std::ostringstream os;
+        os << "!!! 🐛 LỖI: Không hỗ trợ toán tử: " << opToString(OpCode::ADD) << " cho " << valueTypeName(getValueType(left)) << " và " << valueTypeName(getValueType(right));
+        throwVMError(os.str());
+    }
+    stackSlots[currentBase + dst] = result;
+}
+
+// GET_PROP_CALL dst fnReg objReg nameIdx argStart argc: GET_PROP fnReg objReg
+// nameIdx rồi CALL dst fnReg argStart argc.
+void MeowVM::opGetPropCall() {
+    // getter có thể chạy code MeowScript và đổi currentInst, nên đọc hết đối số trước
+    Int dst = currentInst->args[0],
+        fnReg = currentInst->args[1],
+        objReg = currentInst->args[2],
+        nameIdx = currentInst->args[3],
+        argStart = currentInst->args[4],
+        argc = currentInst->args[5];
+
+    getProperty(fnReg, objReg, nameIdx);
+    auto& callee = stackSlots[currentBase + fnReg];
+    _executeCall(callee, dst, argStart, argc, currentBase);
+}
+
+// LOAD_CONST_RETURN reg cidx: đối số trùng vị trí với LOAD_CONST và RETURN.
+void MeowVM::opLoadConstReturn() {
+    opLoadConst();
+    opReturn();
+}
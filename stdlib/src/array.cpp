@@ -26,12 +26,18 @@ static inline double asNumber(const Value& v) {
 }
 
 
-Value arrayPush(Arguments args) {
+Value arrayPush(MeowEngine* engine, Arguments args) {
     if (args.empty() || !args[0].is<Array>()) return Value(Null{});
     ObjArray* arr = args[0].get<Array>();
+    size_t oldCapacity = arr->elements.capacity();
+    size_t addedBytes = 0;
     for (size_t i = 1; i < args.size(); i++) {
         arr->elements.push_back(args[i]);
+        engine->getMemoryManager()->writeBarrier(arr, args[i]);
+        addedBytes += valueHeapBytes(args[i]);
     }
+    addedBytes += (arr->elements.capacity() - oldCapacity) * sizeof(Value);
+    engine->getMemoryManager()->trackGrowth(addedBytes);
 
     return Value(static_cast<Int>(arr->elements.size()));
 }
@@ -79,6 +85,7 @@ Value arraySlice(MeowEngine* engine, Arguments args) {
             dst->elements.push_back(src->elements[i]);
         }
     }
+    engine->getMemoryManager()->trackGrowth(valueVectorBytes(dst->elements));
     return Value(dst);
 }
 
@@ -88,12 +95,19 @@ Value arrayMap(MeowEngine* engine, Arguments args) {
     ObjArray* arr = args[0].get<Array>();
     Function cb = args[1].get<Function>();
 
-    ObjArray* dst = engine->getMemoryManager()->newObject<ObjArray>();
+    MemoryManager* mm = engine->getMemoryManager();
+    ObjArray* dst = mm->newObject<ObjArray>();
     dst->elements.reserve(arr->elements.size());
-    for (const auto& el : arr->elements) {
-        Value r = engine->call(cb, { el });
-        dst->elements.push_back(r);
+    {
+        // Callback được thu gom giữa chừng; dst chưa nằm trong root nên phải ghim.
+        GCPin<ObjArray> dstPin(*mm, dst);
+        GCCallbackScope gcScope(*mm);
+        for (const auto& el : arr->elements) {
+            Value r = engine->call(cb, { el });
+            dst->elements.push_back(r);
+        }
     }
+    mm->trackGrowth(valueVectorBytes(dst->elements));
     return Value(dst);
 }
 
@@ -103,11 +117,17 @@ Value arrayFilter(MeowEngine* engine, Arguments args) {
     ObjArray* arr = args[0].get<Array>();
     Function cb = args[1].get<Function>();
 
-    ObjArray* dst = engine->getMemoryManager()->newObject<ObjArray>();
-    for (const auto& el : arr->elements) {
-        Value r = engine->call(cb, { el });
-        if (isTruthy(r)) dst->elements.push_back(el);
+    MemoryManager* mm = engine->getMemoryManager();
+    ObjArray* dst = mm->newObject<ObjArray>();
+    {
+        GCPin<ObjArray> dstPin(*mm, dst);
+        GCCallbackScope gcScope(*mm);
+        for (const auto& el : arr->elements) {
+            Value r = engine->call(cb, { el });
+            if (isTruthy(r)) dst->elements.push_back(el);
+        }
     }
+    mm->trackGrowth(valueVectorBytes(dst->elements));
     return Value(dst);
 }
 
@@ -117,6 +137,8 @@ Value arrayReduce(MeowEngine* engine, Arguments args) {
     ObjArray* arr = args[0].get<Array>();
     Function cb = args[1].get<Function>();
     Value acc = args[2];
+    // acc chỉ nằm ngoài root giữa hai lời gọi, nơi không có safepoint.
+    GCCallbackScope gcScope(*engine->getMemoryManager());
     for (const auto& el : arr->elements) {
         acc = engine->call(cb, { acc, el });
     }
@@ -128,6 +150,7 @@ Value arrayForEach(MeowEngine* engine, Arguments args) {
     if (args.size() < 2 || !args[0].is<Array>() || !args[1].is<Function>()) return Value(Null{});
     ObjArray* arr = args[0].get<Array>();
     Function cb = args[1].get<Function>();
+    GCCallbackScope gcScope(*engine->getMemoryManager());
     for (size_t i = 0; i < arr->elements.size(); i++) {
         engine->call(cb, { arr->elements[i], Value(static_cast<Int>(i)) });
     }
@@ -139,6 +162,7 @@ Value arrayFind(MeowEngine* engine, Arguments args) {
     if (args.size() < 2 || !args[0].is<Array>() || !args[1].is<Function>()) return Value(Null{});
     ObjArray* arr = args[0].get<Array>();
     Function cb = args[1].get<Function>();
+    GCCallbackScope gcScope(*engine->getMemoryManager());
     for (size_t i = 0; i < arr->elements.size(); i++) {
         Value r = engine->call(cb, { arr->elements[i], Value(static_cast<Int>(i)) });
         if (isTruthy(r)) return arr->elements[i];
@@ -151,6 +175,7 @@ Value arrayFindIndex(MeowEngine* engine, Arguments args) {
     if (args.size() < 2 || !args[0].is<Array>() || !args[1].is<Function>()) return Value(static_cast<Int>(-1));
     ObjArray* arr = args[0].get<Array>();
     Function cb = args[1].get<Function>();
+    GCCallbackScope gcScope(*engine->getMemoryManager());
     for (size_t i = 0; i < arr->elements.size(); i++) {
         Value r = engine->call(cb, { arr->elements[i], Value(static_cast<Int>(i)) });
         if (isTruthy(r)) return Value(static_cast<Int>(i));
@@ -190,26 +215,33 @@ Value arraySort(MeowEngine* engine, Arguments args) {
 }
 
 
-Value arrayReserve(Arguments args) {
+Value arrayReserve(MeowEngine* engine, Arguments args) {
     if (args.size() < 2 || !args[0].is<Array>() || !args[1].is<Int>()) return Value(Null{});
     ObjArray* arr = args[0].get<Array>();
     Int cap = args[1].get<Int>();
     if (cap < 0) return Value(Null{});
+    size_t oldCapacity = arr->elements.capacity();
     arr->elements.reserve(static_cast<size_t>(cap));
+    engine->getMemoryManager()->trackGrowth((arr->elements.capacity() - oldCapacity) * sizeof(Value));
     return Value(Null{});
 }
 
 
-Value arrayResize(Arguments args) {
+Value arrayResize(MeowEngine* engine, Arguments args) {
     if (args.size() < 2 || !args[0].is<Array>() || !args[1].is<Int>()) return Value(Null{});
     ObjArray* arr = args[0].get<Array>();
     Int n = args[1].get<Int>();
     if (n < 0) return Value(Null{});
+    size_t oldCapacity = arr->elements.capacity();
     if (args.size() > 2) {
         arr->elements.resize(static_cast<size_t>(n), args[2]);
+        engine->getMemoryManager()->writeBarrier(arr, args[2]);
     } else {
         arr->elements.resize(static_cast<size_t>(n), Value(Null{}));
     }
+    if (arr->elements.capacity() > oldCapacity) {
+        engine->getMemoryManager()->trackGrowth((arr->elements.capacity() - oldCapacity) * sizeof(Value));
+    }
     return Value(Null{});
 }
 
@@ -0,0 +1,133 @@
+#include "meow_script.h"
+
+static Value cycleToObject(MemoryManager* mm, const GCCycleStats& cycle) {
+    auto obj = mm->newObject<ObjObject>();
+    obj->fields["reason"] = Value(Str(gcReasonName(cycle.reason)));
+    obj->fields["markMs"] = Value(static_cast<Real>(cycle.markMillis));
+    obj->fields["sweepMs"] = Value(static_cast<Real>(cycle.sweepMillis));
+    obj->fields["compactMs"] = Value(static_cast<Real>(cycle.compactMillis));
+    obj->fields["movedObjects"] = Value(static_cast<Int>(cycle.movedObjects));
+    obj->fields["rememberedObjects"] = Value(static_cast<Int>(cycle.rememberedObjects));
+    obj->fields["largeObjects"] = Value(static_cast<Int>(cycle.largeObjects));
+    obj->fields["largeBytes"] = Value(static_cast<Int>(cycle.largeBytes));
+    obj->fields["pauseMs"] = Value(static_cast<Real>(cycle.pauseMillis));
+    obj->fields["objectsBefore"] = Value(static_cast<Int>(cycle.objectsBefore));
+    obj->fields["objectsAfter"] = Value(static_cast<Int>(cycle.objectsAfter));
+    obj->fields["bytesBefore"] = Value(static_cast<Int>(cycle.bytesBefore));
+    obj->fields["bytesAfter"] = Value(static_cast<Int>(cycle.bytesAfter));
+
+    auto live = mm->newObject<ObjObject>();
+    for (size_t i = 0; i < cycle.liveObjects.size(); ++i) {
+        live->fields[objectTypeName(static_cast<ObjectType>(i))] = Value(static_cast<Int>(cycle.liveObjects[i]));
+    }
+    obj->fields["live"] = Value(live);
+    return Value(obj);
+}
+
+Value gcStats(MeowEngine* engine, [[maybe_unused]] Arguments args) {
+    MemoryManager* mm = engine->getMemoryManager();
+    const GCStats& stats = engine->getGCStats();
+
+    auto obj = mm->newObject<ObjObject>();
+    obj->fields["cycles"] = Value(static_cast<Int>(stats.cycles));
+    obj->fields["compactions"] = Value(static_cast<Int>(stats.compactions));
+    obj->fields["heapBytes"] = Value(static_cast<Int>(mm->allocatedBytes()));
+    obj->fields["totalPauseMs"] = Value(static_cast<Real>(stats.totalPauseMillis));
+    obj->fields["maxPauseMs"] = Value(static_cast<Real>(stats.maxPauseMillis));
+    obj->fields["bytesReclaimed"] = Value(static_cast<Int>(stats.bytesReclaimed));
+    obj->fields["objectsReclaimed"] = Value(static_cast<Int>(stats.objectsReclaimed));
+
+    // Mỗi phần tử là [cận trên ms (null = vô cực), số lần dừng].
+    auto histogram = mm->newObject<ObjArray>();
+    for (size_t i = 0; i < stats.pauseHistogram.size(); ++i) {
+        auto bucket = mm->newObject<ObjArray>();
+        if (i < GCStats::pauseBucketLimits.size()) {
+            bucket->elements.push_back(Value(static_cast<Real>(GCStats::pauseBucketLimits[i])));
+        } else {
+            bucket->elements.push_back(Value(Null{}));
+        }
+        bucket->elements.push_back(Value(static_cast<Int>(stats.pauseHistogram[i])));
+        histogram->elements.push_back(Value(bucket));
+    }
+    obj->fields["pauseHistogram"] = Value(histogram);
+
+    auto memory = mm->newObject<ObjObject>();
+    memory->fields["chunks"] = Value(static_cast<Int>(stats.memory.chunks));
+    memory->fields["reservedBytes"] = Value(static_cast<Int>(stats.memory.reservedBytes));
+    memory->fields["residentBytes"] = Value(static_cast<Int>(stats.memory.residentBytes));
+    memory->fields["hugePageBytes"] = Value(static_cast<Int>(stats.memory.hugePageBytes));
+    memory->fields["hugePageCoverage"] = Value(static_cast<Real>(stats.memory.hugePageCoverage()));
+    memory->fields["processResidentBytes"] = Value(static_cast<Int>(stats.memory.processResidentBytes));
+    obj->fields["memory"] = Value(memory);
+
+    if (!stats.history.empty()) {
+        obj->fields["last"] = cycleToObject(mm, stats.history.back());
+    } else {
+        obj->fields["last"] = Value(Null{});
+    }
+    return Value(obj);
+}
+
+// Gọi từ script thì thu gom chạy ở safepoint ngay sau lệnh CALL này (hoặc sau
+// khi native bên ngoài trả về), nên kết quả của chu kỳ xem qua gc.stats().last.
+Value gcCollect(MeowEngine* engine, [[maybe_unused]] Arguments args) {
+    engine->collectGarbage();
+    return Value(Null{});
+}
+
+Value gcSnapshot(MeowEngine* engine, Arguments args) {
+    if (args.empty() || !args[0].is<Str>()) return Value(Null{});
+    try {
+        engine->writeHeapSnapshot(args[0].get<Str>());
+    } catch (const std::exception&) {
+        return Value(false);
+    }
+    return Value(true);
+}
+
+Value gcProfile(MeowEngine* engine, Arguments args) {
+    bool enabled = args.empty() || !args[0].is<Bool>() || args[0].get<Bool>();
+    engine->setAllocationProfiling(enabled);
+    return Value(Null{});
+}
+
+Value gcAllocations(MeowEngine* engine, Arguments args) {
+    MemoryManager* mm = engine->getMemoryManager();
+    size_t limit = std::numeric_limits<size_t>::max();
+    if (!args.empty() && args[0].is<Int>() && args[0].get<Int>() >= 0) {
+        limit = static_cast<size_t>(args[0].get<Int>());
+    }
+
+    auto sites = engine->getAllocationSites();
+    auto result = mm->newObject<ObjArray>();
+    for (size_t i = 0; i < sites.size() && i < limit; ++i) {
+        auto site = mm->newObject<ObjObject>();
+        site->fields["function"] = Value(sites[i].function);
+        site->fields["ip"] = Value(sites[i].ip);
+        site->fields["type"] = Value(Str(objectTypeName(sites[i].type)));
+        site->fields["count"] = Value(static_cast<Int>(sites[i].count));
+        site->fields["bytes"] = Value(static_cast<Int>(sites[i].bytes));
+        result->elements.push_back(Value(site));
+    }
+    return Value(result);
+}
+
+Value gcRegion(MeowEngine* engine, Arguments args) {
+    if (args.empty()) return Value(Null{});
+    std::vector<Value> callArgs(args.begin() + 1, args.end());
+    return engine->callInRegion(args[0], callArgs);
+}
+
+Module CreateMeowModule(MeowEngine* engine) {
+    MemoryManager* mm = engine->getMemoryManager();
+
+    auto gcModule = mm->newObject<ObjModule>("gc", "native:gc");
+    gcModule->exports["stats"] = Value(gcStats);
+    gcModule->exports["collect"] = Value(gcCollect);
+    gcModule->exports["snapshot"] = Value(gcSnapshot);
+    gcModule->exports["profile"] = Value(gcProfile);
+    gcModule->exports["allocations"] = Value(gcAllocations);
+    gcModule->exports["region"] = Value(gcRegion);
+
+    return gcModule;
+}
@@ -73,17 +73,17 @@ Value native_io_isDirectory(Arguments args) {
 }
 
 
-Value native_io_listDir(Arguments args) {
+Value native_io_listDir(MeowEngine* engine, Arguments args) {
     if (args.size() < 1 || !args[0].is<Str>()) return Value(Null{});
     const Str& path = args[0].get<Str>();
     std::error_code ec;
     if (!fs::exists(path, ec) || !fs::is_directory(path, ec)) return Value(Null{});
-    Array out = new ObjArray();
+    ValueArray names;
     for (auto& entry : fs::directory_iterator(path, ec)) {
         if (ec) break;
-        out->elements.emplace_back(Value(entry.path().filename().string()));
+        names.emplace_back(Value(entry.path().filename().string()));
     }
-    return Value(out);
+    return Value(engine->getMemoryManager()->newObject<ObjArray>(std::move(names)));
 }
 
 
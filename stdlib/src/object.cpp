@@ -3,41 +3,41 @@
 #include <vector>
 
 
-Value native_object_keys(Arguments args) {
+Value native_object_keys(MeowEngine* engine, Arguments args) {
     if (args.empty() || !args[0].is<Object>()) return Value(Null{});
     Object obj = args[0].get<Object>();
-    Array out = new ObjArray();
-    out->elements.reserve(obj->fields.size());
+    ValueArray keys;
+    keys.reserve(obj->fields.size());
     for (const auto& kv : obj->fields) {
-        out->elements.emplace_back(Value(kv.first));
+        keys.emplace_back(Value(kv.first));
     }
-    return Value(out);
+    return Value(engine->getMemoryManager()->newObject<ObjArray>(std::move(keys)));
 }
 
 
-Value native_object_values(Arguments args) {
+Value native_object_values(MeowEngine* engine, Arguments args) {
     if (args.empty() || !args[0].is<Object>()) return Value(Null{});
     Object obj = args[0].get<Object>();
-    Array out = new ObjArray();
-    out->elements.reserve(obj->fields.size());
+    ValueArray values;
+    values.reserve(obj->fields.size());
     for (const auto& kv : obj->fields) {
-        out->elements.emplace_back(kv.second);
+        values.emplace_back(kv.second);
     }
-    return Value(out);
+    return Value(engine->getMemoryManager()->newObject<ObjArray>(std::move(values)));
 }
 
 
-Value native_object_entries(Arguments args) {
+Value native_object_entries(MeowEngine* engine, Arguments args) {
     if (args.empty() || !args[0].is<Object>()) return Value(Null{});
+    MemoryManager* mm = engine->getMemoryManager();
     Object obj = args[0].get<Object>();
-    Array out = new ObjArray();
-    out->elements.reserve(obj->fields.size());
+    ValueArray entries;
+    entries.reserve(obj->fields.size());
     for (const auto& kv : obj->fields) {
-        Array pair = new ObjArray();
-        pair->elements.emplace_back(Value(kv.first));
-        pair->elements.emplace_back(kv.second);
-        out->elements.emplace_back(Value(pair));
+        Array pair = mm->newObject<ObjArray>(ValueArray{ Value(kv.first), kv.second });
+        entries.emplace_back(Value(pair));
     }
+    Array out = mm->newObject<ObjArray>(std::move(entries));
     return Value(out);
 }
 
@@ -50,19 +50,19 @@ Value native_object_has(Arguments args) {
 }
 
 
-Value native_object_merge(Arguments args) {
+Value native_object_merge(MeowEngine* engine, Arguments args) {
     if (args.empty()) return Value(Null{});
-    Object result = new ObjObject();
+    std::unordered_map<Str, Value> fields;
 
     for (size_t i = 0; i < args.size(); ++i) {
         if (!args[i].is<Object>()) continue;
         Object src = args[i].get<Object>();
         for (const auto& kv : src->fields) {
 
-            result->fields[kv.first] = kv.second;
+            fields[kv.first] = kv.second;
         }
     }
-    return Value(result);
+    return Value(engine->getMemoryManager()->newObject<ObjObject>(std::move(fields)));
 }
 
 
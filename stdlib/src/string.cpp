@@ -50,25 +50,25 @@ static inline const std::string& valToStdStr(const Value& v) {
 }
 
 
-Value native_string_split(Arguments args) {
+Value native_string_split(MeowEngine* engine, Arguments args) {
     if (args.empty() || !args[0].is<Str>()) return Value(Null{});
     const std::string& str = valToStdStr(args[0]);
     std::string delimiter = " ";
     if (args.size() > 1 && args[1].is<Str>()) delimiter = valToStdStr(args[1]);
 
-    Array result = new ObjArray();
+    ValueArray parts;
     size_t start = 0, end;
     if (delimiter.empty()) {
-
-        for (char c : str) result->elements.emplace_back(Value(std::string(1, c)));
-        return Value(result);
+        parts.reserve(str.size());
+        for (char c : str) parts.emplace_back(Value(std::string(1, c)));
+        return Value(engine->getMemoryManager()->newObject<ObjArray>(std::move(parts)));
     }
     while ((end = str.find(delimiter, start)) != std::string::npos) {
-        result->elements.emplace_back(Value(str.substr(start, end - start)));
+        parts.emplace_back(Value(str.substr(start, end - start)));
         start = end + delimiter.length();
     }
-    result->elements.emplace_back(Value(str.substr(start)));
-    return Value(result);
+    parts.emplace_back(Value(str.substr(start)));
+    return Value(engine->getMemoryManager()->newObject<ObjArray>(std::move(parts)));
 }
 
 
@@ -2,13 +2,14 @@
 #include <iostream>
 
 Value systemArgv(MeowEngine* engine, [[maybe_unused]] Arguments args) {
-    auto argv = engine->getArguments();
-    Array arr = new ObjArray();
+    const auto& argv = engine->getArguments();
+    ValueArray elements;
+    elements.reserve(argv.size());
     for (auto &i : argv) {
-        arr->elements.push_back(Value(i));
+        elements.push_back(Value(i));
     }
 
-    return Value(arr);
+    return Value(engine->getMemoryManager()->newObject<ObjArray>(std::move(elements)));
 }
 
 Value systemExit(MeowEngine* engine, Arguments args) {
@@ -0,0 +1,99 @@
+#include "meow_script.h"
+
+static ObjWeakRef* asWeakRef(const Value& v) {
+    if (!v.is<Instance>()) return nullptr;
+    Instance inst = v.get<Instance>();
+    if (!inst || inst->objectType() != ObjectType::WeakRef) return nullptr;
+    return static_cast<ObjWeakRef*>(inst);
+}
+
+static ObjWeakMap* asWeakMap(const Value& v) {
+    if (!v.is<Instance>()) return nullptr;
+    Instance inst = v.get<Instance>();
+    if (!inst || inst->objectType() != ObjectType::WeakMap) return nullptr;
+    return static_cast<ObjWeakMap*>(inst);
+}
+
+
+Value weakRefDeref([[maybe_unused]] MeowEngine* engine, Arguments args) {
+    ObjWeakRef* ref = args.empty() ? nullptr : asWeakRef(args[0]);
+    if (!ref) return Value(Null{});
+    return ref->target;
+}
+
+
+Value weakMapGet([[maybe_unused]] MeowEngine* engine, Arguments args) {
+    ObjWeakMap* map = args.empty() ? nullptr : asWeakMap(args[0]);
+    if (!map || args.size() < 2) return Value(Null{});
+    auto it = map->entries.find(valueObject(args[1]));
+    if (it == map->entries.end()) return Value(Null{});
+    return it->second.value;
+}
+
+Value weakMapSet(MeowEngine* engine, Arguments args) {
+    ObjWeakMap* map = args.empty() ? nullptr : asWeakMap(args[0]);
+    if (!map || args.size() < 3) return Value(false);
+    MeowObject* key = valueObject(args[1]);
+    if (!key) return Value(false);
+
+    auto [it, inserted] = map->entries.try_emplace(key, ObjWeakMap::Entry{ key, args[1], args[2] });
+    if (inserted) {
+        engine->getMemoryManager()->trackGrowth(ObjWeakMap::entryBytes(it->second));
+    } else {
+        it->second.value = args[2];
+    }
+    engine->getMemoryManager()->writeBarrier(map, args[1]);
+    engine->getMemoryManager()->writeBarrier(map, args[2]);
+    return Value(true);
+}
+
+Value weakMapHas([[maybe_unused]] MeowEngine* engine, Arguments args) {
+    ObjWeakMap* map = args.empty() ? nullptr : asWeakMap(args[0]);
+    if (!map || args.size() < 2) return Value(false);
+    return Value(map->entries.count(valueObject(args[1])) > 0);
+}
+
+Value weakMapDelete([[maybe_unused]] MeowEngine* engine, Arguments args) {
+    ObjWeakMap* map = args.empty() ? nullptr : asWeakMap(args[0]);
+    if (!map || args.size() < 2) return Value(false);
+    return Value(map->entries.erase(valueObject(args[1])) > 0);
+}
+
+Value weakMapSize([[maybe_unused]] MeowEngine* engine, Arguments args) {
+    ObjWeakMap* map = args.empty() ? nullptr : asWeakMap(args[0]);
+    if (!map) return Value(Null{});
+    return Value(static_cast<Int>(map->entries.size()));
+}
+
+
+Module CreateMeowModule(MeowEngine* engine) {
+    MemoryManager* mm = engine->getMemoryManager();
+
+    // Class là object thường: script có thể gắn thêm method qua SET_PROP, mà
+    // object vĩnh viễn không được mark. Các hàm bên dưới giữ class qua GCPin.
+    Class refClass = mm->newObject<ObjClass>("WeakRef");
+    refClass->methods["deref"] = Value(weakRefDeref);
+
+    Class mapClass = mm->newObject<ObjClass>("WeakMap");
+    mapClass->methods["get"] = Value(weakMapGet);
+    mapClass->methods["set"] = Value(weakMapSet);
+    mapClass->methods["has"] = Value(weakMapHas);
+    mapClass->methods["delete"] = Value(weakMapDelete);
+    mapClass->methods["size"] = Value(weakMapSize);
+
+    NativeFnAdvanced newRef = [refPin = GCPin<ObjClass>(*mm, refClass)](MeowEngine* engine, Arguments args) -> Value {
+        if (args.empty() || !valueObject(args[0])) return Value(Null{});
+        return Value(static_cast<Instance>(engine->getMemoryManager()->newObject<ObjWeakRef>(refPin.get(), args[0])));
+    };
+    NativeFnAdvanced newMap = [mapPin = GCPin<ObjClass>(*mm, mapClass)](MeowEngine* engine, [[maybe_unused]] Arguments args) -> Value {
+        return Value(static_cast<Instance>(engine->getMemoryManager()->newObject<ObjWeakMap>(mapPin.get())));
+    };
+
+    auto weakModule = mm->newObject<ObjModule>("weak", "native:weak");
+    weakModule->exports["ref"] = Value(newRef);
+    weakModule->exports["map"] = Value(newMap);
+    weakModule->exports["WeakRef"] = Value(refClass);
+    weakModule->exports["WeakMap"] = Value(mapClass);
+
+    return weakModule;
+}
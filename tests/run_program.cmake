@@ -0,0 +1,19 @@
+# Chạy COMMAND với ARGS (nối bằng '|') rồi so stdout với file EXPECTED.
+# Test hỏng nếu lệnh trả mã khác 0, in ra stderr hoặc stdout khác mong đợi.
+string(REPLACE "|" ";" args "${ARGS}")
+execute_process(
+    COMMAND "${COMMAND}" ${args}
+    OUTPUT_VARIABLE actual
+    ERROR_VARIABLE errors
+    RESULT_VARIABLE result)
+
+file(READ "${EXPECTED}" expected)
+string(REPLACE "\r\n" "\n" expected "${expected}")
+string(REPLACE "\r\n" "\n" actual "${actual}")
+
+if (NOT result EQUAL 0 OR NOT errors STREQUAL "")
+    message(FATAL_ERROR "Lệnh thất bại (mã ${result}):\n${errors}")
+endif()
+if (NOT actual STREQUAL expected)
+    message(FATAL_ERROR "Kết quả khác mong đợi.\n--- mong đợi\n${expected}--- nhận được\n${actual}")
+endif()
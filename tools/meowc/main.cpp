@@ -0,0 +1,83 @@
+#include "bytecode_parser.h"
+#include "bytecode_optimizer.h"
+#include "binary_writer.h"
+#include "memory_manager.h"
+#include "mark_sweep_gc.h"
+
+#include <map>
+
+// meowc: dịch bytecode dạng text (.meow) sang file nhị phân .meowb, tối ưu ở
+// mức -O (mặc định như meow-vm). --fusion-report in thêm các cặp lệnh đã được
+// gộp thành siêu lệnh.
+
+// Tổng theo từng loại cặp, rồi từng vị trí theo thứ tự hàm.
+static void printFusionReport(std::ostream& os, std::vector<FusedPair> fusions) {
+    std::sort(fusions.begin(), fusions.end(), [](const FusedPair& a, const FusedPair& b) {
+        return std::tie(a.proto, a.index) < std::tie(b.proto, b.index);
+    });
+    std::map<std::tuple<OpCode, OpCode, OpCode>, Int> counts;
+    for (const FusedPair& pair : fusions) ++counts[{ pair.first, pair.second, pair.fused }];
+
+    os << "Siêu lệnh đã gộp: " << fusions.size() << std::endl;
+    for (const auto& [kind, count] : counts) {
+        auto [first, second, fused] = kind;
+        Str pair = Str(opCodeName(first)) + " + " + Str(opCodeName(second));
+        os << "  " << std::left << std::setw(28) << pair << " -> " << std::setw(18) << opCodeName(fused)
+           << std::right << std::setw(8) << count << std::endl;
+    }
+    for (const FusedPair& pair : fusions) {
+        os << "  " << pair.proto << ":" << pair.index << "  " << opCodeName(pair.fused)
+           << " (" << opCodeName(pair.first) << " + " << opCodeName(pair.second) << ")" << std::endl;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    Str inputPath;
+    Str outputPath;
+    OptimizerConfig optimizer = OptimizerConfig::fromEnvironment();
+    bool fusionReport = false;
+
+    for (int i = 1; i < argc; ++i) {
+        Str arg = argv[i];
+        if (arg == "-o") {
+            if (i + 1 >= argc) {
+                std::cerr << "Lỗi: '-o' cần tên file đầu ra." << std::endl;
+                return 1;
+            }
+            outputPath = argv[++i];
+        } else if (arg == "--fusion-report") {
+            fusionReport = true;
+        } else if (arg.rfind("-O", 0) == 0) {
+            try {
+                optimizer.parseFlag(arg);
+            } catch (const std::exception& e) {
+                std::cerr << "Lỗi: " << e.what() << std::endl;
+                return 1;
+            }
+        } else if (inputPath.empty()) {
+            inputPath = arg;
+        } else {
+            std::cerr << "Lỗi: Thừa đối số: " << arg << std::endl;
+            return 1;
+        }
+    }
+
+    if (inputPath.empty()) {
+        std::cerr << "Usage: " << argv[0] << " <input.meow> [-o <output.meowb>] [-O0|-O1|-O2] [--fusion-report]" << std::endl;
+        return 1;
+    }
+    if (outputPath.empty()) {
+        outputPath = std::filesystem::path(inputPath).replace_extension(".meowb").string();
+    }
+
+    GCConfig gcConfig;
+    MemoryManager memoryManager(std::make_unique<MarkSweepGC>(gcConfig), gcConfig);
+    BytecodeParser parser;
+    parser.setOptimizationLevel(optimizer.level);
+    std::vector<FusedPair> fusions;
+    if (fusionReport) parser.setFusionLog(&fusions);
+    if (!parser.parseFile(inputPath, memoryManager)) return 1;
+    if (fusionReport) printFusionReport(std::cout, std::move(fusions));
+    if (!BinaryWriter::writeFile(outputPath, parser.protos)) return 1;
+    return 0;
+}